@@ -0,0 +1,146 @@
+// Micro-benchmarks for the routing code. Run from the build directory:
+//   ./bench [-f ../map.osm]
+// Every benchmark is run on a model that keeps the node order of the OSM file and on a model whose
+// nodes were renumbered along a Hilbert curve, so that the effect of node locality can be compared.
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../src/contraction_hierarchy.h"
+#include "../src/customizable_hierarchy.h"
+#include "../src/isochrone.h"
+#include "../src/phast.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+#include "../src/utility_route_model.h"
+
+using Clock = std::chrono::steady_clock;
+
+// random query coordinates, in percent of the map as expected by RoutePlanner
+static std::vector<float> RandomCoordinates(std::size_t n, unsigned seed)
+{
+    std::mt19937 rng{seed};
+    std::uniform_real_distribution<float> dist{0.f, 100.f};
+    std::vector<float> coords(n);
+    for( auto &c: coords )
+        c = dist(rng);
+    return coords;
+}
+
+static double BenchSnapping(RouteModel &model, const std::vector<float> &coords)
+{
+    auto start = Clock::now();
+    long sum = 0;
+    for( std::size_t i = 0; i + 1 < coords.size(); i += 2 )
+        sum += model.FindClosestNode(coords[i] * 0.01f, coords[i+1] * 0.01f).Index();
+    auto elapsed = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    if( sum < 0 ) std::cerr << sum;
+    return elapsed / (coords.size() / 2);
+}
+
+static double BenchSearch(RouteModel &model, const std::vector<float> &coords)
+{
+    // one planner for all queries, as a server worker would use it
+    RoutePlanner planner{model};
+    double total = 0.;
+    int queries = 0;
+    for( std::size_t i = 0; i + 3 < coords.size(); i += 4 ) {
+        planner.SetEndpoints(coords[i], coords[i+1], coords[i+2], coords[i+3]);
+        auto start = Clock::now();
+        planner.Search();
+        total += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        ++queries;
+    }
+    return total / queries;
+}
+
+// One-to-all costs from each source: Dijkstra over the road graph, PHAST one source per sweep, and
+// PHAST with Phast::Lanes sources per sweep. Prints the time per source in us of each.
+static void BenchOneToAll(RouteModel &model, const std::vector<float> &coords)
+{
+    std::vector<int> sources;
+    for( std::size_t i = 0; i + 1 < coords.size(); i += 2 )
+        sources.push_back(model.FindClosestNode(coords[i] * 0.01f, coords[i+1] * 0.01f, RouteModel::Car, true).Index());
+    auto start = Clock::now();
+    ContractionHierarchy hierarchy{model};
+    const auto build = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::cout << "  Contraction:     " << build << " ms, " << hierarchy.NumShortcuts() << " shortcuts\n";
+
+    IsochroneSearch dijkstra{model};
+    double sum = 0.;
+    start = Clock::now();
+    for( int source: sources )
+        sum += dijkstra.Search(source, std::numeric_limits<float>::max()).size();
+    const auto dijkstra_time = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+    Phast phast{hierarchy};
+    start = Clock::now();
+    for( int source: sources )
+        sum += phast.Costs(source)[0];
+    const auto single_time = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    start = Clock::now();
+    for( auto &costs: phast.Costs(sources) )
+        sum += costs[0];
+    const auto batch_time = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    if( sum < 0 ) std::cerr << sum;
+    std::cout << "  One-to-all:      Dijkstra " << dijkstra_time / sources.size() << " us, PHAST "
+              << single_time / sources.size() << " us, PHAST x" << Phast::Lanes << " "
+              << batch_time / sources.size() << " us per source\n";
+}
+
+// Preprocessing once, then customizing for new weights (as after a traffic update) and querying.
+static void BenchCustomization(RouteModel &model, const std::vector<float> &coords)
+{
+    auto start = Clock::now();
+    CustomizableHierarchy cch{model, RouteModel::Car};
+    const auto build = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::cout << "  CCH order:       " << build << " ms, " << cch.NumShortcuts() << " shortcuts, "
+              << cch.NumLevels() << " levels\n";
+    for( int n_threads: {1, 0} ) {
+        constexpr int repeats = 20;
+        start = Clock::now();
+        for( int i = 0; i < repeats; ++i )
+            cch.Publish(cch.Customize(RouteModel::Time, n_threads));
+        const auto customize = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repeats;
+        std::cout << "  Customization:   " << customize << " ms on " << (n_threads ? "1 thread" : "all threads") << "\n";
+    }
+    auto hierarchy = cch.Current();
+    ContractionQuery query{*hierarchy};
+    double sum = 0.;
+    start = Clock::now();
+    for( std::size_t i = 0; i + 3 < coords.size(); i += 4 )
+        sum += query.Cost(model.FindClosestNode(coords[i] * 0.01f, coords[i+1] * 0.01f, RouteModel::Car, true).Index(),
+                          model.FindClosestNode(coords[i+2] * 0.01f, coords[i+3] * 0.01f, RouteModel::Car, true).Index());
+    const auto query_time = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    if( sum < 0 ) std::cerr << sum;
+    std::cout << "  CCH query:       " << query_time / (coords.size() / 4) << " us/query (with snapping)\n";
+}
+
+int main(int argc, const char **argv)
+{
+    std::string osm_data_file = "../map.osm";
+    for( int i = 1; i < argc; ++i )
+        if( std::string_view{argv[i]} == "-f" && ++i < argc )
+            osm_data_file = argv[i];
+
+    auto data = ReadFile(osm_data_file);
+    if( !data ) {
+        std::cout << "Failed to read " << osm_data_file << std::endl;
+        return 1;
+    }
+
+    const auto snap_coords = RandomCoordinates(2000, 1);
+    const auto search_coords = RandomCoordinates(400, 2);
+
+    for( bool hilbert_order: {false, true} ) {
+        RouteModel model{*data, hilbert_order};
+        std::cout << (hilbert_order ? "Hilbert node order:\n" : "File node order:\n");
+        std::cout << "  FindClosestNode: " << BenchSnapping(model, snap_coords) << " us/query\n";
+        std::cout << "  Search:          " << BenchSearch(model, search_coords) << " us/query\n";
+        BenchOneToAll(model, search_coords);
+        BenchCustomization(model, search_coords);
+    }
+}
@@ -0,0 +1,226 @@
+#include "alternative_routes.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <unordered_set>
+
+// the key of the road between two nodes, the same in both directions
+static std::uint64_t RoadKey(int a, int b)
+{
+    return (std::uint64_t(std::uint32_t(std::min(a, b))) << 32) | std::uint32_t(std::max(a, b));
+}
+
+AlternativeRoutes::AlternativeRoutes(RouteModel &model, RouteModel::Profile profile, RouteModel::Metric metric):
+    m_Model(model),
+    m_Profile(profile),
+    m_Metric(metric),
+    m_Planner(model, profile, metric)
+{
+    // the same admissible heuristic as RoutePlanner::CalculateHValue()
+    if( m_Metric == RouteModel::Time )
+        m_HeuristicScale = static_cast<float>(m_Model.MetricScale()) / (m_Model.Profiles(m_Profile).MaxSpeed() / 3.6f);
+    const int n_nodes = (int)m_Model.SNodes().size(), n_edges = (int)m_Model.EdgeTo().size();
+    m_Forward.Resize(n_nodes, n_edges);
+    m_Backward.Resize(n_nodes, n_edges);
+    m_Check.Resize(n_nodes, n_edges);
+    m_Plateau.resize(n_nodes);
+}
+
+void AlternativeRoutes::SetEndpoints(float start_x, float start_y, float end_x, float end_y)
+{
+    m_Planner.SetEndpoints(start_x, start_y, end_x, end_y);
+    SetEndpoints(m_Planner.StartNode(), m_Planner.EndNode());
+}
+
+void AlternativeRoutes::SetEndpoints(int start, int end)
+{
+    m_Start = start;
+    m_End = end;
+}
+
+float AlternativeRoutes::Heuristic(int a, int b) const
+{
+    return m_Model.SNodes()[a].distance(m_Model.SNodes()[b]) * m_HeuristicScale;
+}
+
+void AlternativeRoutes::Grow(SearchContext &tree, int from, int to, float max_cost, std::vector<int> *settled)
+{
+    auto &first_edge = m_Model.FirstEdge();
+    auto &edge_to = m_Model.EdgeTo();
+    auto &edge_weight = m_Model.EdgeWeights(m_Profile, m_Metric);
+    tree.Clear();
+    tree.Reach(from, 0.f, -1, -1);
+    tree.Push(from, 0.f);
+    for( int node = tree.Pop(); node >= 0; node = tree.Pop() ) {
+        tree.Close(node);
+        if( settled )
+            settled->push_back(node);
+        const float g = tree.G(node);
+        for( int e = first_edge[node]; e < first_edge[node + 1]; ++e ) {
+            if( !m_Model.EdgeAccessible(e, m_Profile) )
+                continue;
+            const int next = edge_to[e];
+            const float g_next = g + edge_weight[e];
+            // nodes outside the ellipse can not be on a route within the stretch
+            if( g_next >= tree.G(next) || g_next + Heuristic(next, to) > max_cost )
+                continue;
+            tree.Reach(next, g_next, node, e);
+            tree.Push(next, g_next);
+        }
+    }
+}
+
+AlternativeRoutes::Route AlternativeRoutes::ViaRoute(int via) const
+{
+    Route route;
+    auto &nodes = m_Model.Nodes();
+    for( int node = via; node >= 0; node = m_Forward.Parent(node) )
+        route.path.push_back(node);
+    std::reverse(route.path.begin(), route.path.end());
+    for( int node = m_Backward.Parent(via); node >= 0; node = m_Backward.Parent(node) )
+        route.path.push_back(node);
+    // the edges of the start half are the parent edges of the forward tree, those of the end half the
+    // parent edges of the backward tree; roads have the same weights both ways
+    for( int node = via; m_Forward.ParentEdge(node) >= 0; node = m_Forward.Parent(node) )
+        route.duration += m_Model.EdgeWeight(m_Forward.ParentEdge(node), m_Profile, RouteModel::Time);
+    for( int node = via; m_Backward.ParentEdge(node) >= 0; node = m_Backward.Parent(node) )
+        route.duration += m_Model.EdgeWeight(m_Backward.ParentEdge(node), m_Profile, RouteModel::Time);
+    double distance = 0.;
+    for( std::size_t i = 1; i < route.path.size(); ++i )
+        distance += m_Model.SNodes()[route.path[i - 1]].distance(nodes[route.path[i]]);
+    route.distance = static_cast<float>(distance * m_Model.MetricScale());
+    const float scale = m_Metric == RouteModel::Distance ? static_cast<float>(m_Model.MetricScale()) : 1.f;
+    route.cost = (m_Forward.G(via) + m_Backward.G(via)) * scale;
+    return route;
+}
+
+bool AlternativeRoutes::LocallyOptimal(const Route &route, std::size_t at, float radius)
+{
+    auto &first_edge = m_Model.FirstEdge();
+    auto &edge_to = m_Model.EdgeTo();
+    auto &edge_weight = m_Model.EdgeWeights(m_Profile, m_Metric);
+    auto step = [&](int a, int b) {
+        float weight = std::numeric_limits<float>::max();
+        for( int e = first_edge[a]; e < first_edge[a + 1]; ++e )
+            if( edge_to[e] == b && m_Model.EdgeAccessible(e, m_Profile) )
+                weight = std::min(weight, edge_weight[e]);
+        return weight;
+    };
+    // go half the radius back and half of it forward from the via node
+    std::size_t first = at, last = at;
+    float back = 0.f, ahead = 0.f;
+    for( ; first > 0 && back < 0.5f * radius; --first )
+        back += step(route.path[first - 1], route.path[first]);
+    for( ; last + 1 < route.path.size() && ahead < 0.5f * radius; ++last )
+        ahead += step(route.path[last], route.path[last + 1]);
+    const float cost = back + ahead;
+    if( first == last )
+        return true;
+    // the part is a best route if a search between its ends finds nothing cheaper
+    const int to = route.path[last];
+    Grow(m_Check, route.path[first], to, cost * (1.f + 1e-5f), nullptr);
+    return m_Check.G(to) >= cost * (1.f - 1e-5f);
+}
+
+const std::vector<AlternativeRoutes::Route> &AlternativeRoutes::Find(const Options &options)
+{
+    m_Routes.clear();
+    if( m_Start < 0 || m_End < 0 )
+        return m_Routes;
+    m_Planner.SetEndpoints(m_Start, m_End);
+    if( !m_Planner.Search() )
+        return m_Routes;
+    const float best = m_Planner.Context().G(m_End);
+    const float scale = m_Metric == RouteModel::Distance ? static_cast<float>(m_Model.MetricScale()) : 1.f;
+    Route first;
+    first.path = m_Planner.GetPath();
+    first.cost = best * scale;
+    first.distance = m_Planner.GetDistance();
+    first.duration = m_Planner.GetDuration();
+    m_Routes.push_back(std::move(first));
+    if( options.max_routes <= 1 || best <= 0.f )
+        return m_Routes;
+
+    const float max_cost = (1.f + options.max_stretch) * best;
+    m_Settled.clear();
+    Grow(m_Forward, m_Start, m_End, max_cost, &m_Settled);
+    Grow(m_Backward, m_End, m_Start, max_cost, nullptr);
+
+    // Find the plateaus: a node continues the plateau of its parent in the forward tree if that parent's
+    // parent in the backward tree is the node itself. The forward tree settled parents before children.
+    auto candidate = [&](int node) {
+        return node >= 0 && m_Forward.Closed(node) && m_Backward.Closed(node) &&
+               m_Forward.G(node) + m_Backward.G(node) <= max_cost;
+    };
+    struct Via {
+        int node;
+        float cost;
+        float plateau;
+    };
+    std::vector<Via> vias;
+    for( int node: m_Settled ) {
+        m_Plateau[node] = 0.f;
+        const int parent = m_Forward.Parent(node);
+        if( candidate(node) && candidate(parent) && m_Backward.Parent(parent) == node )
+            m_Plateau[node] = m_Plateau[parent] + m_Forward.G(node) - m_Forward.G(parent);
+    }
+    for( int node: m_Settled ) {
+        if( !candidate(node) )
+            continue;
+        // only the last node of each plateau, towards the end
+        const int next = m_Backward.Parent(node);
+        if( candidate(next) && m_Forward.Parent(next) == node )
+            continue;
+        vias.push_back({node, m_Forward.G(node) + m_Backward.G(node), m_Plateau[node]});
+    }
+
+    std::unordered_set<std::uint64_t> chosen;
+    for( std::size_t i = 1; i < m_Routes[0].path.size(); ++i )
+        chosen.insert(RoadKey(m_Routes[0].path[i - 1], m_Routes[0].path[i]));
+    // the cost of the parts of the via route that are on chosen routes
+    auto shared = [&](int via) {
+        float cost = 0.f;
+        for( int node = via, parent; (parent = m_Forward.Parent(node)) >= 0; node = parent )
+            if( chosen.count(RoadKey(node, parent)) )
+                cost += m_Forward.G(node) - m_Forward.G(parent);
+        for( int node = via, parent; (parent = m_Backward.Parent(node)) >= 0; node = parent )
+            if( chosen.count(RoadKey(node, parent)) )
+                cost += m_Backward.G(node) - m_Backward.G(parent);
+        return cost;
+    };
+
+    // Choose the admissible via route with the lowest 2 * cost + shared - plateau until there are enough:
+    // short routes that share little and run along a long plateau.
+    std::vector<char> rejected(vias.size(), 0);
+    while( (int)m_Routes.size() < options.max_routes ) {
+        int pick = -1;
+        float pick_score = std::numeric_limits<float>::max(), pick_shared = 0.f;
+        for( std::size_t i = 0; i < vias.size(); ++i ) {
+            if( rejected[i] )
+                continue;
+            const float sharing = shared(vias[i].node);
+            if( sharing > options.max_sharing * best ) {
+                rejected[i] = 1;
+                continue;
+            }
+            const float score = 2.f * vias[i].cost + sharing - vias[i].plateau;
+            if( score < pick_score ) {
+                pick = (int)i;
+                pick_score = score;
+                pick_shared = sharing;
+            }
+        }
+        if( pick < 0 )
+            break;
+        rejected[pick] = 1;
+        Route route = ViaRoute(vias[pick].node);
+        const std::size_t at = std::find(route.path.begin(), route.path.end(), vias[pick].node) - route.path.begin();
+        if( !LocallyOptimal(route, at, options.local_optimality * best) )
+            continue;
+        route.shared = pick_shared / best;
+        for( std::size_t i = 1; i < route.path.size(); ++i )
+            chosen.insert(RoadKey(route.path[i - 1], route.path[i]));
+        m_Routes.push_back(std::move(route));
+    }
+    return m_Routes;
+}
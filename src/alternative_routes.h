@@ -0,0 +1,75 @@
+#ifndef ALTERNATIVE_ROUTES_H
+#define ALTERNATIVE_ROUTES_H
+
+#include <vector>
+#include "route_model.h"
+#include "route_planner.h"
+#include "search_context.h"
+
+// Finds the best route and a few meaningfully different alternatives to it with the via-node method:
+// a Dijkstra from the start and one from the end build two shortest path trees, and every node v that
+// both reach gives the candidate route start -> v -> end along the trees. Candidates through the same
+// plateau (a stretch where the two trees run along the same roads in opposite directions) are the same
+// route, so only one node per plateau is considered, and long plateaus make good alternatives.
+//
+// An alternative is admissible if
+//  - its cost is at most (1 + max_stretch) times the cost of the best route (bounded stretch),
+//  - at most max_sharing times the cost of the best route lies on routes already chosen (limited sharing),
+//  - every part of it up to local_optimality times the cost of the best route is itself a best route,
+//    checked around the via node with one small search (local optimality), so that it has no detours.
+//
+// The searches are pruned to the ellipse of nodes whose cost via the node can be within the stretch, so
+// the work is a small multiple of one A* query. Like a RoutePlanner, an AlternativeRoutes keeps its
+// buffers between queries and only reads the model.
+class AlternativeRoutes {
+  public:
+    struct Options {
+        int max_routes = 3;  // including the best route
+        float max_stretch = 0.25f;
+        float max_sharing = 0.6f;
+        float local_optimality = 0.25f;
+    };
+    struct Route {
+        std::vector<int> path;  // node indices from start to end
+        float cost = 0.f;       // in the unit of the metric: meters (weighted by road type) or seconds
+        float distance = 0.f;   // in meters
+        float duration = 0.f;   // in seconds
+        float shared = 0.f;     // the fraction of the cost of the best route that lies on earlier routes
+    };
+
+    AlternativeRoutes(RouteModel &model, RouteModel::Profile profile = RouteModel::Car, RouteModel::Metric metric = RouteModel::Distance);
+
+    // Set the start and end of the next query, like RoutePlanner::SetEndpoints().
+    void SetEndpoints(float start_x, float start_y, float end_x, float end_y);
+    void SetEndpoints(int start, int end);
+
+    // The best route followed by the admissible alternatives, best first; empty if there is no route.
+    const std::vector<Route> &Find(const Options &options);
+    const std::vector<Route> &Find() { return Find(Options{}); }
+
+  private:
+    // Dijkstra from `from` over the nodes whose cost via the node to `to` can be at most max_cost.
+    void Grow(SearchContext &tree, int from, int to, float max_cost, std::vector<int> *settled);
+    float Heuristic(int a, int b) const;
+    // the route start -> via -> end along the two trees
+    Route ViaRoute(int via) const;
+    // true if the part of the route within `radius` of position `at` (both in cost) is a best route
+    bool LocallyOptimal(const Route &route, std::size_t at, float radius);
+
+    RouteModel &m_Model;
+    RouteModel::Profile m_Profile;
+    RouteModel::Metric m_Metric;
+    float m_HeuristicScale = 1.f;
+    int m_Start = -1;
+    int m_End = -1;
+
+    RoutePlanner m_Planner;
+    SearchContext m_Forward;
+    SearchContext m_Backward;
+    SearchContext m_Check;
+    std::vector<int> m_Settled;  // the nodes settled by the forward search, in order
+    std::vector<float> m_Plateau;  // the length of the plateau up to each settled node
+    std::vector<Route> m_Routes;
+};
+
+#endif
@@ -0,0 +1,240 @@
+#include "contraction_hierarchy.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+
+// a witness search gives up after settling this many nodes and assumes that a shortcut is needed
+static constexpr int WitnessSettleLimit = 500;
+
+// The graph that is left during the contraction: the edges between nodes that have not been contracted
+// yet, one per pair of neighbours with the lowest weight.
+struct ContractionGraph {
+    std::vector<std::vector<ContractionHierarchy::Edge>> edges;
+
+    // Adds the edge from `from` to `to`, or lowers the weight of the one there is.
+    void Add(int from, int to, float weight, int middle) {
+        for( auto &edge: edges[from] )
+            if( edge.to == to ) {
+                if( weight < edge.weight ) {
+                    edge.weight = weight;
+                    edge.middle = middle;
+                }
+                return;
+            }
+        edges[from].push_back({to, weight, middle});
+    }
+    void Remove(int from, int to) {
+        auto &list = edges[from];
+        list.erase(std::remove_if(list.begin(), list.end(), [&](auto &edge) { return edge.to == to; }), list.end());
+    }
+};
+
+// The contraction of one node: whether each pair of its neighbours needs a shortcut. A witness search
+// from one neighbour looks for a route to the others that avoids the node and is no longer than the
+// route through it.
+class Contractor {
+  public:
+    Contractor(ContractionGraph &graph, int n_nodes): m_Graph(graph) {
+        m_Witness.Resize(n_nodes, 0);
+    }
+
+    // Calls add_shortcut(from, to, weight) for each shortcut the contraction of the node needs, once
+    // per pair of neighbours, and returns their number.
+    int Shortcuts(int node, const std::function<void(int, int, float)> &add_shortcut) {
+        const auto &neighbours = m_Graph.edges[node];
+        int count = 0;
+        for( std::size_t i = 0; i + 1 < neighbours.size(); ++i ) {
+            float max_cost = 0.f;
+            for( std::size_t j = i + 1; j < neighbours.size(); ++j )
+                max_cost = std::max(max_cost, neighbours[i].weight + neighbours[j].weight);
+            Witness(neighbours[i].to, node, max_cost);
+            for( std::size_t j = i + 1; j < neighbours.size(); ++j ) {
+                const float via = neighbours[i].weight + neighbours[j].weight;
+                if( m_Witness.G(neighbours[j].to) <= via )
+                    continue;
+                ++count;
+                if( add_shortcut )
+                    add_shortcut(neighbours[i].to, neighbours[j].to, via);
+            }
+        }
+        return count;
+    }
+
+  private:
+    // Dijkstra from source in the remaining graph without `avoid`, up to max_cost.
+    void Witness(int source, int avoid, float max_cost) {
+        m_Witness.Clear();
+        m_Witness.Reach(source, 0.f, -1, -1);
+        m_Witness.Push(source, 0.f);
+        int settled = 0;
+        for( int node = m_Witness.Pop(); node >= 0 && settled < WitnessSettleLimit; node = m_Witness.Pop(), ++settled ) {
+            m_Witness.Close(node);
+            const float g = m_Witness.G(node);
+            if( g > max_cost )
+                break;
+            for( auto &edge: m_Graph.edges[node] ) {
+                const float g_next = g + edge.weight;
+                if( edge.to == avoid || g_next > max_cost || g_next >= m_Witness.G(edge.to) )
+                    continue;
+                m_Witness.Reach(edge.to, g_next, node, -1);
+                m_Witness.Push(edge.to, g_next);
+            }
+        }
+    }
+
+    ContractionGraph &m_Graph;
+    SearchContext m_Witness;
+};
+
+ContractionHierarchy::ContractionHierarchy(const RouteModel &model, RouteModel::Profile profile, RouteModel::Metric metric):
+    m_Profile(profile),
+    m_Metric(metric),
+    m_Version(model.Version()),
+    m_Scale(metric == RouteModel::Distance ? static_cast<float>(model.MetricScale()) : 1.f)
+{
+    const int n = (int)model.FirstEdge().size() - 1;
+    auto &first_edge = model.FirstEdge();
+    auto &edge_to = model.EdgeTo();
+    ContractionGraph graph;
+    graph.edges.resize(n);
+    for( int node = 0; node < n; ++node )
+        for( int e = first_edge[node]; e < first_edge[node + 1]; ++e )
+            if( model.EdgeAccessible(e, profile) && edge_to[e] != node )
+                graph.Add(node, edge_to[e], model.EdgeWeight(e, profile, metric), -1);
+
+    // Nodes are contracted in order of priority: the number of shortcuts their contraction adds minus
+    // the number of edges it removes, plus the number of neighbours already contracted, which spreads
+    // the contraction evenly over the map. Priorities change as the graph does, so a node's priority
+    // is computed again when it comes up, and it is put back if it is no longer the lowest.
+    Contractor contractor{graph, n};
+    std::vector<int> contracted_neighbours(n, 0);
+    auto priority = [&](int node) {
+        return contractor.Shortcuts(node, nullptr) - (int)graph.edges[node].size() + contracted_neighbours[node];
+    };
+    using Entry = std::pair<int, int>;  // priority, node
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    for( int node = 0; node < n; ++node )
+        queue.push({priority(node), node});
+
+    m_Rank.assign(n, -1);
+    std::vector<std::vector<Edge>> up(n);
+    int rank = 0;
+    while( !queue.empty() ) {
+        const int node = queue.top().second;
+        queue.pop();
+        if( m_Rank[node] >= 0 )
+            continue;
+        const int p = priority(node);
+        if( !queue.empty() && p > queue.top().first ) {
+            queue.push({p, node});
+            continue;
+        }
+        m_Rank[node] = rank++;
+        // the remaining neighbours all get a higher rank, so the edges to them are the node's upward edges
+        up[node] = graph.edges[node];
+        std::vector<std::pair<std::pair<int, int>, float>> shortcuts;
+        contractor.Shortcuts(node, [&](int from, int to, float weight) { shortcuts.push_back({{from, to}, weight}); });
+        for( auto &edge: graph.edges[node] ) {
+            graph.Remove(edge.to, node);
+            ++contracted_neighbours[edge.to];
+        }
+        graph.edges[node].clear();
+        graph.edges[node].shrink_to_fit();
+        for( auto &[ends, weight]: shortcuts ) {
+            graph.Add(ends.first, ends.second, weight, node);
+            graph.Add(ends.second, ends.first, weight, node);
+        }
+        m_NumShortcuts += (int)shortcuts.size();
+    }
+
+    m_FirstUp.assign(n + 1, 0);
+    for( int node = 0; node < n; ++node )
+        m_FirstUp[node + 1] = m_FirstUp[node] + (int)up[node].size();
+    m_UpEdges.reserve(m_FirstUp[n]);
+    for( auto &edges: up )
+        m_UpEdges.insert(m_UpEdges.end(), edges.begin(), edges.end());
+}
+
+const ContractionHierarchy::Edge *ContractionHierarchy::FindUpEdge(int from, int to) const
+{
+    for( int e = m_FirstUp[from]; e < m_FirstUp[from + 1]; ++e )
+        if( m_UpEdges[e].to == to )
+            return &m_UpEdges[e];
+    return nullptr;
+}
+
+void ContractionHierarchy::Unpack(int from, int to, std::vector<int> &path) const
+{
+    const Edge *edge = m_Rank[from] < m_Rank[to] ? FindUpEdge(from, to) : FindUpEdge(to, from);
+    if( !edge || edge->middle < 0 ) {
+        path.push_back(to);
+        return;
+    }
+    Unpack(from, edge->middle, path);
+    Unpack(edge->middle, to, path);
+}
+
+ContractionQuery::ContractionQuery(const ContractionHierarchy &hierarchy):
+    m_Hierarchy(hierarchy)
+{
+    m_Forward.Resize(hierarchy.NumNodes(), (int)hierarchy.UpEdges().size());
+    m_Backward.Resize(hierarchy.NumNodes(), (int)hierarchy.UpEdges().size());
+}
+
+float ContractionQuery::Cost(int source, int target)
+{
+    m_Forward.Clear();
+    m_Backward.Clear();
+    m_Meeting = -1;
+    m_Forward.Reach(source, 0.f, -1, -1);
+    m_Forward.Push(source, 0.f);
+    m_Backward.Reach(target, 0.f, -1, -1);
+    m_Backward.Push(target, 0.f);
+
+    auto &first_up = m_Hierarchy.FirstUp();
+    auto &up_edges = m_Hierarchy.UpEdges();
+    float best = ContractionHierarchy::Infinity;
+    // Settle the lower of the two open lists until neither can improve the best meeting point. A node
+    // reached by both searches is a candidate for the highest node of the route.
+    while( std::min(m_Forward.MinKey(), m_Backward.MinKey()) < best ) {
+        const bool forward = m_Forward.MinKey() <= m_Backward.MinKey();
+        auto &search = forward ? m_Forward : m_Backward;
+        auto &other = forward ? m_Backward : m_Forward;
+        const int node = search.Pop();
+        if( node < 0 )
+            continue;
+        search.Close(node);
+        const float g = search.G(node);
+        if( other.Reached(node) && g + other.G(node) < best ) {
+            best = g + other.G(node);
+            m_Meeting = node;
+        }
+        for( int e = first_up[node]; e < first_up[node + 1]; ++e ) {
+            const float g_next = g + up_edges[e].weight;
+            if( g_next >= search.G(up_edges[e].to) )
+                continue;
+            search.Reach(up_edges[e].to, g_next, node, -1);
+            search.Push(up_edges[e].to, g_next);
+        }
+    }
+    return m_Meeting < 0 ? ContractionHierarchy::Infinity : best * m_Hierarchy.Scale();
+}
+
+const std::vector<int> &ContractionQuery::Path()
+{
+    m_Path.clear();
+    if( m_Meeting < 0 )
+        return m_Path;
+    // the upward part from the source to the meeting node, then the downward part to the target
+    std::vector<int> nodes;
+    for( int node = m_Meeting; node >= 0; node = m_Forward.Parent(node) )
+        nodes.push_back(node);
+    std::reverse(nodes.begin(), nodes.end());
+    for( int node = m_Backward.Parent(m_Meeting); node >= 0; node = m_Backward.Parent(node) )
+        nodes.push_back(node);
+    m_Path.push_back(nodes.front());
+    for( std::size_t i = 1; i < nodes.size(); ++i )
+        m_Hierarchy.Unpack(nodes[i - 1], nodes[i], m_Path);
+    return m_Path;
+}
@@ -0,0 +1,90 @@
+#ifndef CONTRACTION_HIERARCHY_H
+#define CONTRACTION_HIERARCHY_H
+
+#include <limits>
+#include <vector>
+#include "route_model.h"
+#include "search_context.h"
+
+// A contraction hierarchy of the road graph of one profile and metric. The nodes are contracted one
+// by one in order of importance (their rank); contracting a node removes it from the graph and adds a
+// shortcut between two of its neighbours wherever the route through the node is the only shortest one.
+// Every shortest route then also exists as a route that first only goes up in rank and then only down,
+// so searches only need the edges that lead up: the upward graph, which is much smaller than what a
+// Dijkstra over the road graph explores.
+//
+// Roads are not directed, and the edge weights are the same both ways, so one upward graph serves
+// searches from the source and from the target. The hierarchy is a snapshot: it has to be rebuilt
+// after the edge weights of the model change (see RouteModel::Version()), or made by a
+// CustomizableHierarchy, which only recomputes the weights.
+class ContractionHierarchy {
+  public:
+    static constexpr float Infinity = std::numeric_limits<float>::max();
+
+    // An edge of the upward graph. A shortcut stands for the two edges from its ends to `middle`; an
+    // edge of the road graph has a middle of -1.
+    struct Edge {
+        int to;
+        float weight;
+        int middle;
+    };
+
+    ContractionHierarchy(const RouteModel &model, RouteModel::Profile profile = RouteModel::Car, RouteModel::Metric metric = RouteModel::Distance);
+
+    int NumNodes() const noexcept { return (int)m_Rank.size(); }
+    RouteModel::Profile Profile() const noexcept { return m_Profile; }
+    RouteModel::Metric Metric() const noexcept { return m_Metric; }
+    // the model version the hierarchy was built for
+    std::uint64_t Version() const noexcept { return m_Version; }
+    // the factor from edge weights to the unit of the metric: meters per map unit for Distance, 1 for Time
+    float Scale() const noexcept { return m_Scale; }
+
+    // the position of the node in the contraction order; higher ranks were contracted later
+    int Rank(int node) const noexcept { return m_Rank[node]; }
+    // the edges from the node to neighbours of higher rank are UpEdges()[FirstUp()[node]] ... UpEdges()[FirstUp()[node + 1] - 1]
+    const std::vector<int> &FirstUp() const noexcept { return m_FirstUp; }
+    const std::vector<Edge> &UpEdges() const noexcept { return m_UpEdges; }
+    int NumShortcuts() const noexcept { return m_NumShortcuts; }
+
+    // Appends the nodes after `from` on the edge between `from` and `to` (up or down), unpacking shortcuts.
+    void Unpack(int from, int to, std::vector<int> &path) const;
+
+  private:
+    friend class CustomizableHierarchy;
+    ContractionHierarchy(RouteModel::Profile profile, RouteModel::Metric metric, std::uint64_t version, float scale):
+        m_Profile(profile), m_Metric(metric), m_Version(version), m_Scale(scale) {}
+
+    const Edge *FindUpEdge(int from, int to) const;
+
+    RouteModel::Profile m_Profile;
+    RouteModel::Metric m_Metric;
+    std::uint64_t m_Version;
+    float m_Scale;
+    std::vector<int> m_Rank;
+    std::vector<int> m_FirstUp;
+    std::vector<Edge> m_UpEdges;
+    int m_NumShortcuts = 0;
+};
+
+// Point-to-point queries on a contraction hierarchy: an upward search from each end, which meet at the
+// highest node of the best route. Like a RoutePlanner, a ContractionQuery keeps its scratch buffers
+// between queries; each thread needs its own.
+class ContractionQuery {
+  public:
+    explicit ContractionQuery(const ContractionHierarchy &hierarchy);
+
+    // The cost of the best route between two nodes in the unit of the metric (the weighted length in
+    // meters for Distance, seconds for Time), or Infinity if there is none.
+    float Cost(int source, int target);
+    // The nodes of the best route found by the last Cost(), with the shortcuts unpacked; empty if there is none.
+    const std::vector<int> &Path();
+
+  private:
+    const ContractionHierarchy &m_Hierarchy;
+    SearchContext m_Forward;
+    SearchContext m_Backward;
+    int m_Meeting = -1;
+    std::vector<int> m_Path;
+};
+
+#endif
@@ -0,0 +1,268 @@
+#include "customizable_hierarchy.h"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <thread>
+
+// cells of the nested dissection with at most this many nodes are not split further
+static constexpr int DissectionLeafSize = 8;
+
+CustomizableHierarchy::CustomizableHierarchy(const RouteModel &model, RouteModel::Profile profile):
+    m_Model(model),
+    m_Profile(profile)
+{
+    const int n = (int)model.FirstEdge().size() - 1;
+    auto &first_edge = model.FirstEdge();
+    auto &edge_to = model.EdgeTo();
+    std::vector<std::vector<int>> neighbours(n);
+    for( int node = 0; node < n; ++node ) {
+        for( int e = first_edge[node]; e < first_edge[node + 1]; ++e )
+            if( model.EdgeAccessible(e, profile) && edge_to[e] != node )
+                neighbours[node].push_back(edge_to[e]);
+        std::sort(neighbours[node].begin(), neighbours[node].end());
+        neighbours[node].erase(std::unique(neighbours[node].begin(), neighbours[node].end()), neighbours[node].end());
+    }
+    OrderNodes(neighbours);
+
+    // Contract the nodes in order of rank, joining all higher neighbours of each. It is enough to add
+    // them to the lowest of them: when that one is contracted, they are passed on to its lowest higher
+    // neighbour, and so on.
+    auto by_rank = [&](int a, int b) { return m_Rank[a] < m_Rank[b]; };
+    std::vector<std::vector<int>> up(n);
+    std::vector<int> order(n);
+    for( int node = 0; node < n; ++node ) {
+        order[m_Rank[node]] = node;
+        for( int next: neighbours[node] )
+            if( m_Rank[next] > m_Rank[node] )
+                up[node].push_back(next);
+        std::sort(up[node].begin(), up[node].end(), by_rank);
+    }
+    std::vector<int> merged;
+    for( int node: order ) {
+        if( up[node].size() < 2 )
+            continue;
+        auto &lowest = up[up[node].front()];
+        merged.clear();
+        std::set_union(lowest.begin(), lowest.end(), up[node].begin() + 1, up[node].end(), std::back_inserter(merged), by_rank);
+        lowest.swap(merged);
+    }
+
+    m_FirstUp.assign(n + 1, 0);
+    for( int node = 0; node < n; ++node )
+        m_FirstUp[node + 1] = m_FirstUp[node] + (int)up[node].size();
+    m_UpTo.reserve(m_FirstUp[n]);
+    for( auto &edges: up )
+        m_UpTo.insert(m_UpTo.end(), edges.begin(), edges.end());
+
+    // the downward edges, and the road graph edges behind the upward edges
+    m_FirstDown.assign(n + 1, 0);
+    for( int to: m_UpTo )
+        ++m_FirstDown[to + 1];
+    for( int node = 0; node < n; ++node )
+        m_FirstDown[node + 1] += m_FirstDown[node];
+    m_DownEdge.resize(m_UpTo.size());
+    m_DownFrom.resize(m_UpTo.size());
+    std::vector<int> next(m_FirstDown.begin(), m_FirstDown.end() - 1);
+    std::vector<char> is_road(m_UpTo.size(), 0);
+    for( int node = 0; node < n; ++node ) {
+        for( int k = m_FirstUp[node]; k < m_FirstUp[node + 1]; ++k ) {
+            m_DownEdge[next[m_UpTo[k]]] = k;
+            m_DownFrom[next[m_UpTo[k]]++] = node;
+        }
+        for( int e = first_edge[node]; e < first_edge[node + 1]; ++e ) {
+            const int to = edge_to[e];
+            if( !model.EdgeAccessible(e, profile) || m_Rank[to] <= m_Rank[node] )
+                continue;
+            auto begin = m_UpTo.begin() + m_FirstUp[node], end = m_UpTo.begin() + m_FirstUp[node + 1];
+            const int k = int(std::lower_bound(begin, end, to, by_rank) - m_UpTo.begin());
+            m_RoadEdge.push_back({e, k});
+            is_road[k] = 1;
+        }
+    }
+    m_NumShortcuts = (int)std::count(is_road.begin(), is_road.end(), 0);
+
+    // A node's level is one more than the highest level of its lower neighbours. The nodes of level 0
+    // have no lower neighbours, so there is nothing to customize: the schedule starts at level 1.
+    std::vector<int> level(n, 0);
+    int n_levels = 1;
+    for( int node: order )
+        for( int k = m_FirstUp[node]; k < m_FirstUp[node + 1]; ++k ) {
+            level[m_UpTo[k]] = std::max(level[m_UpTo[k]], level[node] + 1);
+            n_levels = std::max(n_levels, level[m_UpTo[k]] + 1);
+        }
+    m_FirstOfLevel.assign(n_levels, 0);
+    for( int node = 0; node < n; ++node )
+        if( level[node] > 0 )
+            ++m_FirstOfLevel[level[node]];
+    for( int l = 1; l < n_levels; ++l )
+        m_FirstOfLevel[l] += m_FirstOfLevel[l - 1];
+    m_LevelNodes.resize(m_FirstOfLevel.back());
+    next.assign(m_FirstOfLevel.begin(), m_FirstOfLevel.end() - 1);
+    for( int node = 0; node < n; ++node )
+        if( level[node] > 0 )
+            m_LevelNodes[next[level[node] - 1]++] = node;
+}
+
+// Nested dissection: nodes without roads get the lowest ranks, then the cells are split recursively and
+// each separator ranks above the two halves it separates.
+void CustomizableHierarchy::OrderNodes(const std::vector<std::vector<int>> &neighbours)
+{
+    const int n = (int)neighbours.size();
+    auto &nodes = m_Model.Nodes();
+    m_Rank.assign(n, -1);
+    std::vector<int> cell;
+    int low = 0;
+    for( int node = 0; node < n; ++node )
+        if( neighbours[node].empty() )
+            m_Rank[node] = low++;
+        else
+            cell.push_back(node);
+
+    std::vector<char> side(n, 0);  // 1 or 2 for the halves of the cell being split
+    // ranks lo ... hi - 1 go to the nodes of the cell
+    auto dissect = [&](auto &self, std::vector<int> &cell, int lo, int hi) -> void {
+        if( (int)cell.size() <= DissectionLeafSize ) {
+            for( int node: cell )
+                m_Rank[node] = lo++;
+            return;
+        }
+        double min_x = nodes[cell[0]].x, max_x = min_x, min_y = nodes[cell[0]].y, max_y = min_y;
+        for( int node: cell ) {
+            min_x = std::min(min_x, nodes[node].x);
+            max_x = std::max(max_x, nodes[node].x);
+            min_y = std::min(min_y, nodes[node].y);
+            max_y = std::max(max_y, nodes[node].y);
+        }
+        const bool along_x = max_x - min_x >= max_y - min_y;
+        auto middle = cell.begin() + cell.size() / 2;
+        std::nth_element(cell.begin(), middle, cell.end(), [&](int a, int b) {
+            return along_x ? nodes[a].x < nodes[b].x : nodes[a].y < nodes[b].y;
+        });
+        for( auto it = cell.begin(); it != cell.end(); ++it )
+            side[*it] = it < middle ? 1 : 2;
+
+        // the separator is the smaller of the two sets of nodes with a road across the split
+        std::vector<int> separator[2];
+        for( int node: cell )
+            for( int next: neighbours[node] )
+                if( side[next] && side[next] != side[node] ) {
+                    separator[side[node] - 1].push_back(node);
+                    break;
+                }
+        auto &chosen = separator[0].size() <= separator[1].size() ? separator[0] : separator[1];
+        for( std::size_t i = 0; i < chosen.size(); ++i ) {
+            m_Rank[chosen[i]] = hi - (int)chosen.size() + (int)i;
+            side[chosen[i]] = 0;
+        }
+        std::vector<int> halves[2];
+        for( int node: cell )
+            if( side[node] ) {
+                halves[side[node] - 1].push_back(node);
+                side[node] = 0;
+            }
+        cell.clear();
+        cell.shrink_to_fit();
+        const int split = lo + (int)halves[0].size();
+        self(self, halves[0], lo, split);
+        self(self, halves[1], split, split + (int)halves[1].size());
+    };
+    dissect(dissect, cell, low, n);
+}
+
+// Lowers the weights of the upward edges of a node to the cheapest routes through its lower
+// neighbours, whose edges are final. For a lower neighbour v, the higher neighbours of v above the
+// node are all higher neighbours of the node too; both lists are in order of rank, so they are merged.
+void CustomizableHierarchy::CustomizeNode(int node, std::vector<ContractionHierarchy::Edge> &edges) const
+{
+    const int up_begin = m_FirstUp[node], up_end = m_FirstUp[node + 1];
+    for( int d = m_FirstDown[node]; d < m_FirstDown[node + 1]; ++d ) {
+        const int down = m_DownEdge[d];
+        const float to_node = edges[down].weight;
+        if( to_node == std::numeric_limits<float>::infinity() )
+            continue;
+        const int lower = m_DownFrom[d];
+        for( int i = down + 1, j = up_begin; i < m_FirstUp[lower + 1] && j < up_end; ) {
+            const int rank_i = m_Rank[m_UpTo[i]], rank_j = m_Rank[m_UpTo[j]];
+            if( rank_i < rank_j )
+                ++i;
+            else if( rank_i > rank_j )
+                ++j;
+            else {
+                const float via = to_node + edges[i].weight;
+                if( via < edges[j].weight ) {
+                    edges[j].weight = via;
+                    edges[j].middle = lower;
+                }
+                ++i;
+                ++j;
+            }
+        }
+    }
+}
+
+std::shared_ptr<const ContractionHierarchy> CustomizableHierarchy::Customize(const std::vector<float> &edge_weights, RouteModel::Metric metric, int n_threads) const
+{
+    const float scale = metric == RouteModel::Distance ? static_cast<float>(m_Model.MetricScale()) : 1.f;
+    std::shared_ptr<ContractionHierarchy> hierarchy{new ContractionHierarchy(m_Profile, metric, m_Model.Version(), scale)};
+    hierarchy->m_Rank = m_Rank;
+    hierarchy->m_FirstUp = m_FirstUp;
+    hierarchy->m_NumShortcuts = m_NumShortcuts;
+    auto &edges = hierarchy->m_UpEdges;
+    edges.resize(m_UpTo.size());
+    for( std::size_t k = 0; k < m_UpTo.size(); ++k )
+        edges[k] = {m_UpTo[k], std::numeric_limits<float>::infinity(), -1};
+    for( auto [e, k]: m_RoadEdge )
+        edges[k].weight = std::min(edges[k].weight, edge_weights[e]);
+
+    if( n_threads <= 0 )
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    for( int l = 0; l < NumLevels(); ++l ) {
+        const int first = m_FirstOfLevel[l], last = m_FirstOfLevel[l + 1];
+        if( !Parallel(l, n_threads) ) {
+            for( int i = first; i < last; ++i )
+                CustomizeNode(m_LevelNodes[i], edges);
+            continue;
+        }
+        // the nodes of a level only write their own edges, so they can be taken in any order
+        std::atomic<int> next{first};
+        std::vector<std::thread> threads;
+        for( int t = 0; t < n_threads; ++t )
+            threads.emplace_back([&] {
+                for( int i = next++; i < last; i = next++ )
+                    CustomizeNode(m_LevelNodes[i], edges);
+            });
+        for( auto &thread: threads )
+            thread.join();
+    }
+    return hierarchy;
+}
+
+std::shared_ptr<const ContractionHierarchy> CustomizableHierarchy::Customize(RouteModel::Metric metric, int n_threads) const
+{
+    return Customize(m_Model.EdgeWeights(m_Profile, metric), metric, n_threads);
+}
+
+int CustomizableHierarchy::NumParallelLevels(int n_threads) const
+{
+    if( n_threads <= 0 )
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    int n_parallel = 0;
+    for( int l = 0; l < NumLevels(); ++l )
+        n_parallel += Parallel(l, n_threads);
+    return n_parallel;
+}
+
+bool CustomizableHierarchy::Parallel(int level, int n_threads) const
+{
+    return n_threads > 1 && m_FirstOfLevel[level + 1] - m_FirstOfLevel[level] >= m_ParallelLevelSize;
+}
+
+std::shared_ptr<const ContractionHierarchy> CustomizableHierarchy::Current() const
+{
+    return std::atomic_load(&m_Current);
+}
+
+void CustomizableHierarchy::Publish(std::shared_ptr<const ContractionHierarchy> hierarchy)
+{
+    std::atomic_store(&m_Current, std::move(hierarchy));
+}
@@ -0,0 +1,85 @@
+#ifndef CUSTOMIZABLE_HIERARCHY_H
+#define CUSTOMIZABLE_HIERARCHY_H
+
+#include <memory>
+#include <vector>
+#include "contraction_hierarchy.h"
+#include "route_model.h"
+
+// A customizable contraction hierarchy: a ContractionHierarchy whose node order and upward graph do not
+// depend on the edge weights, so that new weights (e.g. travel times from live traffic) only need a
+// quick customization instead of a new contraction.
+//
+// The preprocessing, done once per profile, orders the nodes by nested dissection: the map is split in
+// two halves along its longer side, the nodes on the roads across the split (the separator) get the
+// highest ranks, and both halves are ordered the same way. Then every node is contracted without
+// witness searches: all its higher neighbours are joined by shortcuts. Small separators keep the number
+// of shortcuts low.
+//
+// The customization gives each upward edge the weight of its road, if it is one, and then lowers it to
+// the cheapest route through a lower node (a lower triangle), from the lowest nodes up. The nodes of
+// one level (all of whose lower neighbours are on lower levels) are independent of each other and are
+// customized in parallel. Nodes without lower neighbours (level 0) have nothing to customize and are
+// left out, so the levels counted here start with the first one above them.
+//
+// Each customization makes a new ContractionHierarchy, which queries (ContractionQuery, Phast) use like
+// one made by contraction. Publish() swaps it in atomically: a query that took the previous one with
+// Current() keeps using it until it lets go of it, and new queries get the new one.
+class CustomizableHierarchy {
+  public:
+    explicit CustomizableHierarchy(const RouteModel &model, RouteModel::Profile profile = RouteModel::Car);
+
+    int NumNodes() const noexcept { return (int)m_Rank.size(); }
+    int NumUpEdges() const noexcept { return (int)m_UpTo.size(); }
+    // the levels of nodes with lower neighbours
+    int NumLevels() const noexcept { return (int)m_FirstOfLevel.size() - 1; }
+    // the upward edges that are not roads
+    int NumShortcuts() const noexcept { return m_NumShortcuts; }
+    RouteModel::Profile Profile() const noexcept { return m_Profile; }
+
+    // A hierarchy for the given weight of each edge of the road graph (in the order of
+    // RouteModel::EdgeTo(), in the unit of the metric), computed on n_threads threads (the number of
+    // hardware threads if 0). Edges the profile may not use are left out. Like the hierarchy, the weights
+    // have to be the same in both directions of a road.
+    std::shared_ptr<const ContractionHierarchy> Customize(const std::vector<float> &edge_weights, RouteModel::Metric metric, int n_threads = 0) const;
+    // The same for the current weights of the model.
+    std::shared_ptr<const ContractionHierarchy> Customize(RouteModel::Metric metric, int n_threads = 0) const;
+
+    // Levels with fewer nodes than this are customized on the calling thread, as starting threads would
+    // take longer than the level itself.
+    void SetParallelLevelSize(int n_nodes) noexcept { m_ParallelLevelSize = n_nodes; }
+    // The number of levels Customize() runs on n_threads threads (the number of hardware threads if 0).
+    int NumParallelLevels(int n_threads = 0) const;
+
+    // The hierarchy queries should use, or nullptr before the first Publish(). Safe to call from any thread.
+    std::shared_ptr<const ContractionHierarchy> Current() const;
+    void Publish(std::shared_ptr<const ContractionHierarchy> hierarchy);
+
+  private:
+    void OrderNodes(const std::vector<std::vector<int>> &neighbours);
+    void CustomizeNode(int node, std::vector<ContractionHierarchy::Edge> &edges) const;
+    bool Parallel(int level, int n_threads) const;
+
+    const RouteModel &m_Model;
+    RouteModel::Profile m_Profile;
+    std::vector<int> m_Rank;
+    // the upward graph: the edges of node v lead to m_UpTo[m_FirstUp[v]] ... in order of rank
+    std::vector<int> m_FirstUp;
+    std::vector<int> m_UpTo;
+    // the downward edges into each node, as the indices of the upward edges from the lower nodes
+    std::vector<int> m_FirstDown;
+    std::vector<int> m_DownEdge;
+    std::vector<int> m_DownFrom;
+    // the road graph edge behind each upward edge: for each road graph edge the profile may use from a
+    // lower to a higher node, the upward edge it belongs to
+    std::vector<std::pair<int, int>> m_RoadEdge;  // road graph edge, upward edge
+    // the nodes by level, lowest level first
+    std::vector<int> m_LevelNodes;
+    std::vector<int> m_FirstOfLevel;
+    int m_NumShortcuts = 0;
+    int m_ParallelLevelSize = 256;
+
+    std::shared_ptr<const ContractionHierarchy> m_Current;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include "facility_search.h"
+#include <algorithm>
+
+FacilitySearch::FacilitySearch(RouteModel &model, RouteModel::Profile profile, RouteModel::Metric metric):
+    m_Model(model),
+    m_Profile(profile),
+    m_Metric(metric)
+{
+    // snap each point of interest to the largest connected part of the road graph, so that it can be
+    // reached from any start that RoutePlanner would use
+    const int n_nodes = (int)m_Model.SNodes().size();
+    auto &pois = m_Model.Pois();
+    m_PoiNode.resize(pois.size());
+    m_FirstPoiAt.assign(n_nodes + 1, 0);
+    // if there is no road to snap to, the points are left out
+    for( std::size_t i = 0; i < pois.size(); ++i ) {
+        m_PoiNode[i] = m_Model.ClosestNodeIndex(pois[i].position.x, pois[i].position.y, m_Profile, true);
+        if( m_PoiNode[i] >= 0 )
+            ++m_FirstPoiAt[m_PoiNode[i] + 1];
+    }
+    for( int node = 0; node < n_nodes; ++node )
+        m_FirstPoiAt[node + 1] += m_FirstPoiAt[node];
+    m_PoiAt.resize(m_FirstPoiAt[n_nodes]);
+    std::vector<int> next(m_FirstPoiAt.begin(), m_FirstPoiAt.end() - 1);
+    for( std::size_t i = 0; i < pois.size(); ++i )
+        if( m_PoiNode[i] >= 0 )
+            m_PoiAt[next[m_PoiNode[i]]++] = (int)i;
+    m_Context.Resize(n_nodes, (int)m_Model.EdgeTo().size());
+}
+
+int FacilitySearch::Snap(float x, float y)
+{
+    return m_Model.ClosestNodeIndex(x * 0.01f, y * 0.01f, m_Profile, true);
+}
+
+const std::vector<FacilitySearch::Facility> &FacilitySearch::Nearest(int source, int k, int kind)
+{
+    m_Found.clear();
+    auto &pois = m_Model.Pois();
+    auto &first_poi = m_Model.FirstPoi();
+    // there is no point in searching on once every point of the kind has been found
+    const int n_matching = kind < 0 ? (int)pois.size() : first_poi[kind + 1] - first_poi[kind];
+    k = std::min(k, n_matching);
+    if( source < 0 || k <= 0 )
+        return m_Found;
+
+    auto &first_edge = m_Model.FirstEdge();
+    auto &edge_to = m_Model.EdgeTo();
+    auto &edge_weight = m_Model.EdgeWeights(m_Profile, m_Metric);
+    const float scale = m_Metric == RouteModel::Distance ? static_cast<float>(m_Model.MetricScale()) : 1.f;
+    m_Context.Clear();
+    m_Context.Reach(source, 0.f, -1, -1);
+    m_Context.Push(source, 0.f);
+    for( int node = m_Context.Pop(); node >= 0; node = m_Context.Pop() ) {
+        m_Context.Close(node);
+        const float g = m_Context.G(node);
+        // the points at a settled node are the next nearest ones
+        for( int i = m_FirstPoiAt[node]; i < m_FirstPoiAt[node + 1] && (int)m_Found.size() < k; ++i )
+            if( kind < 0 || pois[m_PoiAt[i]].kind == kind )
+                m_Found.push_back({m_PoiAt[i], node, g * scale, 0.f});
+        if( (int)m_Found.size() == k )
+            break;
+        for( int e = first_edge[node]; e < first_edge[node + 1]; ++e ) {
+            if( !m_Model.EdgeAccessible(e, m_Profile) )
+                continue;
+            const float g_next = g + edge_weight[e];
+            if( g_next >= m_Context.G(edge_to[e]) )
+                continue;
+            m_Context.Reach(edge_to[e], g_next, node, e);
+            m_Context.Push(edge_to[e], g_next);
+        }
+    }
+
+    for( auto &facility: m_Found ) {
+        double distance = 0.;
+        for( int node = facility.node, parent; (parent = m_Context.Parent(node)) >= 0; node = parent )
+            distance += m_Model.SNodes()[node].distance(m_Model.SNodes()[parent]);
+        facility.distance = static_cast<float>(distance * m_Model.MetricScale());
+    }
+    return m_Found;
+}
+
+std::vector<int> FacilitySearch::Path(const Facility &facility) const
+{
+    std::vector<int> path;
+    for( int node = facility.node; node >= 0; node = m_Context.Parent(node) )
+        path.push_back(node);
+    std::reverse(path.begin(), path.end());
+    return path;
+}
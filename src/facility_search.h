@@ -0,0 +1,50 @@
+#ifndef FACILITY_SEARCH_H
+#define FACILITY_SEARCH_H
+
+#include <vector>
+#include "route_model.h"
+#include "search_context.h"
+
+// Finds the points of interest of the model (see Model::Pois()) that are nearest to a node by road,
+// e.g. the five nearest parking lots. Every point of interest is snapped once to the closest node of
+// the profile's road graph; a query is then a single Dijkstra from the source that stops as soon as k
+// matching points have been settled, so it costs about as much as one short route search instead of
+// one search per candidate.
+//
+// Like a RoutePlanner, a FacilitySearch keeps its scratch buffers between queries and only reads the
+// model.
+class FacilitySearch {
+  public:
+    struct Facility {
+        int poi;         // index into Model::Pois()
+        int node;        // the node it was snapped to
+        float cost;      // in the unit of the metric: meters (weighted by road type) or seconds
+        float distance;  // along the roads, in meters
+    };
+
+    FacilitySearch(RouteModel &model, RouteModel::Profile profile = RouteModel::Car, RouteModel::Metric metric = RouteModel::Distance);
+
+    // The node a query from (x, y) (in percent of the map) starts from, like RoutePlanner::SetEndpoints().
+    int Snap(float x, float y);
+
+    // The k points of interest of the given kind (an index into Model::AmenityKinds(), or -1 for any)
+    // that are nearest to the source by road, nearest first. Fewer are returned if fewer can be reached.
+    // The result stays valid until the next query.
+    const std::vector<Facility> &Nearest(int source, int k, int kind = -1);
+
+    // The route from the source of the last query to a facility it found, as node indices.
+    std::vector<int> Path(const Facility &facility) const;
+
+  private:
+    RouteModel &m_Model;
+    RouteModel::Profile m_Profile;
+    RouteModel::Metric m_Metric;
+    // the points of interest at each node, in compressed sparse row form like the road graph
+    std::vector<int> m_FirstPoiAt;
+    std::vector<int> m_PoiAt;
+    std::vector<int> m_PoiNode;
+    SearchContext m_Context;
+    std::vector<Facility> m_Found;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#include "headless.h"
+#include <iostream>
+#include <system_error>
+#include <utility>
+
+io2d::image_surface SurfacePool::Acquire(int width, int height)
+{
+    std::lock_guard<std::mutex> lock{m_Mutex};
+    for( auto it = m_Free.begin(); it != m_Free.end(); ++it )
+        if( it->dimensions().x() == width && it->dimensions().y() == height ) {
+            auto surface = std::move(*it);
+            m_Free.erase(it);
+            return surface;
+        }
+    return io2d::image_surface{io2d::format::argb32, width, height};
+}
+
+void SurfacePool::Release(io2d::image_surface surface)
+{
+    std::lock_guard<std::mutex> lock{m_Mutex};
+    m_Free.push_back(std::move(surface));
+}
+
+HeadlessRenderer::HeadlessRenderer(RouteModel &model, SurfacePool &pool, int width, int height):
+    m_Model(model),
+    m_Pool(pool),
+    m_Width(width),
+    m_Height(height),
+    m_Render(model)
+{
+}
+
+bool HeadlessRenderer::Snapshot(const std::vector<int> &path, const std::string &file)
+{
+    Box box;
+    for( int node_idx: path )
+        box.Extend(m_Model.Nodes()[node_idx].x, m_Model.Nodes()[node_idx].y);
+    if( box.Empty() )
+        m_Render.SetView(0.5f, 0.5f, 1.f);
+    else
+        m_Render.FitView(box);
+    m_Model.path = path;
+
+    // Each snapshot has its own view, so the map is drawn straight onto the pooled surface: Display()
+    // would also allocate a basemap bitmap of the full size and draw the map twice. The background is
+    // painted first, so a reused surface does not need to be cleared.
+    auto surface = m_Pool.Acquire(m_Width, m_Height);
+    m_Render.DisplayOnce(surface);
+    bool saved = true;
+    try {
+        surface.save(file, io2d::image_file_format::png);
+    }
+    catch( const std::system_error &e ) {
+        std::cout << "Failed to write " << file << ": " << e.what() << std::endl;
+        saved = false;
+    }
+    m_Pool.Release(std::move(surface));
+    return saved;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <io2d.h>
+#include "render.h"
+#include "route_model.h"
+
+using namespace std::experimental;
+
+// Offscreen surfaces that are handed out and returned, so that batch jobs reuse a few surfaces
+// instead of creating one per image. Safe to share between threads.
+class SurfacePool
+{
+public:
+    // Returns a surface of the given size: a released one if there is one, otherwise a new one.
+    io2d::image_surface Acquire(int width, int height);
+    // Gives the surface back to the pool.
+    void Release(io2d::image_surface surface);
+
+private:
+    std::mutex m_Mutex;
+    std::vector<io2d::image_surface> m_Free;
+};
+
+// Draws routes on the map into offscreen surfaces and saves them as PNG files, without a window or a
+// display server. A HeadlessRenderer sets the route of the model it draws, so it must not share its
+// model with a viewer or with another HeadlessRenderer that runs at the same time.
+class HeadlessRenderer
+{
+public:
+    HeadlessRenderer(RouteModel &model, SurfacePool &pool, int width = 256, int height = 256);
+
+    // Draws the route (node indices of the model), zoomed to fit, and writes the image to file.
+    // An empty route is drawn on the whole map. Returns false if the file could not be written.
+    bool Snapshot(const std::vector<int> &path, const std::string &file);
+
+private:
+    RouteModel &m_Model;
+    SurfacePool &m_Pool;
+    int m_Width;
+    int m_Height;
+    Render m_Render;
+};
@@ -0,0 +1,273 @@
+#include "isochrone.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <unordered_map>
+
+IsochroneSearch::IsochroneSearch(RouteModel &model, RouteModel::Profile profile, RouteModel::Metric metric):
+    m_Model(model),
+    m_Profile(profile),
+    m_Metric(metric)
+{
+    m_Context.Resize((int)m_Model.SNodes().size(), (int)m_Model.EdgeTo().size());
+}
+
+int IsochroneSearch::Snap(float x, float y)
+{
+    return m_Model.ClosestNodeIndex(x * 0.01f, y * 0.01f, m_Profile, true);
+}
+
+float IsochroneSearch::Cost(int e) const noexcept
+{
+    if( m_Metric == RouteModel::Time )
+        return m_Model.EdgeWeight(e, m_Profile, RouteModel::Time);
+    return m_Model.EdgeLength()[e] * static_cast<float>(m_Model.MetricScale());
+}
+
+const std::vector<Isochrone::Reached> &IsochroneSearch::Search(int source, float budget)
+{
+    m_Source = source;
+    m_Budget = budget;
+    m_Reached.clear();
+    m_Context.Clear();
+    if( source < 0 )
+        return m_Reached;
+    m_Context.Reach(source, 0.f, -1, -1);
+    m_Context.Push(source, 0.f);
+
+    auto &first_edge = m_Model.FirstEdge();
+    auto &edge_to = m_Model.EdgeTo();
+    // Dijkstra: nodes are settled in order of cost, and nodes beyond the budget are never queued
+    for( int node = m_Context.Pop(); node >= 0; node = m_Context.Pop() ) {
+        m_Context.Close(node);
+        const float g = m_Context.G(node);
+        m_Reached.push_back({node, g});
+        for( int e = first_edge[node]; e < first_edge[node + 1]; ++e ) {
+            if( !m_Model.EdgeAccessible(e, m_Profile) )
+                continue;
+            const int next = edge_to[e];
+            const float g_next = g + Cost(e);
+            if( g_next > budget || (m_Context.Reached(next) && g_next >= m_Context.G(next)) )
+                continue;
+            m_Context.Reach(next, g_next, node, e);
+            m_Context.Push(next, g_next);
+        }
+    }
+    return m_Reached;
+}
+
+// the most cells the grid of Area() may have, about; the cells are made larger if needed
+static constexpr double MaxAreaCells = 4e6;
+
+// The cells of the area grid; cell (i, j) covers [x0 + i * size, x0 + (i + 1) * size) and likewise in y.
+struct AreaGrid {
+    double x0, y0, size;
+    int width, height;
+    std::vector<char> cells;
+
+    char &At(int i, int j) { return cells[j * width + i]; }
+    char Get(int i, int j) const { return i >= 0 && j >= 0 && i < width && j < height ? cells[j * width + i] : 0; }
+    void Mark(double x, double y) {
+        At(int((x - x0) / size), int((y - y0) / size)) = 1;
+    }
+    // Sets every cell that has a marked cell among its 8 neighbours (grow) or every cell that has an
+    // unmarked one (shrink) to the opposite value.
+    void Morph(bool grow) {
+        auto copy = cells;
+        for( int j = 0; j < height; ++j )
+            for( int i = 0; i < width; ++i ) {
+                bool any = false;
+                for( int dj = -1; dj <= 1 && !any; ++dj )
+                    for( int di = -1; di <= 1 && !any; ++di )
+                        any = (Get(i + di, j + dj) != 0) == grow;
+                if( any )
+                    copy[j * width + i] = grow;
+            }
+        cells = std::move(copy);
+    }
+    // Marks the unmarked cells that can not be reached from the border of the grid.
+    void FillHoles() {
+        std::vector<char> outside(cells.size(), 0);
+        std::vector<int> stack;
+        auto visit = [&](int i, int j) {
+            if( i < 0 || j < 0 || i >= width || j >= height || cells[j * width + i] || outside[j * width + i] )
+                return;
+            outside[j * width + i] = 1;
+            stack.push_back(j * width + i);
+        };
+        for( int i = 0; i < width; ++i ) {
+            visit(i, 0);
+            visit(i, height - 1);
+        }
+        for( int j = 0; j < height; ++j ) {
+            visit(0, j);
+            visit(width - 1, j);
+        }
+        while( !stack.empty() ) {
+            const int c = stack.back();
+            stack.pop_back();
+            const int i = c % width, j = c / width;
+            visit(i - 1, j);
+            visit(i + 1, j);
+            visit(i, j - 1);
+            visit(i, j + 1);
+        }
+        for( std::size_t c = 0; c < cells.size(); ++c )
+            cells[c] = !outside[c];
+    }
+};
+
+std::vector<Isochrone::Ring> IsochroneSearch::Area(float cell_size) const
+{
+    std::vector<Isochrone::Ring> rings;
+    if( m_Reached.empty() || cell_size <= 0.f )
+        return rings;
+    auto &nodes = m_Model.Nodes();
+    auto &first_edge = m_Model.FirstEdge();
+    auto &edge_to = m_Model.EdgeTo();
+
+    // the grid covers the reached nodes and the roads leaving them, with a margin of two cells so that
+    // growing the area never reaches the border
+    double min_x = nodes[m_Source].x, max_x = min_x, min_y = nodes[m_Source].y, max_y = min_y;
+    for( auto &reached: m_Reached )
+        for( int e = first_edge[reached.node]; e < first_edge[reached.node + 1]; ++e )
+            for( int node: {reached.node, edge_to[e]} ) {
+                min_x = std::min(min_x, nodes[node].x);
+                max_x = std::max(max_x, nodes[node].x);
+                min_y = std::min(min_y, nodes[node].y);
+                max_y = std::max(max_y, nodes[node].y);
+            }
+    AreaGrid grid;
+    grid.size = cell_size;
+    // a large area with small cells would take a lot of memory; coarser cells are enough for it
+    while( (max_x - min_x) * (max_y - min_y) > MaxAreaCells * grid.size * grid.size )
+        grid.size *= 2;
+    grid.x0 = min_x - 2 * grid.size;
+    grid.y0 = min_y - 2 * grid.size;
+    grid.width = int((max_x - grid.x0) / grid.size) + 3;
+    grid.height = int((max_y - grid.y0) / grid.size) + 3;
+    grid.cells.assign(std::size_t(grid.width) * grid.height, 0);
+
+    // mark the reachable part of every road leaving a reached node, at half cell steps
+    for( auto &reached: m_Reached ) {
+        const auto &from = nodes[reached.node];
+        grid.Mark(from.x, from.y);
+        const float left = m_Budget - reached.cost;
+        for( int e = first_edge[reached.node]; e < first_edge[reached.node + 1]; ++e ) {
+            if( !m_Model.EdgeAccessible(e, m_Profile) )
+                continue;
+            const float cost = Cost(e);
+            const double t = cost > 0.f ? std::min(1.f, left / cost) : 1.;
+            const auto &to = nodes[edge_to[e]];
+            const double dx = (to.x - from.x) * t, dy = (to.y - from.y) * t;
+            const int steps = int(std::ceil(std::sqrt(dx * dx + dy * dy) / (0.5 * grid.size)));
+            for( int k = 1; k <= steps; ++k )
+                grid.Mark(from.x + dx * k / steps, from.y + dy * k / steps);
+        }
+    }
+    // close gaps of one cell between roads, then fill the blocks enclosed by reachable roads
+    grid.Morph(true);
+    grid.Morph(false);
+    grid.FillHoles();
+
+    // Trace the outlines: every side between a marked and an unmarked cell becomes an edge directed so
+    // that the marked cell is on its left, i.e. counter-clockwise around the area. Vertex (i, j) is the
+    // lower left corner of cell (i, j).
+    struct Side {
+        int from, to;
+        bool used;
+    };
+    const int stride = grid.width + 1;
+    std::vector<Side> sides;
+    std::unordered_multimap<int, int> leaving;
+    auto add = [&](int i0, int j0, int i1, int j1) {
+        leaving.emplace(j0 * stride + i0, (int)sides.size());
+        sides.push_back({j0 * stride + i0, j1 * stride + i1, false});
+    };
+    for( int j = 0; j < grid.height; ++j )
+        for( int i = 0; i < grid.width; ++i ) {
+            if( !grid.Get(i, j) )
+                continue;
+            if( !grid.Get(i, j - 1) ) add(i, j, i + 1, j);
+            if( !grid.Get(i + 1, j) ) add(i + 1, j, i + 1, j + 1);
+            if( !grid.Get(i, j + 1) ) add(i + 1, j + 1, i, j + 1);
+            if( !grid.Get(i - 1, j) ) add(i, j + 1, i, j);
+        }
+
+    for( auto &first: sides ) {
+        if( first.used )
+            continue;
+        std::vector<int> vertices;
+        Side *side = &first;
+        while( true ) {
+            side->used = true;
+            vertices.push_back(side->from);
+            if( side->to == first.from )
+                break;
+            // Where two marked cells touch only at a corner, two sides leave the vertex; taking the left
+            // turn keeps the cells in separate outlines.
+            const int dx = side->to % stride - side->from % stride, dy = side->to / stride - side->from / stride;
+            Side *next = nullptr;
+            auto range = leaving.equal_range(side->to);
+            for( auto it = range.first; it != range.second; ++it ) {
+                Side &candidate = sides[it->second];
+                if( candidate.used )
+                    continue;
+                const int cx = candidate.to % stride - candidate.from % stride, cy = candidate.to / stride - candidate.from / stride;
+                if( !next || (cx == -dy && cy == dx) )
+                    next = &candidate;
+            }
+            if( !next )
+                break;
+            side = next;
+        }
+        // keep only the corners of the outline
+        Isochrone::Ring ring;
+        const int n = (int)vertices.size();
+        for( int k = 0; k < n; ++k ) {
+            const int prev = vertices[(k + n - 1) % n], v = vertices[k], next = vertices[(k + 1) % n];
+            const int ax = v % stride - prev % stride, ay = v / stride - prev / stride;
+            const int bx = next % stride - v % stride, by = next / stride - v / stride;
+            if( ax == bx && ay == by )
+                continue;
+            Model::Node corner;
+            corner.x = grid.x0 + (v % stride) * grid.size;
+            corner.y = grid.y0 + (v / stride) * grid.size;
+            ring.push_back(corner);
+        }
+        rings.push_back(std::move(ring));
+    }
+    return rings;
+}
+
+Isochrone IsochroneSearch::Compute(int source, float budget, float cell_size)
+{
+    Isochrone isochrone;
+    isochrone.source = source;
+    isochrone.budget = budget;
+    isochrone.reached = Search(source, budget);
+    isochrone.area = Area(cell_size);
+    return isochrone;
+}
+
+std::vector<Isochrone> ComputeIsochrones(RouteModel &model, RouteModel::Profile profile, RouteModel::Metric metric,
+                                         const std::vector<int> &sources, float budget, float cell_size, int n_threads)
+{
+    if( n_threads <= 0 )
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    n_threads = std::max(1, std::min<int>(n_threads, sources.size()));
+    std::vector<Isochrone> isochrones(sources.size());
+    std::atomic<std::size_t> next{0};
+    auto worker = [&] {
+        IsochroneSearch search{model, profile, metric};
+        for( std::size_t i = next++; i < sources.size(); i = next++ )
+            isochrones[i] = search.Compute(sources[i], budget, cell_size);
+    };
+    std::vector<std::thread> threads;
+    for( int t = 0; t < n_threads; ++t )
+        threads.emplace_back(worker);
+    for( auto &thread: threads )
+        thread.join();
+    return isochrones;
+}
@@ -0,0 +1,69 @@
+#ifndef ISOCHRONE_H
+#define ISOCHRONE_H
+
+#include <vector>
+#include "route_model.h"
+#include "search_context.h"
+
+// Everything reachable from a node within a budget: the reached nodes with their costs, and the
+// reachable area as polygons that Render can draw.
+struct Isochrone {
+    struct Reached {
+        int node;
+        float cost;  // in meters or seconds, like the budget
+    };
+    // A closed outline in map coordinates, counter-clockwise; the last point is not repeated.
+    using Ring = std::vector<Model::Node>;
+
+    int source = -1;
+    float budget = 0.f;
+    std::vector<Reached> reached;  // in order of cost, starting with the source
+    std::vector<Ring> area;        // the outlines of the reachable area, without holes
+};
+
+// A bounded one-to-all Dijkstra search over the road graph of a RouteModel. Like a RoutePlanner, an
+// IsochroneSearch keeps its scratch buffers between searches and only reads the model, so several
+// searches (e.g. one per thread) may share it.
+//
+// With the Distance metric the budget is the length of road in meters (the road type weights of the
+// profile are not applied); with the Time metric it is the travel time in seconds.
+class IsochroneSearch {
+  public:
+    IsochroneSearch(RouteModel &model, RouteModel::Profile profile = RouteModel::Car, RouteModel::Metric metric = RouteModel::Distance);
+
+    // The node a search from (x, y) (in percent of the map) starts from: the closest node in the largest
+    // connected part of the profile's road graph, like RoutePlanner::SetEndpoints().
+    int Snap(float x, float y);
+
+    // Settles all nodes within the budget of the source, in order of cost. The result stays valid
+    // until the next search.
+    const std::vector<Isochrone::Reached> &Search(int source, float budget);
+
+    // The outline of the area reached by the last search: the reached nodes and the reachable parts of
+    // the roads leaving them are marked on a grid of square cells of the given size (in map units),
+    // small gaps and enclosed holes are filled, and the outlines of the marked cells are traced.
+    std::vector<Isochrone::Ring> Area(float cell_size) const;
+
+    // Search() and Area() together.
+    Isochrone Compute(int source, float budget, float cell_size);
+
+  private:
+    // the cost of edge e in the unit of the budget
+    float Cost(int e) const noexcept;
+
+    RouteModel &m_Model;
+    RouteModel::Profile m_Profile;
+    RouteModel::Metric m_Metric;
+    int m_Source = -1;
+    float m_Budget = 0.f;
+    SearchContext m_Context;
+    std::vector<Isochrone::Reached> m_Reached;
+};
+
+// Computes the isochrones of many sources in parallel on n_threads threads (the number of hardware
+// threads if 0), each with its own IsochroneSearch over the shared model. Returns them in the order
+// of the sources.
+std::vector<Isochrone> ComputeIsochrones(RouteModel &model, RouteModel::Profile profile, RouteModel::Metric metric,
+                                         const std::vector<int> &sources, float budget, float cell_size, int n_threads = 0);
+
+#endif
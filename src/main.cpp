@@ -1,15 +1,34 @@
+#include <algorithm>
+#include <chrono>
 #include <optional>  // std::nullopt
 #include <fstream>   // file streaming classes
 #include <iostream>
 #include <vector>
 #include <string>
+#include <csignal>
 #include <io2d.h>   // for displaying the route on a map
 #include "route_model.h"
 #include "render.h"
+#include "headless.h"
+#include "mvt.h"
+#include "route_server.h"
+#include "alternative_routes.h"
+#include "facility_search.h"
+#include "isochrone.h"
+#include "multi_stop.h"
+#include "tile_renderer.h"
 #include "route_planner.h"
 #include "utility_route_model.h"
 
 using namespace std::experimental;
+
+// the server that SIGINT and SIGTERM stop in server mode
+static RouteServer *running_server = nullptr;
+static void StopServer(int)
+{
+    if( running_server )
+        running_server->Stop();
+}
 /*
 // ReadFile() outputs a vector of raw memory
 static std::optional<std::vector<std::byte>> ReadFile(const std::string &path)
@@ -55,17 +74,111 @@ int main(int argc, const char **argv)
 
     // name of osm data file, which is in json format 
     std::string osm_data_file = "";
+    // renumber the nodes along a Hilbert curve for better cache locality during search
+    bool hilbert_order = false;
+    // routing profile: which roads may be used and how they are weighted
+    RouteModel::Profile profile = RouteModel::Car;
+    // minimise the travel time instead of the distance
+    RouteModel::Metric metric = RouteModel::Distance;
+    // initial view of the map: centre in percent of the map, and zoom factor
+    float view_x = 50.f, view_y = 50.f, view_zoom = 1.f;
+    // record the nodes explored by the search and show them on the map, all at once or animated
+    bool explore = false, animate = false;
+    // time the render layers, show them as bars and print a summary when the window is closed
+    bool time_layers = false;
+    // also show the area reachable from the start within this many meters (minutes with --fastest); 0 for none
+    float isochrone_budget = 0.f;
+    // weighted A*: accept a route up to this many times as long as the best one for a faster search
+    float heuristic_weight = 1.f;
+    // anytime A*: improve the route until the best one is found or this many milliseconds have passed; 0 for plain A*
+    int anytime_ms = 0;
+    // also show up to two alternatives to the route
+    bool show_alternatives = false;
+    // also list the five amenities of this kind (e.g. "parking") nearest to the start and show the routes to them
+    std::string nearest_kind = "";
+    // multi-stop mode: plan one route through the stops listed in a file (one "x y" per line, in percent
+    // of the map, starting with the first), optionally back to the first stop, and show it
+    std::string stops_file = "";
+    bool round_trip = false;
+    // batch mode: plan the routes listed in a file and save each as a PNG instead of opening a window
+    std::string batch_file = "", batch_dir = ".";
+    int image_width = 256, image_height = 256;
+    // tile mode: render XYZ map tiles of the given zoom levels into a directory
+    std::string tile_dir = "";
+    int tile_min_zoom = 0, tile_max_zoom = 0, n_threads = 0;
+    // vector tile mode: export Mapbox Vector Tiles of the same zoom levels to a directory, or to one
+    // archive file if the path ends in .mvta
+    std::string mvt_output = "";
+    // server mode: answer route requests on unix:PATH or tcp:PORT (on 127.0.0.1) until interrupted
+    std::string serve = "";
+    // memory budget in MB of the route cache of the server; 0 turns it off
+    int cache_mb = 64;
 
-    // if this program is run at the command line with the name of an osm data file:   
-    if( argc > 1 ) {
-        for( int i = 1; i < argc; ++i )
-            // parse the command line arguments
-            if( std::string_view{argv[i]} == "-f" && ++i < argc )
-                osm_data_file = argv[i];
+    // parse the command line arguments
+    for( int i = 1; i < argc; ++i ) {
+        if( std::string_view{argv[i]} == "-f" && ++i < argc )
+            osm_data_file = argv[i];
+        else if( std::string_view{argv[i]} == "--hilbert" )
+            hilbert_order = true;
+        else if( std::string_view{argv[i]} == "-p" && ++i < argc )
+            profile = std::string_view{argv[i]} == "pedestrian" ? RouteModel::Pedestrian : RouteModel::Car;
+        else if( std::string_view{argv[i]} == "--time-layers" )
+            time_layers = true;
+        else if( std::string_view{argv[i]} == "--explore" )
+            explore = true;
+        else if( std::string_view{argv[i]} == "--animate" )
+            explore = animate = true;
+        else if( std::string_view{argv[i]} == "--stops" && ++i < argc )
+            stops_file = argv[i];
+        else if( std::string_view{argv[i]} == "--round-trip" )
+            round_trip = true;
+        else if( std::string_view{argv[i]} == "--alternatives" )
+            show_alternatives = true;
+        else if( std::string_view{argv[i]} == "--weight" && ++i < argc )
+            heuristic_weight = std::stof(argv[i]);
+        else if( std::string_view{argv[i]} == "--anytime" && ++i < argc )
+            anytime_ms = std::stoi(argv[i]);
+        else if( std::string_view{argv[i]} == "--nearest" && ++i < argc )
+            nearest_kind = argv[i];
+        else if( std::string_view{argv[i]} == "--isochrone" && ++i < argc )
+            isochrone_budget = std::stof(argv[i]);
+        else if( std::string_view{argv[i]} == "--fastest" )
+            metric = RouteModel::Time;
+        else if( std::string_view{argv[i]} == "--view" && i + 3 < argc ) {
+            view_x = std::stof(argv[++i]);
+            view_y = std::stof(argv[++i]);
+            view_zoom = std::stof(argv[++i]);
+        }
+        else if( std::string_view{argv[i]} == "--batch" && i + 2 < argc ) {
+            batch_file = argv[++i];
+            batch_dir = argv[++i];
+        }
+        else if( std::string_view{argv[i]} == "--tiles" && i + 3 < argc ) {
+            tile_dir = argv[++i];
+            tile_min_zoom = std::stoi(argv[++i]);
+            tile_max_zoom = std::stoi(argv[++i]);
+        }
+        else if( std::string_view{argv[i]} == "--mvt" && i + 3 < argc ) {
+            mvt_output = argv[++i];
+            tile_min_zoom = std::stoi(argv[++i]);
+            tile_max_zoom = std::stoi(argv[++i]);
+        }
+        else if( std::string_view{argv[i]} == "--serve" && ++i < argc )
+            serve = argv[i];
+        else if( std::string_view{argv[i]} == "--cache" && ++i < argc )
+            cache_mb = std::stoi(argv[i]);
+        else if( std::string_view{argv[i]} == "--threads" && ++i < argc )
+            n_threads = std::stoi(argv[i]);
+        else if( std::string_view{argv[i]} == "--size" && i + 2 < argc ) {
+            image_width = std::stoi(argv[++i]);
+            image_height = std::stoi(argv[++i]);
+        }
     }
-    else {
+
+    // if this program is run at the command line without the name of an osm data file:   
+    if( osm_data_file.empty() ) {
         std::cout << "To specify a map file use the following format: " << std::endl;
-        std::cout << "Usage: [executable] [-f filename.osm]" << std::endl; // -f allows you to specify the osm data file 
+        std::cout << "Usage: [executable] [-f filename.osm] [-p car|pedestrian] [--fastest] [--explore] [--animate] [--weight w] [--anytime ms] [--alternatives] [--nearest amenity] [--isochrone budget] [--stops stops.txt] [--round-trip] [--time-layers] [--view x y zoom] [--hilbert] [--batch routes.txt out_dir] [--size w h] [--tiles out_dir min_zoom max_zoom] [--mvt out_dir|file.mvta min_zoom max_zoom] [--serve unix:path|tcp:port] [--cache mb] [--threads n]" << std::endl; // -f allows you to specify the osm data file 
         osm_data_file = "../map.osm"; // if you dont specify an osm data file it will be set to map.osm
     }
     
@@ -81,6 +194,132 @@ int main(int argc, const char **argv)
             osm_data = std::move(*data);
     }
     
+    // ***********************************************************************************************************
+    // * TILE MODE                                                                                               *
+    // ***********************************************************************************************************
+
+    if( !tile_dir.empty() ) {
+        RouteModel model{osm_data, hilbert_order};
+        TileRenderer tile_renderer{model};
+        auto stats = tile_renderer.RenderTiles(tile_min_zoom, tile_max_zoom, tile_dir, n_threads);
+        std::cout << "Rendered " << stats.rendered << " tiles and linked " << stats.background
+                  << " background tiles to " << tile_dir << std::endl;
+        return stats.failed == 0 ? 0 : 1;
+    }
+
+    // ***********************************************************************************************************
+    // * SERVER MODE                                                                                             *
+    // ***********************************************************************************************************
+
+    if( !serve.empty() ) {
+        RouteServer::Options options;
+        if( serve.rfind("unix:", 0) == 0 )
+            options.unix_path = serve.substr(5);
+        else if( serve.rfind("tcp:", 0) == 0 )
+            options.tcp_port = std::stoi(serve.substr(4));
+        else {
+            std::cout << "--serve takes unix:PATH or tcp:PORT" << std::endl;
+            return 1;
+        }
+        options.n_workers = n_threads;
+        options.cache_bytes = std::size_t(std::max(cache_mb, 0)) << 20;
+        RouteModel model{osm_data, hilbert_order};
+        RouteServer server{model, options};
+        running_server = &server;
+        std::signal(SIGINT, StopServer);
+        std::signal(SIGTERM, StopServer);
+        std::cout << "Serving route requests on " << serve << std::endl;
+        const bool served = server.Run();
+        running_server = nullptr;
+        std::cout << "Answered " << server.Answered() << " requests" << std::endl;
+        if( auto cache = server.Cache() )
+            std::cout << "Route cache: " << cache->Hits() << " hits, " << cache->Misses() << " misses, "
+                      << cache->Evictions() << " evictions, " << cache->Size() << " routes in "
+                      << cache->MemoryUsed() / 1024 << " KB" << std::endl;
+        return served ? 0 : 1;
+    }
+
+    if( !mvt_output.empty() ) {
+        Model model{osm_data, hilbert_order};
+        MvtExporter exporter{model};
+        const bool archive = mvt_output.size() > 5 && mvt_output.substr(mvt_output.size() - 5) == ".mvta";
+        auto stats = archive ? exporter.ExportArchive(mvt_output, tile_min_zoom, tile_max_zoom, n_threads)
+                             : exporter.ExportDirectory(mvt_output, tile_min_zoom, tile_max_zoom, n_threads);
+        std::cout << "Exported " << stats.written << " vector tiles to " << mvt_output << std::endl;
+        return stats.failed == 0 ? 0 : 1;
+    }
+
+    // ***********************************************************************************************************
+    // * BATCH MODE                                                                                              *
+    // ***********************************************************************************************************
+
+    // each line of the batch file holds the start and end coordinates of one route: start_x start_y end_x end_y.
+    // Route i is saved as out_dir/route_i.png; no window is opened, so no display server is needed.
+    if( !batch_file.empty() ) {
+        std::ifstream routes{batch_file};
+        if( !routes ) {
+            std::cout << "Failed to read " << batch_file << std::endl;
+            return 1;
+        }
+        RouteModel model{osm_data, hilbert_order};
+        RoutePlanner planner{model, profile, metric};
+        SurfacePool pool;
+        HeadlessRenderer renderer{model, pool, image_width, image_height};
+        float sx, sy, ex, ey;
+        int count = 0, failed = 0;
+        for( ; routes >> sx >> sy >> ex >> ey; ++count ) {
+            planner.SetEndpoints(sx, sy, ex, ey);
+            if( !planner.Search() )
+                std::cout << "No path found for route " << count << std::endl;
+            if( !renderer.Snapshot(planner.GetPath(), batch_dir + "/route_" + std::to_string(count) + ".png") )
+                ++failed;
+        }
+        std::cout << "Rendered " << count - failed << " of " << count << " routes to " << batch_dir << std::endl;
+        return failed == 0 ? 0 : 1;
+    }
+
+    // ***********************************************************************************************************
+    // * MULTI-STOP MODE                                                                                         *
+    // ***********************************************************************************************************
+
+    if( !stops_file.empty() ) {
+        std::ifstream file{stops_file};
+        std::vector<std::pair<float, float>> stops;
+        for( float x, y; file >> x >> y; )
+            stops.push_back({x, y});
+        if( stops.empty() ) {
+            std::cout << "Failed to read stops from " << stops_file << std::endl;
+            return 1;
+        }
+        RouteModel model{osm_data, hilbert_order};
+        MultiStopPlanner planner{model, profile, metric};
+        planner.SetStops(stops);
+        MultiStopPlanner::Options options;
+        options.round_trip = round_trip;
+        options.n_threads = n_threads;
+        auto result = planner.Plan(options);
+        if( !result.found )
+            std::cout << "Some stops can not be reached!\n";
+        std::cout << "Order of the stops:";
+        for( int stop: result.order )
+            std::cout << ' ' << stop;
+        std::cout << "\nDistance: " << result.distance << " meters. \n";
+        std::cout << "Travel time: " << result.duration << " seconds. \n";
+
+        model.path = result.path;
+        Render render{model};
+        render.SetView(view_x * 0.01f, view_y * 0.01f, view_zoom);
+        auto display = io2d::output_surface{400, 400, io2d::format::argb32, io2d::scaling::none, io2d::refresh_style::as_needed, 30};
+        display.size_change_callback([](io2d::output_surface& surface){
+            surface.dimensions(surface.display_dimensions());
+        });
+        display.draw_callback([&](io2d::output_surface& surface){
+            render.Display(surface);
+        });
+        display.begin_show();
+        return 0;
+    }
+
     // ***********************************************************************************************************
     // * GET START AND END COORDINATES                                                                           *
     // ***********************************************************************************************************
@@ -99,30 +338,108 @@ int main(int argc, const char **argv)
 
     // Build model: create a RouteModel object. called model.          This data structure holds all of the OSM data in a convenient 
     // format, and provides some methods for using the data.
-    RouteModel model{osm_data};
+    RouteModel model{osm_data, hilbert_order};
 
     // ***********************************************************************************************************
     // * CREATE ROUTE PLANNER                                                                                            *
     // ***********************************************************************************************************
 
     // create a RoutePlaner object using the model created above with user input start and end coordinates
-    RoutePlanner route_planner{model, start_x, start_y, end_x, end_y};
+    RoutePlanner route_planner{model, start_x, start_y, end_x, end_y, profile, metric};
 
     // perform A* search and save the results in the RoutePlaner object
-    route_planner.AStarSearch();
+    SearchRecorder recorder;
+    if( explore )
+        route_planner.SetRecorder(&recorder);
+    route_planner.SetHeuristicWeight(heuristic_weight);
+    if( anytime_ms > 0 ) {
+        RoutePlanner::AnytimeOptions options;
+        options.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(anytime_ms);
+        if( route_planner.AnytimeSearch(options) )
+            model.path = route_planner.GetPath();
+        else
+            std::cout << "No path found in time!\n";
+        for( auto &route: route_planner.AnytimeRoutes() )
+            std::cout << "Route after " << route.elapsed_ms << " ms: " << route.distance << " meters, at most "
+                      << route.bound << " times the best. \n";
+    }
+    else
+        route_planner.AStarSearch();
 
     std::cout << "Distance: " << route_planner.GetDistance() << " meters. \n";
+    std::cout << "Travel time: " << route_planner.GetDuration() << " seconds. \n";
+
+    if( show_alternatives ) {
+        AlternativeRoutes alternatives{model, profile, metric};
+        alternatives.SetEndpoints(route_planner.StartNode(), route_planner.EndNode());
+        auto &routes = alternatives.Find();
+        for( std::size_t i = 1; i < routes.size(); ++i ) {
+            std::cout << "Alternative " << i << ": " << routes[i].distance << " meters, " << routes[i].duration
+                      << " seconds, " << (int)(routes[i].shared * 100) << "% shared. \n";
+            model.alternatives.push_back(routes[i].path);
+        }
+        if( routes.size() <= 1 )
+            std::cout << "No alternative routes found. \n";
+    }
+
+    if( !nearest_kind.empty() ) {
+        FacilitySearch facilities{model, profile, metric};
+        if( const int kind = model.AmenityKind(nearest_kind); kind < 0 )
+            std::cout << "There is no amenity \"" << nearest_kind << "\" on the map. \n";
+        else
+            for( auto &facility: facilities.Nearest(route_planner.StartNode(), 5, kind) ) {
+                const int name = model.Pois()[facility.poi].name;
+                std::cout << nearest_kind << ' ' << (name >= 0 ? model.PoiNames()[name] : "") << ": "
+                          << facility.distance << " meters. \n";
+                model.alternatives.push_back(facilities.Path(facility));
+            }
+    }
+
+    Isochrone isochrone;
+    if( isochrone_budget > 0.f ) {
+        // the area is traced on a grid of cells of about 0.5% of the map
+        IsochroneSearch isochrone_search{model, profile, metric};
+        const float budget = metric == RouteModel::Time ? isochrone_budget * 60.f : isochrone_budget;
+        isochrone = isochrone_search.Compute(route_planner.StartNode(), budget, 0.005f);
+        std::cout << "Reachable from the start: " << isochrone.reached.size() << " nodes. \n";
+    }
 
     // Render results of search - creates a render object using the model
     Render render{model};
+    render.SetView(view_x * 0.01f, view_y * 0.01f, view_zoom);
+    if( explore )
+        render.SetSearchOverlay(&recorder, animate ? 0 : -1);
+    if( isochrone_budget > 0.f )
+        render.SetIsochrone(&isochrone);
+    RenderProfiler profiler;
+    if( time_layers )
+        render.SetProfiler(&profiler, true);
 
     // display the results using the io2d library
-    auto display = io2d::output_surface{400, 400, io2d::format::argb32, io2d::scaling::none, io2d::refresh_style::fixed, 30};
+    // the map only changes when the window is resized, so only redraw when needed, unless the search is animated
+    auto refresh = animate ? io2d::refresh_style::fixed : io2d::refresh_style::as_needed;
+    auto display = io2d::output_surface{400, 400, io2d::format::argb32, io2d::scaling::none, refresh, 30};
     display.size_change_callback([](io2d::output_surface& surface){
         surface.dimensions(surface.display_dimensions());
     });
+    // the animation shows the recorded events over about 5 seconds at 30 frames per second
+    const int events_per_frame = std::max(1, (int)recorder.Events().size() / 150);
+    int shown_events = 0;
     display.draw_callback([&](io2d::output_surface& surface){
+        if( animate && shown_events < (int)recorder.Events().size() ) {
+            shown_events += events_per_frame;
+            render.SetSearchOverlay(&recorder, shown_events);
+        }
         render.Display(surface);
     });
     display.begin_show();
+
+    if( time_layers ) {
+        std::cout << "Render times in ms (median / 95th percentile):\n";
+        for( int i = 0; i < RenderProfiler::NumLayers; ++i ) {
+            auto layer = static_cast<RenderProfiler::Layer>(i);
+            std::cout << "  " << RenderProfiler::LayerName(layer) << ": " << profiler.Percentile(layer, 50.)
+                      << " / " << profiler.Percentile(layer, 95.) << '\n';
+        }
+    }
 }
@@ -5,6 +5,7 @@
 #include <cmath>
 #include <algorithm>
 #include <assert.h>
+#include <cstdint>
 
 // Helper function for LoadData()
 // Returns a Road Type corresponding to the input string
@@ -44,17 +45,40 @@ static Model::Landuse::Type String2LanduseType(std::string_view type)
 // define the Model class constructor, which allows you to initialise a Model object with a reference to an 
 // xml file that has been imported as a vector (sequence) of bytes. The const keyword indicates that the xml 
 // parameter is read-only.
-Model::Model( const std::vector<std::byte> &xml )
+Model::Model( const std::vector<std::byte> &xml, bool hilbert_order )
 {
     LoadData(xml);
 
     AdjustCoordinates();
 
+    IndexPois();
+
+    if( hilbert_order )
+        ReorderNodesHilbert();
+
     std::sort(m_Roads.begin(), m_Roads.end(), [](const auto &_1st, const auto &_2nd){
         return (int)_1st.type < (int)_2nd.type; 
     });
 }
 
+// Sorts the points of interest by kind and records where each kind starts, so that the points of one
+// kind can be found without looking at the others.
+void Model::IndexPois()
+{
+    std::stable_sort(m_Pois.begin(), m_Pois.end(), [](const Poi &a, const Poi &b) { return a.kind < b.kind; });
+    m_FirstPoi.assign(m_AmenityKinds.size() + 1, 0);
+    for( const auto &poi: m_Pois )
+        ++m_FirstPoi[poi.kind + 1];
+    for( std::size_t k = 1; k < m_FirstPoi.size(); ++k )
+        m_FirstPoi[k] += m_FirstPoi[k - 1];
+}
+
+int Model::AmenityKind(std::string_view kind) const
+{
+    auto it = std::find(m_AmenityKinds.begin(), m_AmenityKinds.end(), kind);
+    return it == m_AmenityKinds.end() ? -1 : int(it - m_AmenityKinds.begin());
+}
+
 // Builds data structures (m_Ways, m_Roads, m_Railways, etc.) by parsing information 
 // from the elements in the OSM XML file. It populates these structures based on the 
 // attributes and child elements of each element.
@@ -91,6 +115,21 @@ void Model::LoadData(const std::vector<std::byte> &xml)
     // mapping between node IDs and corresponding indices (numbers).
     std::unordered_map<std::string, int> node_id_to_num;
 
+    // Points of interest are collected as their elements are read. The kinds of amenity are numbered
+    // in the order they are first seen; the name, if any, is another tag of the same element.
+    std::unordered_map<std::string, int> amenity_kind_to_num;
+    auto add_poi = [&](const std::string &kind, const xml_node &element, const Node &position) {
+        auto [it, inserted] = amenity_kind_to_num.emplace(kind, (int)m_AmenityKinds.size());
+        if( inserted )
+            m_AmenityKinds.push_back(kind);
+        int name = -1;
+        if( auto tag = element.find_child_by_attribute("tag", "k", "name") ) {
+            name = (int)m_PoiNames.size();
+            m_PoiNames.push_back(tag.attribute("v").as_string());
+        }
+        m_Pois.push_back({position, it->second, name});
+    };
+
     // Extract node IDs and coordnates (in terms of longitude and lattitude):
     // for each node in the xml document:
     for( const auto &node: doc.select_nodes("/osm/node") ) {
@@ -106,6 +145,9 @@ void Model::LoadData(const std::vector<std::byte> &xml)
         // then assigned to the y and x members of the last added node, respectively.       
         m_Nodes.back().y = atof(node.node().attribute("lat").as_string());
         m_Nodes.back().x = atof(node.node().attribute("lon").as_string());
+        // nodes tagged with "amenity" are points of interest
+        if( auto amenity = node.node().find_child_by_attribute("tag", "k", "amenity") )
+            add_poi(amenity.attribute("v").as_string(), node.node(), m_Nodes.back());
     }
     /*
     cout << "The number of nodes in the map is: " << m_Nodes.size() << '\n';
@@ -231,6 +273,19 @@ void Model::LoadData(const std::vector<std::byte> &xml)
                 }
             }
         }
+
+        // ways tagged with "amenity" (mostly buildings and parking lots) are points of interest at the
+        // centre of their nodes
+        if( auto amenity = node.find_child_by_attribute("tag", "k", "amenity"); amenity && !new_way.nodes.empty() ) {
+            Node centre;
+            for( int n: new_way.nodes ) {
+                centre.x += m_Nodes[n].x;
+                centre.y += m_Nodes[n].y;
+            }
+            centre.x /= new_way.nodes.size();
+            centre.y /= new_way.nodes.size();
+            add_poi(amenity.attribute("v").as_string(), node, centre);
+        }
     }
     // for all "relation" elements
     for( const auto &relation: doc.select_nodes("/osm/relation") ) {
@@ -316,11 +371,87 @@ void Model::AdjustCoordinates()
     const auto min_y = lat2ym(m_MinLat); // 1769190
     //cout << "min_x = " << min_x << ", min_y = " << min_y <<  '\n'; // 
     m_MetricScale = std::min(dx, dy); // 578.759
+    // the world is pi * earth_radius wide in the units of lon2xm(), and its centre is at (0, 0)
+    m_WorldScale = m_MetricScale / (pi * earth_radius);
+    m_WorldX0 = 0.5 + min_x / (pi * earth_radius);
+    m_WorldY0 = 0.5 - min_y / (pi * earth_radius);
     //cout << "dx = "<< dx << ", dy = " << dy << '\n';
     for( auto &node: m_Nodes ) {
         node.x = (lon2xm(node.x) - min_x) / m_MetricScale;
         node.y = (lat2ym(node.y) - min_y) / m_MetricScale;        
     }
+    for( auto &poi: m_Pois ) {
+        poi.position.x = (lon2xm(poi.position.x) - min_x) / m_MetricScale;
+        poi.position.y = (lat2ym(poi.position.y) - min_y) / m_MetricScale;
+    }
+}
+
+// Helper function for ReorderNodesHilbert()
+// Returns the distance along a Hilbert curve that fills a (1 << order) x (1 << order) grid for the cell (x, y).
+// Cells that are close together on the grid tend to have close distances along the curve.
+static std::uint64_t HilbertIndex(std::uint32_t x, std::uint32_t y, int order)
+{
+    std::uint64_t d = 0;
+    for( std::uint32_t s = 1u << (order - 1); s > 0; s /= 2 ) {
+        const std::uint32_t rx = (x & s) > 0;
+        const std::uint32_t ry = (y & s) > 0;
+        d += std::uint64_t(s) * s * ((3 * rx) ^ ry);
+        // rotate the quadrant so that the curve stays continuous
+        if( ry == 0 ) {
+            if( rx == 1 ) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+// Renumber m_Nodes in the order in which a Hilbert curve over the projected x/y coordinates visits them.
+// Node indices otherwise follow the order of the OSM file, so nodes that are neighbours on the road network 
+// can be far apart in memory. Ways are the only structures that hold node indices, so remapping their node 
+// lists keeps roads, railways and multipolygons (which hold way indices) consistent.
+void Model::ReorderNodesHilbert()
+{
+    if( m_Nodes.empty() )
+        return;
+
+    // nodes outside the map bounds can have coordinates outside [0, 1], so grid over the actual extent
+    double min_x = m_Nodes.front().x, max_x = min_x;
+    double min_y = m_Nodes.front().y, max_y = min_y;
+    for( const auto &node: m_Nodes ) {
+        min_x = std::min(min_x, node.x); max_x = std::max(max_x, node.x);
+        min_y = std::min(min_y, node.y); max_y = std::max(max_y, node.y);
+    }
+    constexpr int order = 16;
+    const double cells = double((1u << order) - 1);
+    const double extent = std::max({max_x - min_x, max_y - min_y, 1e-12});
+
+    std::vector<std::uint64_t> keys(m_Nodes.size());
+    for( std::size_t i = 0; i < m_Nodes.size(); ++i ) {
+        auto gx = static_cast<std::uint32_t>((m_Nodes[i].x - min_x) / extent * cells);
+        auto gy = static_cast<std::uint32_t>((m_Nodes[i].y - min_y) / extent * cells);
+        keys[i] = HilbertIndex(gx, gy, order);
+    }
+
+    // new_to_old[new index] = old index; stable so that nodes in the same cell keep their file order
+    std::vector<int> new_to_old(m_Nodes.size());
+    for( std::size_t i = 0; i < new_to_old.size(); ++i )
+        new_to_old[i] = (int)i;
+    std::stable_sort(new_to_old.begin(), new_to_old.end(), [&](int a, int b){ return keys[a] < keys[b]; });
+
+    std::vector<int> old_to_new(m_Nodes.size());
+    std::vector<Node> nodes(m_Nodes.size());
+    for( std::size_t i = 0; i < new_to_old.size(); ++i ) {
+        old_to_new[new_to_old[i]] = (int)i;
+        nodes[i] = m_Nodes[new_to_old[i]];
+    }
+    m_Nodes = std::move(nodes);
+
+    for( auto &way: m_Ways )
+        for( auto &node_idx: way.nodes )
+            node_idx = old_to_new[node_idx];
 }
 
 // Recursive helper function. Explores ways in the input vector open_ways to build a sequence of 
@@ -3,6 +3,7 @@
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <string_view>
 #include <cstddef>
 
 using namespace std;
@@ -62,14 +63,32 @@ public:
         Type type;
     };
     
+    // a point of interest: a node or a way tagged with "amenity" (a cafe, a parking lot, a school, ...)
+    struct Poi {
+        Node position;  // the node, or the centre of the nodes of the way
+        int kind;       // index into AmenityKinds(), e.g. "cafe"
+        int name;       // index into PoiNames(), or -1 if it has no name
+    };
+
     // Model class constructor, which allows you to initialise a Model object with a reference to an 
     // xml file that has been imported as a vector (sequence) of bytes. The const keyword indicates that the xml 
     // parameter is read-only.
-    Model( const std::vector<std::byte> &xml );
+    // If hilbert_order is true the nodes are renumbered along a Hilbert curve after loading, so that nodes
+    // which are close together on the map are also close together in memory (see ReorderNodesHilbert()).
+    Model( const std::vector<std::byte> &xml, bool hilbert_order = false );
     
     // declare member functions
 
     auto MetricScale() const noexcept { return m_MetricScale; } 
+
+    // Model coordinates are Web Mercator coordinates that have been shifted and scaled, so they map
+    // linearly to the world coordinates of XYZ map tiles (0 to 1 from west to east and from north to south).
+    double WorldX(double x) const noexcept { return m_WorldX0 + x * m_WorldScale; }
+    double WorldY(double y) const noexcept { return m_WorldY0 - y * m_WorldScale; }
+    double ModelX(double world_x) const noexcept { return (world_x - m_WorldX0) / m_WorldScale; }
+    double ModelY(double world_y) const noexcept { return (m_WorldY0 - world_y) / m_WorldScale; }
+    // length of one model unit in world units
+    double WorldScale() const noexcept { return m_WorldScale; }
     
     // define member functions. They take no arguments. 
     // auto means the compiler will automatically deduce the return type.
@@ -86,13 +105,24 @@ public:
     auto &Landuses() const noexcept { return m_Landuses; }
     auto &Railways() const noexcept { return m_Railways; }
 
+    // The points of interest, sorted by kind: those of kind k are Pois()[FirstPoi()[k]] up to (but not
+    // including) Pois()[FirstPoi()[k + 1]].
+    auto &Pois() const noexcept { return m_Pois; }
+    auto &FirstPoi() const noexcept { return m_FirstPoi; }
+    auto &AmenityKinds() const noexcept { return m_AmenityKinds; }
+    auto &PoiNames() const noexcept { return m_PoiNames; }
+    // index of the amenity kind in AmenityKinds(), or -1 if no point of interest is of that kind
+    int AmenityKind(std::string_view kind) const;
+
     auto &Bounds() const noexcept { return m_bounds; };
     
 private:
     // private member functions
     void AdjustCoordinates();
     void BuildRings( Multipolygon &mp );
+    void ReorderNodesHilbert();
     void LoadData(const std::vector<std::byte> &xml);
+    void IndexPois();
     
     // class attributes
 
@@ -104,12 +134,19 @@ private:
     std::vector<Leisure> m_Leisures;
     std::vector<Water> m_Waters;
     std::vector<Landuse> m_Landuses;
+    std::vector<Poi> m_Pois;
+    std::vector<int> m_FirstPoi;
+    std::vector<std::string> m_AmenityKinds;
+    std::vector<std::string> m_PoiNames;
     
     double m_MinLat = 0.;
     double m_MaxLat = 0.;
     double m_MinLon = 0.;
     double m_MaxLon = 0.;
     double m_MetricScale = 1.f;
+    double m_WorldX0 = 0.;
+    double m_WorldY0 = 0.;
+    double m_WorldScale = 1.;
 
     std::vector<double> m_bounds {};
 };
@@ -0,0 +1,219 @@
+#include "multi_stop.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <thread>
+#include "route_planner.h"
+#include "search_context.h"
+
+// a move has to save more than this (relative to the cost of the order) to be made, so that rounding
+// errors can not make the local search go round in circles
+static constexpr float MinImprovement = 1e-6f;
+
+// Runs jobs 0 ... n - 1 on n_threads threads. Each thread calls make_job() once and then runs its share
+// of the jobs with the function it returns, which can keep scratch buffers between jobs.
+template <typename MakeJob>
+static void RunParallel(int n, int n_threads, MakeJob &&make_job)
+{
+    if( n_threads <= 0 )
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    n_threads = std::max(1, std::min(n_threads, n));
+    std::atomic<int> next{0};
+    std::vector<std::thread> threads;
+    for( int t = 0; t < n_threads; ++t )
+        threads.emplace_back([&] {
+            auto job = make_job();
+            for( int i = next++; i < n; i = next++ )
+                job(i);
+        });
+    for( auto &thread: threads )
+        thread.join();
+}
+
+MultiStopPlanner::MultiStopPlanner(RouteModel &model, RouteModel::Profile profile, RouteModel::Metric metric):
+    m_Model(model),
+    m_Profile(profile),
+    m_Metric(metric)
+{
+}
+
+void MultiStopPlanner::SetStops(const std::vector<std::pair<float, float>> &coordinates)
+{
+    m_Stops.clear();
+    for( auto [x, y]: coordinates )
+        m_Stops.push_back(m_Model.ClosestNodeIndex(x * 0.01f, y * 0.01f, m_Profile, true));
+}
+
+void MultiStopPlanner::SetStops(const std::vector<int> &nodes)
+{
+    m_Stops = nodes;
+}
+
+float MultiStopPlanner::OrderCost(const std::vector<int> &order, bool round_trip) const
+{
+    float cost = 0.f;
+    for( std::size_t k = 1; k < order.size(); ++k )
+        cost += Cost(order[k - 1], order[k]);
+    if( round_trip && order.size() > 1 )
+        cost += Cost(order.back(), order.front());
+    return cost;
+}
+
+// One row of the matrix per stop: a Dijkstra from the stop that ends when every stop has been settled.
+void MultiStopPlanner::BuildMatrix(int n_threads)
+{
+    const int n = (int)m_Stops.size();
+    const int n_nodes = (int)m_Model.SNodes().size();
+    m_Matrix.assign(std::size_t(n) * n, std::numeric_limits<float>::max());
+    std::vector<char> is_stop(n_nodes, 0);
+    int distinct = 0;
+    for( int stop: m_Stops )
+        if( !is_stop[stop] ) {
+            is_stop[stop] = 1;
+            ++distinct;
+        }
+
+    auto &first_edge = m_Model.FirstEdge();
+    auto &edge_to = m_Model.EdgeTo();
+    auto &edge_weight = m_Model.EdgeWeights(m_Profile, m_Metric);
+    RunParallel(n, n_threads, [&] { return [&, search = std::make_unique<SearchContext>()](int row) {
+        auto &context = *search;
+        if( context.Size() != n_nodes )
+            context.Resize(n_nodes, (int)edge_to.size());
+        context.Clear();
+        context.Reach(m_Stops[row], 0.f, -1, -1);
+        context.Push(m_Stops[row], 0.f);
+        int settled_stops = 0;
+        for( int node = context.Pop(); node >= 0 && settled_stops < distinct; node = context.Pop() ) {
+            context.Close(node);
+            settled_stops += is_stop[node];
+            const float g = context.G(node);
+            for( int e = first_edge[node]; e < first_edge[node + 1]; ++e ) {
+                if( !m_Model.EdgeAccessible(e, m_Profile) )
+                    continue;
+                const float g_next = g + edge_weight[e];
+                if( g_next >= context.G(edge_to[e]) )
+                    continue;
+                context.Reach(edge_to[e], g_next, node, e);
+                context.Push(edge_to[e], g_next);
+            }
+        }
+        for( int col = 0; col < n; ++col )
+            if( context.Closed(m_Stops[col]) )
+                m_Matrix[std::size_t(row) * n + col] = context.G(m_Stops[col]);
+    }; });
+}
+
+// Nearest neighbour from stop 0, then 2-opt and or-opt moves until none helps or time runs out. The
+// order is kept as a path whose first stop is fixed; for a round trip stop 0 is appended as a fixed
+// last stop. Roads are not directed, so the cost matrix is symmetric and reversing part of the order
+// only changes the costs at its ends.
+std::vector<int> MultiStopPlanner::Optimize(const Options &options) const
+{
+    const int n = (int)m_Stops.size();
+    std::vector<int> tour{0};
+    std::vector<char> visited(n, 0);
+    visited[0] = 1;
+    for( int k = 1; k < n; ++k ) {
+        int nearest = -1;
+        for( int stop = 0; stop < n; ++stop )
+            if( !visited[stop] && (nearest < 0 || Cost(tour.back(), stop) < Cost(tour.back(), nearest)) )
+                nearest = stop;
+        visited[nearest] = 1;
+        tour.push_back(nearest);
+    }
+    if( options.round_trip )
+        tour.push_back(0);
+
+    const int size = (int)tour.size();
+    const int last = options.round_trip ? size - 2 : size - 1;  // the last position that may change
+    auto cost = [&](int a, int b) { return b < size ? Cost(tour[a], tour[b]) : 0.f; };
+    const float epsilon = MinImprovement * std::max(OrderCost(tour, false), 1.f);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.time_limit_ms);
+
+    for( bool improved = true; improved && std::chrono::steady_clock::now() < deadline; ) {
+        improved = false;
+        // 2-opt: reverse the stops at positions i ... j
+        for( int i = 1; i < last && std::chrono::steady_clock::now() < deadline; ++i )
+            for( int j = i + 1; j <= last; ++j ) {
+                const float delta = cost(i - 1, j) + cost(i, j + 1) - cost(i - 1, i) - cost(j, j + 1);
+                if( delta < -epsilon ) {
+                    std::reverse(tour.begin() + i, tour.begin() + j + 1);
+                    improved = true;
+                }
+            }
+        // or-opt: move the stops at positions i ... i + len - 1, possibly reversed, between the stops
+        // at positions p and p + 1
+        for( int len = 1; len <= 3; ++len )
+            for( int i = 1; i + len - 1 <= last && std::chrono::steady_clock::now() < deadline; ++i ) {
+                const int end = i + len - 1;
+                const float removed = cost(i - 1, i) + cost(end, end + 1) - cost(i - 1, end + 1);
+                for( int p = 0; p < size; ++p ) {
+                    if( p >= i - 1 && p <= end )
+                        continue;
+                    if( options.round_trip && p == size - 1 )
+                        continue;
+                    const bool at_end = p + 1 >= size;
+                    const float gap = at_end ? 0.f : Cost(tour[p], tour[p + 1]);
+                    const float forward = Cost(tour[p], tour[i]) + (at_end ? 0.f : Cost(tour[end], tour[p + 1])) - gap;
+                    const float backward = Cost(tour[p], tour[end]) + (at_end ? 0.f : Cost(tour[i], tour[p + 1])) - gap;
+                    const float added = std::min(forward, backward);
+                    if( added - removed >= -epsilon )
+                        continue;
+                    std::vector<int> segment(tour.begin() + i, tour.begin() + end + 1);
+                    if( backward < forward )
+                        std::reverse(segment.begin(), segment.end());
+                    tour.erase(tour.begin() + i, tour.begin() + end + 1);
+                    const int insert_after = p < i ? p : p - len;
+                    tour.insert(tour.begin() + insert_after + 1, segment.begin(), segment.end());
+                    improved = true;
+                    break;
+                }
+            }
+    }
+    if( options.round_trip )
+        tour.pop_back();
+    return tour;
+}
+
+MultiStopPlanner::Result MultiStopPlanner::Plan(const Options &options)
+{
+    Result result;
+    // a stop that could not be snapped to a road can not be reached
+    if( m_Stops.empty() || std::any_of(m_Stops.begin(), m_Stops.end(), [](int stop) { return stop < 0; }) )
+        return result;
+    BuildMatrix(options.n_threads);
+    result.order = Optimize(options);
+
+    // plan the legs in parallel, each worker with its own planner
+    std::vector<int> ends = result.order;
+    if( options.round_trip && ends.size() > 1 )
+        ends.push_back(ends.front());
+    const int n_legs = (int)ends.size() - 1;
+    std::vector<std::vector<int>> paths(std::max(n_legs, 0));
+    std::vector<float> distances(paths.size()), durations(paths.size());
+    std::vector<char> found(paths.size(), 0);
+    RunParallel(n_legs, options.n_threads, [&] { return [&, planner = std::make_unique<RoutePlanner>(m_Model, m_Profile, m_Metric)](int leg) {
+        planner->SetEndpoints(m_Stops[ends[leg]], m_Stops[ends[leg + 1]]);
+        found[leg] = planner->Search();
+        paths[leg] = planner->GetPath();
+        distances[leg] = planner->GetDistance();
+        durations[leg] = planner->GetDuration();
+    }; });
+
+    result.found = std::all_of(found.begin(), found.end(), [](char f) { return f; });
+    result.path.push_back(m_Stops[ends.front()]);
+    result.legs.push_back(0);
+    for( int leg = 0; leg < n_legs; ++leg ) {
+        if( !paths[leg].empty() )
+            result.path.insert(result.path.end(), paths[leg].begin() + 1, paths[leg].end());
+        result.legs.push_back((int)result.path.size() - 1);
+        result.distance += distances[leg];
+        result.duration += durations[leg];
+    }
+    const float scale = m_Metric == RouteModel::Distance ? static_cast<float>(m_Model.MetricScale()) : 1.f;
+    result.cost = result.found ? OrderCost(result.order, options.round_trip) * scale : std::numeric_limits<float>::max();
+    return result;
+}
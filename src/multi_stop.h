@@ -0,0 +1,59 @@
+#ifndef MULTI_STOP_H
+#define MULTI_STOP_H
+
+#include <vector>
+#include "route_model.h"
+
+// Plans one route through many stops (e.g. the deliveries of a van): it finds the cost between every
+// pair of stops, chooses a good order to visit them in, and joins the routes between consecutive stops
+// (the legs) into one path that Render can draw as the route of the model.
+//
+// The cost matrix takes one Dijkstra per stop, which stops once all other stops are settled; the
+// searches run on worker threads. The order is built by nearest neighbour and improved by local search
+// (2-opt, which reverses a part of the order, and or-opt, which moves up to three consecutive stops
+// elsewhere) until no move helps or the time limit is reached. The legs are planned in parallel too.
+class MultiStopPlanner {
+  public:
+    struct Options {
+        bool round_trip = false;  // return to the first stop at the end
+        int time_limit_ms = 200;  // for the local search
+        int n_threads = 0;        // the number of hardware threads if 0
+    };
+    struct Result {
+        std::vector<int> order;  // stop indices in visiting order, starting with stop 0
+        std::vector<int> path;   // node indices of the whole route
+        std::vector<int> legs;   // legs[k] is the position in path of the k-th stop of the order
+        float cost = 0.f;        // in the unit of the metric: meters (weighted by road type) or seconds
+        float distance = 0.f;    // in meters
+        float duration = 0.f;    // in seconds
+        bool found = false;      // false if some stop can not be reached
+    };
+
+    MultiStopPlanner(RouteModel &model, RouteModel::Profile profile = RouteModel::Car, RouteModel::Metric metric = RouteModel::Distance);
+
+    // Stops as coordinates in percent of the map, snapped like RoutePlanner::SetEndpoints(), or as nodes.
+    // The first stop is where the route starts.
+    void SetStops(const std::vector<std::pair<float, float>> &coordinates);
+    void SetStops(const std::vector<int> &nodes);
+    const std::vector<int> &Stops() const noexcept { return m_Stops; }
+
+    Result Plan(const Options &options);
+    Result Plan() { return Plan(Options{}); }
+
+    // The cost matrix of the last Plan(): Cost(a, b) between stops a and b in edge weight units.
+    float Cost(int a, int b) const noexcept { return m_Matrix[std::size_t(a) * m_Stops.size() + b]; }
+    // The total cost of visiting the stops in the order, in edge weight units.
+    float OrderCost(const std::vector<int> &order, bool round_trip) const;
+
+  private:
+    void BuildMatrix(int n_threads);
+    std::vector<int> Optimize(const Options &options) const;
+
+    RouteModel &m_Model;
+    RouteModel::Profile m_Profile;
+    RouteModel::Metric m_Metric;
+    std::vector<int> m_Stops;
+    std::vector<float> m_Matrix;
+};
+
+#endif
@@ -0,0 +1,513 @@
+#include "mvt.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+void PbfWriter::Varint(std::uint64_t value)
+{
+    // 7 bits per byte, least significant first; the high bit is set on all but the last byte
+    while( value >= 0x80 ) {
+        m_Data.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    m_Data.push_back(static_cast<char>(value));
+}
+
+void PbfWriter::Tag(int field, WireType type)
+{
+    Varint((static_cast<std::uint64_t>(field) << 3) | type);
+}
+
+void PbfWriter::UInt(int field, std::uint64_t value)
+{
+    Tag(field, VarintType);
+    Varint(value);
+}
+
+void PbfWriter::Bytes(int field, const std::string &bytes)
+{
+    Tag(field, LengthDelimitedType);
+    Varint(bytes.size());
+    m_Data += bytes;
+}
+
+void PbfWriter::PackedUInt32(int field, const std::vector<std::uint32_t> &values)
+{
+    if( values.empty() )
+        return;
+    PbfWriter packed;
+    for( auto value: values )
+        packed.Varint(value);
+    Bytes(field, packed.m_Data);
+}
+
+// Field numbers and enums of the vector tile schema (vector_tile.proto, version 2).
+enum TileField { TileLayers = 3 };
+enum LayerField { LayerName = 1, LayerFeatures = 2, LayerKeys = 3, LayerValues = 4, LayerExtent = 5, LayerVersion = 15 };
+enum FeatureField { FeatureId = 1, FeatureTags = 2, FeatureType = 3, FeatureGeometry = 4 };
+enum ValueField { ValueString = 1 };
+enum GeomType { LineString = 2, Polygon = 3 };
+enum Command { MoveTo = 1, LineTo = 2, ClosePath = 7 };
+
+static const std::vector<std::string> RoadTypeNames{"invalid", "unclassified", "service", "residential",
+    "tertiary", "secondary", "primary", "trunk", "motorway", "footway"};
+static const std::vector<std::string> LanduseTypeNames{"invalid", "commercial", "construction", "grass",
+    "forest", "industrial", "railway", "residential"};
+
+// One layer of a tile that is being encoded. Features may have a single attribute, "type", whose
+// possible values are listed in the layer.
+struct LayerBuilder {
+    explicit LayerBuilder(std::string layer_name, const std::vector<std::string> *type_values = nullptr):
+        name(std::move(layer_name)), values(type_values) {}
+
+    std::string name;
+    const std::vector<std::string> *values;
+    PbfWriter features;
+
+    // value is the index of the "type" value of the feature, or -1 if it has none
+    void AddFeature(int id, GeomType type, const std::vector<std::uint32_t> &geometry, int value = -1) {
+        PbfWriter feature;
+        feature.UInt(FeatureId, id);
+        if( value >= 0 )
+            feature.PackedUInt32(FeatureTags, {0u, static_cast<std::uint32_t>(value)});
+        feature.UInt(FeatureType, type);
+        feature.PackedUInt32(FeatureGeometry, geometry);
+        features.Bytes(LayerFeatures, feature.Data());
+    }
+
+    void Write(PbfWriter &tile) const {
+        if( features.Empty() )
+            return;
+        PbfWriter layer;
+        layer.UInt(LayerVersion, 2);
+        layer.Bytes(LayerName, name);
+        layer.Append(features);
+        if( values ) {
+            layer.Bytes(LayerKeys, "type");
+            for( auto &value: *values ) {
+                PbfWriter value_message;
+                value_message.Bytes(ValueString, value);
+                layer.Bytes(LayerValues, value_message.Data());
+            }
+        }
+        layer.UInt(LayerExtent, MvtExporter::Extent);
+        tile.Bytes(TileLayers, layer.Data());
+    }
+};
+
+struct TilePoint {
+    double x;
+    double y;
+};
+
+// Clips the segment from a to b to the square lo <= x, y <= hi (Liang-Barsky). Returns false if no part
+// of it is inside; end_clipped is set if b was moved.
+static bool ClipSegment(TilePoint &a, TilePoint &b, double lo, double hi, bool &end_clipped)
+{
+    const double dx = b.x - a.x, dy = b.y - a.y;
+    double t0 = 0., t1 = 1.;
+    // the part of the segment with p * t <= q
+    auto clip = [&](double p, double q) {
+        if( p == 0. )
+            return q >= 0.;
+        const double t = q / p;
+        if( p < 0. )
+            t0 = std::max(t0, t);
+        else
+            t1 = std::min(t1, t);
+        return t0 <= t1;
+    };
+    if( !clip(-dx, a.x - lo) || !clip(dx, hi - a.x) || !clip(-dy, a.y - lo) || !clip(dy, hi - a.y) )
+        return false;
+    end_clipped = t1 < 1.;
+    b = {a.x + t1 * dx, a.y + t1 * dy};
+    a = {a.x + t0 * dx, a.y + t0 * dy};
+    return true;
+}
+
+// Clips a closed ring (without a repeated first point) to the square lo <= x, y <= hi (Sutherland-Hodgman).
+static std::vector<TilePoint> ClipRing(std::vector<TilePoint> ring, double lo, double hi)
+{
+    std::vector<TilePoint> clipped;
+    for( int edge = 0; edge < 4 && !ring.empty(); ++edge ) {
+        const double bound = edge % 2 == 0 ? lo : hi;
+        auto inside = [&](const TilePoint &p) {
+            const double v = edge < 2 ? p.x : p.y;
+            return edge % 2 == 0 ? v >= bound : v <= bound;
+        };
+        auto intersection = [&](const TilePoint &a, const TilePoint &b) {
+            if( edge < 2 )
+                return TilePoint{bound, a.y + (bound - a.x) / (b.x - a.x) * (b.y - a.y)};
+            return TilePoint{a.x + (bound - a.y) / (b.y - a.y) * (b.x - a.x), bound};
+        };
+        clipped.clear();
+        for( std::size_t i = 0; i < ring.size(); ++i ) {
+            const auto &current = ring[i];
+            const auto &previous = ring[(i + ring.size() - 1) % ring.size()];
+            if( inside(current) ) {
+                if( !inside(previous) )
+                    clipped.push_back(intersection(previous, current));
+                clipped.push_back(current);
+            }
+            else if( inside(previous) )
+                clipped.push_back(intersection(previous, current));
+        }
+        ring.swap(clipped);
+    }
+    return ring;
+}
+
+// Ray casting test of whether the point lies inside the ring of model nodes.
+static bool InsideRing(const Model &model, const std::vector<int> &ring, const Model::Node &p)
+{
+    const auto &nodes = model.Nodes();
+    bool inside = false;
+    for( std::size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++ ) {
+        const auto &a = nodes[ring[i]], &b = nodes[ring[j]];
+        if( (a.y > p.y) != (b.y > p.y) && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x )
+            inside = !inside;
+    }
+    return inside;
+}
+
+// Turns the ways of the model into geometry commands of one tile.
+class TileEncoder {
+  public:
+    TileEncoder(const Model &model, const WayPyramid &pyramid, const TileId &tile):
+        m_Model(model), m_Pyramid(pyramid)
+    {
+        // tile coordinates are x0 + x * scale and y0 - y * scale for model coordinates x and y
+        const double n = std::ldexp(1., tile.z);
+        m_Scale = model.WorldScale() * n * MvtExporter::Extent;
+        m_X0 = (model.WorldX(0.) * n - tile.x) * MvtExporter::Extent;
+        m_Y0 = (model.WorldY(0.) * n - tile.y) * MvtExporter::Extent;
+        // simplify by up to half a tile unit and leave out ways smaller than a tile unit
+        m_Level = WayPyramid::LevelFor(0.5 / m_Scale);
+        m_MinExtent = 1. / m_Scale;
+    }
+
+    // size of a tile unit in model units
+    double Unit() const noexcept { return 1. / m_Scale; }
+    // the cursor of the delta encoding starts at (0, 0) for each feature
+    void BeginFeature() noexcept { m_CursorX = m_CursorY = 0; }
+
+    // Encodes the way as one or more line strings into geometry; returns false if nothing of it is in the tile.
+    bool Line(int way, std::vector<std::uint32_t> &geometry) {
+        if( !Load(way) || m_Points.size() < 2 )
+            return false;
+        bool added = false;
+        std::vector<TilePoint> piece;
+        auto flush = [&]() {
+            added |= Emit(piece, false, geometry);
+            piece.clear();
+        };
+        for( std::size_t i = 0; i + 1 < m_Points.size(); ++i ) {
+            TilePoint a = m_Points[i], b = m_Points[i + 1];
+            bool end_clipped = false;
+            if( !ClipSegment(a, b, Low, High, end_clipped) ) {
+                flush();
+                continue;
+            }
+            if( piece.empty() )
+                piece.push_back(a);
+            piece.push_back(b);
+            if( end_clipped )
+                flush();
+        }
+        flush();
+        return added;
+    }
+
+    // Encodes the multipolygon as polygons into geometry: each outer ring followed by the inner rings that
+    // lie in it. Returns false if nothing of it is in the tile.
+    bool Polygon(const Model::Multipolygon &mp, std::vector<std::uint32_t> &geometry) {
+        const auto &ways = m_Model.Ways();
+        bool added = false;
+        for( std::size_t o = 0; o < mp.outer.size(); ++o ) {
+            if( !Ring(mp.outer[o], true, geometry) )
+                continue;
+            added = true;
+            for( int inner: mp.inner ) {
+                if( ways[inner].nodes.empty() )
+                    continue;
+                // the inner ring belongs to the first outer ring that contains it, or to the first outer ring
+                const auto &first = m_Model.Nodes()[ways[inner].nodes.front()];
+                std::size_t owner = 0;
+                while( owner < mp.outer.size() && !InsideRing(m_Model, ways[mp.outer[owner]].nodes, first) )
+                    ++owner;
+                if( owner == mp.outer.size() )
+                    owner = 0;
+                if( owner == o )
+                    Ring(inner, false, geometry);
+            }
+        }
+        return added;
+    }
+
+  private:
+    static constexpr double Low = -MvtExporter::Buffer;
+    static constexpr double High = MvtExporter::Extent + MvtExporter::Buffer;
+
+    // Loads the tile coordinates of the way at the current level into m_Points.
+    bool Load(int way) {
+        m_Points.clear();
+        if( m_Pyramid.Extent(way) < m_MinExtent )
+            return false;
+        for( int node_idx: m_Pyramid.Nodes(m_Level, way) ) {
+            const auto &node = m_Model.Nodes()[node_idx];
+            m_Points.push_back({m_X0 + node.x * m_Scale, m_Y0 - node.y * m_Scale});
+        }
+        return true;
+    }
+
+    bool Ring(int way, bool outer, std::vector<std::uint32_t> &geometry) {
+        if( !Load(way) )
+            return false;
+        if( m_Points.size() > 1 && m_Points.front().x == m_Points.back().x && m_Points.front().y == m_Points.back().y )
+            m_Points.pop_back();
+        if( m_Points.size() < 3 )
+            return false;
+        return Emit(ClipRing(m_Points, Low, High), true, geometry, outer);
+    }
+
+    // Quantizes the points and appends them as a line string or a ring to geometry, delta encoded from
+    // the cursor. Degenerate lines and rings are left out.
+    bool Emit(const std::vector<TilePoint> &points, bool ring, std::vector<std::uint32_t> &geometry, bool outer = true) {
+        m_Quantized.clear();
+        for( auto &p: points ) {
+            const std::pair<int, int> q{(int)std::lround(p.x), (int)std::lround(p.y)};
+            if( m_Quantized.empty() || q != m_Quantized.back() )
+                m_Quantized.push_back(q);
+        }
+        if( ring ) {
+            if( m_Quantized.size() > 1 && m_Quantized.front() == m_Quantized.back() )
+                m_Quantized.pop_back();
+            if( m_Quantized.size() < 3 )
+                return false;
+            // twice the signed area; outer rings must have a positive area in tile coordinates (y down),
+            // that is, they run clockwise on screen, and inner rings a negative one
+            std::int64_t area = 0;
+            for( std::size_t i = 0, j = m_Quantized.size() - 1; i < m_Quantized.size(); j = i++ )
+                area += (std::int64_t)m_Quantized[j].first * m_Quantized[i].second -
+                        (std::int64_t)m_Quantized[i].first * m_Quantized[j].second;
+            if( area == 0 )
+                return false;
+            if( (area > 0) != outer )
+                std::reverse(m_Quantized.begin(), m_Quantized.end());
+        }
+        else if( m_Quantized.size() < 2 )
+            return false;
+
+        auto command = [&](Command id, std::size_t count) {
+            geometry.push_back((id & 0x7) | static_cast<std::uint32_t>(count << 3));
+        };
+        auto point = [&](const std::pair<int, int> &q) {
+            geometry.push_back(PbfWriter::ZigZag(q.first - m_CursorX));
+            geometry.push_back(PbfWriter::ZigZag(q.second - m_CursorY));
+            m_CursorX = q.first;
+            m_CursorY = q.second;
+        };
+        command(MoveTo, 1);
+        point(m_Quantized.front());
+        command(LineTo, m_Quantized.size() - 1);
+        for( std::size_t i = 1; i < m_Quantized.size(); ++i )
+            point(m_Quantized[i]);
+        if( ring )
+            command(ClosePath, 1);
+        return true;
+    }
+
+    const Model &m_Model;
+    const WayPyramid &m_Pyramid;
+    double m_Scale = 1.;
+    double m_X0 = 0.;
+    double m_Y0 = 0.;
+    int m_Level = 0;
+    double m_MinExtent = 0.;
+    int m_CursorX = 0;
+    int m_CursorY = 0;
+    std::vector<TilePoint> m_Points;
+    std::vector<std::pair<int, int>> m_Quantized;
+};
+
+MvtExporter::MvtExporter(const Model &model):
+    m_Model(model),
+    m_Index(model),
+    m_Pyramid(model)
+{
+}
+
+std::string MvtExporter::EncodeTile(const TileId &tile) const
+{
+    TileEncoder encoder{m_Model, m_Pyramid, tile};
+    Box query = TileBox(m_Model, tile);
+    const double margin = Buffer * encoder.Unit();
+    query.Extend(query.min_x - margin, query.min_y - margin);
+    query.Extend(query.max_x + margin, query.max_y + margin);
+
+    std::vector<int> ids;
+    auto visible = [&](const SpatialIndex &index) -> const std::vector<int>& {
+        ids.clear();
+        index.Query(query, ids);
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+    std::vector<std::uint32_t> geometry;
+    auto add_polygons = [&](LayerBuilder &layer, const auto &features, const SpatialIndex &index, auto value_of) {
+        for( int id: visible(index) ) {
+            geometry.clear();
+            encoder.BeginFeature();
+            if( encoder.Polygon(features[id], geometry) )
+                layer.AddFeature(id, Polygon, geometry, value_of(features[id]));
+        }
+    };
+    auto no_value = [](const auto &) { return -1; };
+
+    PbfWriter data;
+    {
+        LayerBuilder landuse{"landuse", &LanduseTypeNames};
+        add_polygons(landuse, m_Model.Landuses(), m_Index.Landuses(), [](const Model::Landuse &l) { return (int)l.type; });
+        landuse.Write(data);
+    }
+    {
+        LayerBuilder water{"water"};
+        add_polygons(water, m_Model.Waters(), m_Index.Waters(), no_value);
+        water.Write(data);
+    }
+    {
+        LayerBuilder leisure{"leisure"};
+        add_polygons(leisure, m_Model.Leisures(), m_Index.Leisures(), no_value);
+        leisure.Write(data);
+    }
+    {
+        LayerBuilder railways{"railways"};
+        for( int id: visible(m_Index.Railways()) ) {
+            geometry.clear();
+            encoder.BeginFeature();
+            if( encoder.Line(m_Model.Railways()[id].way, geometry) )
+                railways.AddFeature(id, LineString, geometry);
+        }
+        railways.Write(data);
+    }
+    {
+        LayerBuilder roads{"roads", &RoadTypeNames};
+        for( int id: visible(m_Index.Roads()) ) {
+            auto &road = m_Model.Roads()[id];
+            geometry.clear();
+            encoder.BeginFeature();
+            if( encoder.Line(road.way, geometry) )
+                roads.AddFeature(id, LineString, geometry, (int)road.type);
+        }
+        roads.Write(data);
+    }
+    {
+        LayerBuilder buildings{"buildings"};
+        add_polygons(buildings, m_Model.Buildings(), m_Index.Buildings(), no_value);
+        buildings.Write(data);
+    }
+    return data.Data();
+}
+
+std::vector<TileId> MvtExporter::Tiles(int min_zoom, int max_zoom) const
+{
+    std::vector<TileId> tiles;
+    for( int z = min_zoom; z <= max_zoom; ++z ) {
+        auto level = TilesCovering(m_Model, m_Index.Bounds(), z);
+        tiles.insert(tiles.end(), level.begin(), level.end());
+    }
+    return tiles;
+}
+
+void MvtExporter::EncodeTiles(const std::vector<TileId> &tiles, int n_threads,
+                              const std::function<void(std::size_t, const TileId&, std::string&&)> &on_tile) const
+{
+    if( n_threads <= 0 )
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::atomic<std::size_t> next{0};
+    auto worker = [&]() {
+        for( std::size_t i; (i = next++) < tiles.size(); )
+            on_tile(i, tiles[i], EncodeTile(tiles[i]));
+    };
+    std::vector<std::thread> threads;
+    for( int t = 0; t < n_threads; ++t )
+        threads.emplace_back(worker);
+    for( auto &thread: threads )
+        thread.join();
+}
+
+MvtExporter::Stats MvtExporter::ExportDirectory(const std::string &dir, int min_zoom, int max_zoom, int n_threads) const
+{
+    std::atomic<int> written{0}, empty{0}, failed{0};
+    EncodeTiles(Tiles(min_zoom, max_zoom), n_threads, [&](std::size_t, const TileId &tile, std::string &&data) {
+        if( data.empty() ) {
+            ++empty;
+            return;
+        }
+        const auto file = fs::path{dir} / std::to_string(tile.z) / std::to_string(tile.x) / (std::to_string(tile.y) + ".mvt");
+        std::error_code ec;
+        fs::create_directories(file.parent_path(), ec);
+        std::ofstream os{file, std::ios::binary};
+        if( os.write(data.data(), data.size()) )
+            ++written;
+        else {
+            std::cout << "Failed to write " << file << std::endl;
+            ++failed;
+        }
+    });
+    return {written, empty, failed};
+}
+
+// Writes the lowest `bytes` bytes of the value, least significant first.
+static void WriteLittleEndian(std::ostream &os, std::uint64_t value, int bytes)
+{
+    for( int i = 0; i < bytes; ++i )
+        os.put(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+MvtExporter::Stats MvtExporter::ExportArchive(const std::string &file, int min_zoom, int max_zoom, int n_threads) const
+{
+    const auto tiles = Tiles(min_zoom, max_zoom);
+    std::vector<std::pair<TileId, std::string>> encoded(tiles.size());
+    EncodeTiles(tiles, n_threads, [&](std::size_t i, const TileId &tile, std::string &&data) {
+        encoded[i] = {tile, std::move(data)};
+    });
+
+    Stats stats;
+    for( auto &[tile, data]: encoded ) {
+        if( data.empty() )
+            ++stats.empty;
+        else
+            ++stats.written;
+    }
+    std::ofstream os{file, std::ios::binary};
+    const std::string magic = "MVTARCH1";
+    const int entry_size = 1 + 4 + 4 + 8 + 4;
+    std::uint64_t offset = magic.size() + 4 + (std::uint64_t)stats.written * entry_size;
+    os.write(magic.data(), magic.size());
+    WriteLittleEndian(os, stats.written, 4);
+    for( auto &[tile, data]: encoded ) {
+        if( data.empty() )
+            continue;
+        WriteLittleEndian(os, tile.z, 1);
+        WriteLittleEndian(os, tile.x, 4);
+        WriteLittleEndian(os, tile.y, 4);
+        WriteLittleEndian(os, offset, 8);
+        WriteLittleEndian(os, data.size(), 4);
+        offset += data.size();
+    }
+    for( auto &[tile, data]: encoded )
+        os.write(data.data(), data.size());
+    if( !os ) {
+        std::cout << "Failed to write " << file << std::endl;
+        stats.failed = stats.written;
+        stats.written = 0;
+    }
+    return stats;
+}
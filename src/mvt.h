@@ -0,0 +1,84 @@
+#ifndef MVT_H
+#define MVT_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "model.h"
+#include "spatial_index.h"
+#include "tile_grid.h"
+#include "way_pyramid.h"
+
+// A minimal protocol buffers encoder, with just what vector tiles need: varints, length-delimited
+// fields (strings and embedded messages) and packed repeated uint32 fields.
+class PbfWriter {
+  public:
+    enum WireType { VarintType = 0, LengthDelimitedType = 2 };
+
+    // maps signed to unsigned integers so that values close to zero have short varints: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+    static std::uint32_t ZigZag(std::int32_t value) noexcept {
+        return (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31);
+    }
+
+    void Varint(std::uint64_t value);
+    void Tag(int field, WireType type);
+    void UInt(int field, std::uint64_t value);
+    // a string, or an embedded message that has been encoded on its own
+    void Bytes(int field, const std::string &bytes);
+    void PackedUInt32(int field, const std::vector<std::uint32_t> &values);
+    // appends the fields that have been written to another writer
+    void Append(const PbfWriter &fields) { m_Data += fields.m_Data; }
+
+    const std::string &Data() const noexcept { return m_Data; }
+    bool Empty() const noexcept { return m_Data.empty(); }
+    void Clear() noexcept { m_Data.clear(); }
+
+  private:
+    std::string m_Data;
+};
+
+// Exports the layers of a Model as Mapbox Vector Tiles (version 2): roads (with a "type" attribute),
+// railways, buildings, water, leisure and landuse (with a "type" attribute). Geometry is taken from
+// the simplification level that matches the tile resolution, clipped to the tile plus a small buffer
+// and quantized to the tile extent. The model is only read, so tiles are encoded in parallel.
+class MvtExporter {
+  public:
+    static constexpr int Extent = 4096;  // tile coordinates run from 0 to Extent
+    static constexpr int Buffer = 64;    // geometry is kept up to this far outside the tile
+
+    explicit MvtExporter(const Model &model);
+
+    // The encoded tile, or an empty string if no feature of the model is in the tile.
+    std::string EncodeTile(const TileId &tile) const;
+
+    struct Stats {
+        int written = 0;  // non-empty tiles written
+        int empty = 0;    // tiles of the map area without features, not written
+        int failed = 0;   // tiles that could not be written
+    };
+
+    // Writes the non-empty tiles of the zoom range that cover the map to dir/z/x/y.mvt, using n_threads
+    // threads (the number of hardware threads if 0).
+    Stats ExportDirectory(const std::string &dir, int min_zoom, int max_zoom, int n_threads = 0) const;
+
+    // Writes the non-empty tiles of the zoom range into one archive file: the magic "MVTARCH1", the number
+    // of tiles (uint32), an index entry per tile (z: uint8, x: uint32, y: uint32, offset: uint64,
+    // length: uint32) and then the tile data. Offsets count from the start of the file; all integers are
+    // little endian.
+    Stats ExportArchive(const std::string &file, int min_zoom, int max_zoom, int n_threads = 0) const;
+
+  private:
+    // Encodes the tiles on n_threads threads and calls on_tile(i, tiles[i], data) from the thread that
+    // encoded tile i.
+    void EncodeTiles(const std::vector<TileId> &tiles, int n_threads,
+                     const std::function<void(std::size_t, const TileId&, std::string&&)> &on_tile) const;
+    // the tiles of the zoom range that cover the map
+    std::vector<TileId> Tiles(int min_zoom, int max_zoom) const;
+
+    const Model &m_Model;
+    FeatureIndex m_Index;
+    WayPyramid m_Pyramid;
+};
+
+#endif
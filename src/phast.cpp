@@ -0,0 +1,113 @@
+#include "phast.h"
+#include <algorithm>
+#include <limits>
+
+Phast::Phast(const ContractionHierarchy &hierarchy):
+    m_Hierarchy(hierarchy)
+{
+    // sweep from the highest rank down, so the edges into a node come from earlier positions
+    const int n = hierarchy.NumNodes();
+    m_Position.resize(n);
+    m_Order.resize(n);
+    for( int node = 0; node < n; ++node ) {
+        m_Position[node] = n - 1 - hierarchy.Rank(node);
+        m_Order[m_Position[node]] = node;
+    }
+
+    // The upward edges of a node, seen from the other end, are the downward edges into it. They are
+    // sorted by the position they come from, so the sweep reads the earlier costs in order.
+    auto &first_up = hierarchy.FirstUp();
+    auto &up_edges = hierarchy.UpEdges();
+    m_FirstIn.assign(n + 1, 0);
+    m_InFrom.reserve(up_edges.size());
+    m_InWeight.reserve(up_edges.size());
+    std::vector<std::pair<int, float>> in;
+    for( int p = 0; p < n; ++p ) {
+        const int node = m_Order[p];
+        in.clear();
+        for( int e = first_up[node]; e < first_up[node + 1]; ++e )
+            in.push_back({m_Position[up_edges[e].to], up_edges[e].weight});
+        std::sort(in.begin(), in.end());
+        for( auto &[from, weight]: in ) {
+            m_InFrom.push_back(from);
+            m_InWeight.push_back(weight);
+        }
+        m_FirstIn[p + 1] = (int)m_InFrom.size();
+    }
+    m_Cost.resize(std::size_t(n) * Lanes);
+    m_Upward.Resize(n, (int)up_edges.size());
+}
+
+std::vector<float> Phast::Costs(int source)
+{
+    std::vector<float> costs;
+    Sweep<1>(&source, 1, &costs);
+    return costs;
+}
+
+std::vector<std::vector<float>> Phast::Costs(const std::vector<int> &sources)
+{
+    std::vector<std::vector<float>> costs(sources.size());
+    for( std::size_t i = 0; i < sources.size(); i += Lanes ) {
+        const int n_sources = (int)std::min<std::size_t>(Lanes, sources.size() - i);
+        if( n_sources == 1 )
+            Sweep<1>(&sources[i], 1, &costs[i]);
+        else
+            Sweep<Lanes>(&sources[i], n_sources, &costs[i]);
+    }
+    return costs;
+}
+
+template <int Width>
+void Phast::Sweep(const int *sources, int n_sources, std::vector<float> *costs)
+{
+    const int n = m_Hierarchy.NumNodes();
+    constexpr float infinity = std::numeric_limits<float>::infinity();
+    std::fill(m_Cost.begin(), m_Cost.begin() + std::size_t(n) * Width, infinity);
+
+    // the upward search of each source sets the costs of the nodes above it in its lane
+    auto &first_up = m_Hierarchy.FirstUp();
+    auto &up_edges = m_Hierarchy.UpEdges();
+    for( int k = 0; k < n_sources; ++k ) {
+        m_Upward.Clear();
+        m_Upward.Reach(sources[k], 0.f, -1, -1);
+        m_Upward.Push(sources[k], 0.f);
+        for( int node = m_Upward.Pop(); node >= 0; node = m_Upward.Pop() ) {
+            m_Upward.Close(node);
+            const float g = m_Upward.G(node);
+            m_Cost[std::size_t(m_Position[node]) * Width + k] = g;
+            for( int e = first_up[node]; e < first_up[node + 1]; ++e ) {
+                const float g_next = g + up_edges[e].weight;
+                if( g_next >= m_Upward.G(up_edges[e].to) )
+                    continue;
+                m_Upward.Reach(up_edges[e].to, g_next, node, -1);
+                m_Upward.Push(up_edges[e].to, g_next);
+            }
+        }
+    }
+
+    // the downward sweep; the costs of earlier positions are final when they are read
+    float *cost = m_Cost.data();
+    for( int p = 0; p < n; ++p ) {
+        // the lanes are kept in a local array, which the compiler knows is not written through `from`
+        float best[Width];
+        float *to = cost + std::size_t(p) * Width;
+        std::copy(to, to + Width, best);
+        for( int e = m_FirstIn[p]; e < m_FirstIn[p + 1]; ++e ) {
+            const float *from = cost + std::size_t(m_InFrom[e]) * Width;
+            const float weight = m_InWeight[e];
+            for( int k = 0; k < Width; ++k )
+                best[k] = std::min(best[k], from[k] + weight);
+        }
+        std::copy(best, best + Width, to);
+    }
+
+    const float scale = m_Hierarchy.Scale();
+    for( int k = 0; k < n_sources; ++k ) {
+        costs[k].resize(n);
+        for( int node = 0; node < n; ++node ) {
+            const float c = cost[std::size_t(m_Position[node]) * Width + k];
+            costs[k][node] = c == infinity ? ContractionHierarchy::Infinity : c * scale;
+        }
+    }
+}
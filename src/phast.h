@@ -0,0 +1,49 @@
+#ifndef PHAST_H
+#define PHAST_H
+
+#include <vector>
+#include "contraction_hierarchy.h"
+#include "search_context.h"
+
+// One-to-all route costs on a contraction hierarchy with PHAST: an upward search from the source,
+// followed by one linear sweep over all nodes from the highest rank to the lowest, in which every node
+// takes the lowest cost over its edges from higher ranked nodes. The sweep reads the graph in a layout
+// renumbered in sweep order, so it only walks arrays front to back, and it runs the sweeps of Lanes
+// sources side by side: the costs of a node for all lanes are stored together, and the innermost loop
+// over the lanes is simple enough for the compiler to turn into vector instructions. A single source
+// gets a sweep of one lane, which reads and writes an eighth of the costs.
+//
+// Like a RoutePlanner, a Phast keeps its buffers between calls and only reads the hierarchy; each
+// thread needs its own.
+class Phast {
+  public:
+    static constexpr int Lanes = 8;
+
+    explicit Phast(const ContractionHierarchy &hierarchy);
+
+    // The costs from the source to every node, indexed by node, in the unit of the metric of the
+    // hierarchy; ContractionHierarchy::Infinity for nodes that can not be reached.
+    std::vector<float> Costs(int source);
+    // The costs from each source, Lanes sources per sweep. Much faster per source than Costs(int) when
+    // there are several.
+    std::vector<std::vector<float>> Costs(const std::vector<int> &sources);
+
+  private:
+    // Runs one sweep for up to Width sources and stores the costs of source k into costs[k].
+    template <int Width>
+    void Sweep(const int *sources, int n_sources, std::vector<float> *costs);
+
+    const ContractionHierarchy &m_Hierarchy;
+    // node order[p] is at position p of the sweep; position[node] is the inverse
+    std::vector<int> m_Order;
+    std::vector<int> m_Position;
+    // the edges into position p come from positions InFrom()[FirstIn()[p]] ... (all lower than p)
+    std::vector<int> m_FirstIn;
+    std::vector<int> m_InFrom;
+    std::vector<float> m_InWeight;
+    // the cost of position p for lane k is m_Cost[p * Width + k], for the Width of the sweep
+    std::vector<float> m_Cost;
+    SearchContext m_Upward;
+};
+
+#endif
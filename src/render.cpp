@@ -1,5 +1,9 @@
 #include "render.h"
 #include <iostream>
+#include <map>
+#include <optional>
+#include <algorithm>
+#include <utility>
 
 static float RoadMetricWidth(Model::Road::Type type);
 static io2d::rgba_color RoadColor(Model::Road::Type type);
@@ -7,191 +11,501 @@ static io2d::dashes RoadDashes(Model::Road::Type type);
 static io2d::point_2d ToPoint2D( const Model::Node &node ) noexcept; 
 
 Render::Render( RouteModel &model ):
-    m_Model(model)
+    Render(model, std::make_shared<FeatureIndex>(model), std::make_shared<WayPyramid>(model))
+{
+}
+
+Render::Render( RouteModel &model, std::shared_ptr<const FeatureIndex> index, std::shared_ptr<const WayPyramid> pyramid ):
+    m_Model(model),
+    m_Index(std::move(index)),
+    m_Pyramid(std::move(pyramid))
 {
     BuildRoadReps();
     BuildLanduseBrushes();
+
+    // grey for relaxed nodes, then 8 steps from blue to red for settled nodes
+    m_SearchBrushes.emplace_back(io2d::rgba_color{160, 160, 160});
+    for( int i = 0; i < 8; ++i )
+        m_SearchBrushes.emplace_back(io2d::rgba_color{i * 255 / 7, 0, 255 - i * 255 / 7});
 }
 
-void Render::Display( io2d::output_surface &surface )
+template <typename Surface>
+void Render::Display( Surface &surface )
 {
-    m_Scale = static_cast<float>(std::min(surface.dimensions().x(), surface.dimensions().y()));    
-    m_PixelsInMeter = static_cast<float>(m_Scale / m_Model.MetricScale()); 
-    m_Matrix = io2d::matrix_2d::create_scale({m_Scale, -m_Scale}) *
-               io2d::matrix_2d::create_translate({0.f, static_cast<float>(surface.dimensions().y())});
-    
-    surface.paint(m_BackgroundFillBrush);        
-    DrawLanduses(surface);
-    DrawLeisure(surface);
-    DrawWater(surface);    
-    DrawRailways(surface);
-    DrawHighways(surface);    
-    DrawBuildings(surface);  
-    DrawPath(surface);
-    DrawStartPosition(surface);   
-    DrawEndPosition(surface);
-}
-
-void Render::DrawPath(io2d::output_surface &surface) const{
-    io2d::render_props aliased{ io2d::antialias::none };
-    io2d::brush foreBrush{ io2d::rgba_color::orange}; 
-    float width = 5.0f;
-    surface.stroke(foreBrush, PathLine(), std::nullopt, io2d::stroke_props{width});
+    // The map layers only change with the surface size and the view. They are drawn once into an
+    // offscreen bitmap, which each frame paints in one go before drawing the route on top, so a new
+    // route only costs the route overlay.
+    const int width = surface.dimensions().x();
+    const int height = surface.dimensions().y();
+    {
+        RenderProfiler::Timer frame_timer{m_Profiler, RenderProfiler::Frame};
+        PrepareMap(width, height);
+        if( !m_Basemap ) {
+            auto basemap = io2d::image_surface{io2d::format::argb32, width, height};
+            DrawMap(basemap);
+            m_Basemap.emplace(std::move(basemap));
+        }
+        Timed(RenderProfiler::Basemap, [&]{ surface.paint(*m_Basemap); });
+        DrawOverlays(surface);
+    }
+    if( m_ProfileOverlay )
+        DrawProfile(surface);
+}
 
+template <typename Surface>
+void Render::DisplayOnce( Surface &surface )
+{
+    // the map is drawn straight onto the surface: a bitmap would cost a surface and a second copy of the
+    // map for a view that is not drawn again
+    {
+        RenderProfiler::Timer frame_timer{m_Profiler, RenderProfiler::Frame};
+        PrepareMap(surface.dimensions().x(), surface.dimensions().y());
+        DrawMap(surface);
+        DrawOverlays(surface);
+    }
+    if( m_ProfileOverlay )
+        DrawProfile(surface);
 }
 
-void Render::DrawEndPosition(io2d::output_surface &surface) const{
-    if (m_Model.path.empty()) return;
-    io2d::render_props aliased{ io2d::antialias::none };
-    io2d::brush foreBrush{ io2d::rgba_color::red };
+// Draws the isochrone, the search and the route over the map, rebuilding their paths if they changed.
+template <typename Surface>
+void Render::DrawOverlays( Surface &surface )
+{
+    if( !m_RouteValid || m_Route != m_Model.path || m_Alternatives != m_Model.alternatives )
+        BuildRoutePaths();
+    if( !m_SearchValid )
+        BuildSearchPaths();
+    if( !m_AreaValid )
+        BuildAreaPath();
+
+    Timed(RenderProfiler::Search, [&]{
+        DrawArea(surface);
+        DrawSearch(surface);
+    });
+    Timed(RenderProfiler::Path, [&]{
+        DrawPath(surface);
+        DrawStartPosition(surface);   
+        DrawEndPosition(surface);
+    });
+}
 
-    auto pb = io2d::path_builder{}; 
-    pb.matrix(m_Matrix);
+template <typename Surface>
+void Render::DisplayMap( Surface &surface )
+{
+    PrepareMap(surface.dimensions().x(), surface.dimensions().y());
+    DrawMap(surface);
+}
 
-    pb.new_figure({(float) m_Model.path.back().x, (float) m_Model.path.back().y});
-    float constexpr l_marker = 0.01f;
-    pb.rel_line({l_marker, 0.f});
-    pb.rel_line({0.f, l_marker});
-    pb.rel_line({-l_marker, 0.f});
-    pb.rel_line({0.f, -l_marker});
-    pb.close_figure();
-    
-    surface.fill(foreBrush, pb);
-    surface.stroke(foreBrush, io2d::interpreted_path{pb}, std::nullopt, std::nullopt, std::nullopt, aliased);
+// Rebuilds the map paths if the surface size or the view changed. The basemap bitmap and the route and
+// search overlays then need to be rebuilt too.
+void Render::PrepareMap(int width, int height)
+{
+    if( width == m_Width && height == m_Height && !m_ViewChanged )
+        return;
+    UpdateView(width, height);
+    BuildPaths();
+    m_RouteValid = false;
+    m_SearchValid = false;
+    m_AreaValid = false;
+    m_Basemap.reset();
 }
 
-void Render::DrawStartPosition(io2d::output_surface &surface) const{
-    if (m_Model.path.empty()) return;
+// Draws the background and the map layers, without the route.
+template <typename Surface>
+void Render::DrawMap(Surface &surface) const
+{
+    surface.paint(m_BackgroundFillBrush);        
+    Timed(RenderProfiler::Landuse, [&]{ DrawLanduses(surface); });
+    Timed(RenderProfiler::Leisure, [&]{ DrawLeisure(surface); });
+    Timed(RenderProfiler::Water, [&]{ DrawWater(surface); });
+    Timed(RenderProfiler::Railways, [&]{ DrawRailways(surface); });
+    Timed(RenderProfiler::Highways, [&]{ DrawHighways(surface); });
+    Timed(RenderProfiler::Buildings, [&]{ DrawBuildings(surface); });
+}
 
-    io2d::render_props aliased{ io2d::antialias::none };
-    io2d::brush foreBrush{ io2d::rgba_color::green };
+// Runs draw() and records its time for the layer if profiling is on.
+template <typename F>
+void Render::Timed(RenderProfiler::Layer layer, F &&draw) const
+{
+    RenderProfiler::Timer timer{m_Profiler, layer};
+    draw();
+}
 
-    auto pb = io2d::path_builder{}; 
-    pb.matrix(m_Matrix);
+// Draws the profile as bars in the top left corner, one per layer (io2d can not draw text): the
+// length of a bar is the median time of the layer at 20 pixels per ms, and a tick marks the 95th percentile.
+template <typename Surface>
+void Render::DrawProfile(Surface &surface) const
+{
+    constexpr float pixels_per_ms = 20.f, bar_height = 6.f, spacing = 9.f, left = 8.f;
+    const float max_length = std::max(surface.dimensions().x() - 2.f * left, 1.f);
+    auto bars = io2d::path_builder{};
+    auto ticks = io2d::path_builder{};
+    for( int i = 0; i < RenderProfiler::NumLayers; ++i ) {
+        const auto layer = static_cast<RenderProfiler::Layer>(i);
+        const float top = left + i * spacing;
+        const float median = std::min(static_cast<float>(m_Profiler->Percentile(layer, 50.)) * pixels_per_ms, max_length);
+        const float p95 = std::min(static_cast<float>(m_Profiler->Percentile(layer, 95.)) * pixels_per_ms, max_length);
+        // an empty bar is still one pixel long, so the rows can be told apart
+        bars.new_figure({left, top});
+        bars.rel_line({std::max(median, 1.f), 0.f});
+        bars.rel_line({0.f, bar_height});
+        bars.rel_line({-std::max(median, 1.f), 0.f});
+        bars.close_figure();
+        ticks.new_figure({left + p95, top - 1.f});
+        ticks.rel_line({1.5f, 0.f});
+        ticks.rel_line({0.f, bar_height + 2.f});
+        ticks.rel_line({-1.5f, 0.f});
+        ticks.close_figure();
+    }
+    surface.fill(io2d::brush{io2d::rgba_color{40, 40, 160}}, io2d::interpreted_path{bars});
+    surface.fill(io2d::brush{io2d::rgba_color::red}, io2d::interpreted_path{ticks});
+}
 
-    pb.new_figure({(float) m_Model.path.front().x, (float) m_Model.path.front().y});
-    float constexpr l_marker = 0.01f;
-    pb.rel_line({l_marker, 0.f});
-    pb.rel_line({0.f, l_marker});
-    pb.rel_line({-l_marker, 0.f});
-    pb.rel_line({0.f, -l_marker});
-    pb.close_figure();
-    
-    surface.fill(foreBrush, pb);
-    surface.stroke(foreBrush, io2d::interpreted_path{pb}, std::nullopt, std::nullopt, std::nullopt, aliased);
+void Render::SetView(float center_x, float center_y, float zoom)
+{
+    m_CenterX = center_x;
+    m_CenterY = center_y;
+    m_Zoom = std::max(zoom, 0.01f);
+    m_ViewChanged = true;
 }
 
-void Render::DrawBuildings(io2d::output_surface &surface) const
+void Render::FitView(const Box &box, float max_zoom)
 {
-    for( auto &building: m_Model.Buildings() ) {
-        auto path = PathFromMP(building);
-        surface.fill(m_BuildingFillBrush, path);        
-        surface.stroke(m_BuildingOutlineBrush, path, std::nullopt, m_BuildingOutlineStrokeProps);
-    }
+    if( box.Empty() )
+        return;
+    // at zoom 1 a side of length 1 fills the shorter side of the surface; leave a margin of 10% on each side
+    const double size = std::max(box.max_x - box.min_x, box.max_y - box.min_y);
+    const float zoom = size > 0. ? static_cast<float>(0.8 / size) : max_zoom;
+    SetView(static_cast<float>((box.min_x + box.max_x) / 2.), static_cast<float>((box.min_y + box.max_y) / 2.),
+            std::min(zoom, max_zoom));
 }
 
-void Render::DrawLeisure(io2d::output_surface &surface) const
+void Render::SetProfiler(RenderProfiler *profiler, bool overlay)
 {
-    for( auto &leisure: m_Model.Leisures()) {
-        auto path = PathFromMP(leisure);
-        surface.fill(m_LeisureFillBrush, path);        
-        surface.stroke(m_LeisureOutlineBrush, path, std::nullopt, m_LeisureOutlineStrokeProps);
-    }
+    m_Profiler = profiler;
+    m_ProfileOverlay = profiler && overlay;
 }
 
-void Render::DrawWater(io2d::output_surface &surface) const
+void Render::SetSearchOverlay(const SearchRecorder *recorder, int events)
 {
-    for( auto &water: m_Model.Waters())
-        surface.fill(m_WaterFillBrush, PathFromMP(water));
+    m_Recorder = recorder;
+    m_SearchEvents = events;
+    m_SearchValid = false;
 }
 
-void Render::DrawLanduses(io2d::output_surface &surface) const
+void Render::Pan(float dx, float dy)
 {
-    for( auto &landuse: m_Model.Landuses() )
-        if( auto br = m_LanduseBrushes.find(landuse.type); br != m_LanduseBrushes.end() )        
-            surface.fill(br->second, PathFromMP(landuse));
+    // the y axis of the surface points down, the y axis of the map points up
+    SetView(m_CenterX - dx / m_Scale, m_CenterY + dy / m_Scale, m_Zoom);
 }
 
-void Render::DrawHighways(io2d::output_surface &surface) const
+void Render::Zoom(float factor)
 {
-    auto ways = m_Model.Ways().data();
-    for( auto road: m_Model.Roads() )
-        if( auto rep_it = m_RoadReps.find(road.type); rep_it != m_RoadReps.end() ) {
-            auto &rep = rep_it->second;   
-            auto &way = ways[road.way];
-            auto width = rep.metric_width > 0.f ? (rep.metric_width * m_PixelsInMeter) : 1.f;
-            auto sp = io2d::stroke_props{width, io2d::line_cap::round};
-            surface.stroke(rep.brush, PathFromWay(way), std::nullopt, sp, rep.dashes);        
+    SetView(m_CenterX, m_CenterY, m_Zoom * factor);
+}
+
+// Computes the matrix from map coordinates to surface pixels and the visible part of the map.
+void Render::UpdateView(int width, int height)
+{
+    m_Width = width;
+    m_Height = height;
+    m_ViewChanged = false;
+    m_Scale = static_cast<float>(std::min(width, height)) * m_Zoom;    
+    m_PixelsInMeter = static_cast<float>(m_Scale / m_Model.MetricScale()); 
+    m_Matrix = io2d::matrix_2d::create_translate({-m_CenterX, -m_CenterY}) *
+               io2d::matrix_2d::create_scale({m_Scale, -m_Scale}) *
+               io2d::matrix_2d::create_translate({width / 2.f, height / 2.f});
+
+    // simplify ways by up to half a pixel and leave out features smaller than a pixel
+    m_Level = WayPyramid::LevelFor(0.5 / m_Scale);
+    m_MinExtent = 1.f / m_Scale;
+
+    // widen the viewport by the widest road so that strokes of features just outside it are drawn
+    const double margin = 10. / m_Model.MetricScale();
+    m_Viewport = Box{};
+    m_Viewport.Extend(m_CenterX - width / 2. / m_Scale - margin, m_CenterY - height / 2. / m_Scale - margin);
+    m_Viewport.Extend(m_CenterX + width / 2. / m_Scale + margin, m_CenterY + height / 2. / m_Scale + margin);
+}
+
+// Builds the interpreted paths of the map features in the viewport for the current matrix, one path per style.
+void Render::BuildPaths()
+{
+    // the ids of the features of a layer that intersect the viewport, in model order
+    auto visible = [&](const SpatialIndex &index) -> const std::vector<int>& {
+        m_Visible.clear();
+        index.Query(m_Viewport, m_Visible);
+        std::sort(m_Visible.begin(), m_Visible.end());
+        return m_Visible;
+    };
+    auto merged = [&](const auto &features, const SpatialIndex &index) {
+        auto pb = io2d::path_builder{};
+        pb.matrix(m_Matrix);
+        for( int id: visible(index) )
+            AddMP(pb, features[id]);
+        return io2d::interpreted_path{pb};
+    };
+    m_BuildingsPath = merged(m_Model.Buildings(), m_Index->Buildings());
+    m_LeisuresPath = merged(m_Model.Leisures(), m_Index->Leisures());
+    m_WatersPath = merged(m_Model.Waters(), m_Index->Waters());
+
+    // landuses by type, in the order of Model::Landuse::Type
+    std::map<Model::Landuse::Type, io2d::path_builder> landuse_builders;
+    for( int id: visible(m_Index->Landuses()) )
+        if( auto &landuse = m_Model.Landuses()[id]; m_LanduseBrushes.count(landuse.type) ) {
+            auto [it, inserted] = landuse_builders.try_emplace(landuse.type);
+            if( inserted )
+                it->second.matrix(m_Matrix);
+            AddMP(it->second, landuse);
+        }
+    m_LandusePaths.clear();
+    for( auto &[type, pb]: landuse_builders )
+        m_LandusePaths.emplace_back(&m_LanduseBrushes.at(type), io2d::interpreted_path{pb});
+
+    auto railways = io2d::path_builder{};
+    railways.matrix(m_Matrix);
+    for( int id: visible(m_Index->Railways()) )
+        AddWay(railways, m_Model.Railways()[id].way, false);
+    m_RailwaysPath = io2d::interpreted_path{railways};
+
+    // roads by type, in the order of Model::Road::Type like the sorted Model::Roads()
+    std::map<Model::Road::Type, io2d::path_builder> road_builders;
+    for( int id: visible(m_Index->Roads()) )
+        if( auto &road = m_Model.Roads()[id]; m_RoadReps.count(road.type) ) {
+            auto [it, inserted] = road_builders.try_emplace(road.type);
+            if( inserted )
+                it->second.matrix(m_Matrix);
+            AddWay(it->second, road.way, false);
         }
+    m_HighwayPaths.clear();
+    for( auto &[type, pb]: road_builders )
+        m_HighwayPaths.emplace_back(&m_RoadReps.at(type), io2d::interpreted_path{pb});
 }
 
-void Render::DrawRailways(io2d::output_surface &surface) const
-{     
-    auto ways = m_Model.Ways().data();
-    for( auto &railway: m_Model.Railways() ) {
-        auto &way = ways[railway.way];
-        auto path = PathFromWay(way);
-        surface.stroke(m_RailwayStrokeBrush, path, std::nullopt, io2d::stroke_props{m_RailwayOuterWidth * m_PixelsInMeter});
-        surface.stroke(m_RailwayDashBrush, path, std::nullopt, io2d::stroke_props{m_RailwayInnerWidth * m_PixelsInMeter}, m_RailwayDashes);
+// Builds the paths of the route and of its start and end markers for the current matrix.
+void Render::BuildRoutePaths()
+{
+    m_Route = m_Model.path;
+    m_Alternatives = m_Model.alternatives;
+    m_RouteValid = true;
+    m_RoutePath = PathLine(m_Route);
+    m_AlternativePaths.clear();
+    for( auto &alternative: m_Alternatives )
+        m_AlternativePaths.push_back(PathLine(alternative));
+    if( m_Route.empty() )
+        return;
+    m_StartMarker = PathMarker(m_Model.Nodes()[m_Route.front()]);
+    m_EndMarker = PathMarker(m_Model.Nodes()[m_Route.back()]);
+}
+
+// Builds the search overlay for the current matrix: a small square per recorded node in the viewport.
+void Render::BuildSearchPaths()
+{
+    m_SearchValid = true;
+    m_SearchPaths.clear();
+    if( !m_Recorder )
+        return;
+    const auto &events = m_Recorder->Events();
+    const int n_events = m_SearchEvents < 0 ? (int)events.size() : std::min(m_SearchEvents, (int)events.size());
+    // the heat of a settled node is its position among all settled nodes, so colours do not change while animating
+    long n_settled = 0;
+    for( auto &event: events )
+        n_settled += event.IsSettled();
+
+    std::vector<io2d::path_builder> builders(m_SearchBrushes.size());
+    for( auto &pb: builders )
+        pb.matrix(m_Matrix);
+    const float half = 1.5f / m_Scale;
+    const int levels = (int)m_SearchBrushes.size() - 1;
+    long settled = 0;
+    for( int i = 0; i < n_events; ++i ) {
+        const auto &event = events[i];
+        const int brush = event.IsSettled() ? 1 + (int)(settled++ * levels / n_settled) : 0;
+        const auto &node = m_Model.Nodes()[event.node];
+        if( node.x < m_Viewport.min_x || node.x > m_Viewport.max_x || node.y < m_Viewport.min_y || node.y > m_Viewport.max_y )
+            continue;
+        auto &pb = builders[brush];
+        pb.new_figure({(float)node.x - half, (float)node.y - half});
+        pb.rel_line({2.f * half, 0.f});
+        pb.rel_line({0.f, 2.f * half});
+        pb.rel_line({-2.f * half, 0.f});
+        pb.close_figure();
     }
+    for( auto &pb: builders )
+        m_SearchPaths.emplace_back(pb);
 }
 
-io2d::interpreted_path Render::PathLine() const
-{    
-    if( m_Model.path.empty() )
-        return {};
+void Render::SetIsochrone(const Isochrone *isochrone)
+{
+    m_Isochrone = isochrone;
+    m_AreaValid = false;
+}
 
-    const auto nodes = m_Model.path;    
-    
+// Builds the isochrone overlay for the current matrix.
+void Render::BuildAreaPath()
+{
+    m_AreaValid = true;
     auto pb = io2d::path_builder{};
     pb.matrix(m_Matrix);
-    pb.new_figure( ToPoint2D( m_Model.path[0]));
+    if( m_Isochrone )
+        for( auto &ring: m_Isochrone->area ) {
+            if( ring.size() < 3 )
+                continue;
+            pb.new_figure(ToPoint2D(ring.front()));
+            for( std::size_t i = 1; i < ring.size(); ++i )
+                pb.line(ToPoint2D(ring[i]));
+            pb.close_figure();
+        }
+    m_AreaPath = io2d::interpreted_path{pb};
+}
 
-    for( int i=1; i< m_Model.path.size();i++ )
-        pb.line( ToPoint2D(m_Model.path[i])); 
+template <typename Surface>
+void Render::DrawArea(Surface &surface) const
+{
+    if( !m_Isochrone )
+        return;
+    surface.fill(m_AreaFillBrush, m_AreaPath);
+    surface.stroke(m_AreaOutlineBrush, m_AreaPath, std::nullopt, io2d::stroke_props{2.f});
+}
 
-      
-    return io2d::interpreted_path{pb};
+template <typename Surface>
+void Render::DrawSearch(Surface &surface) const
+{
+    for( std::size_t i = 0; i < m_SearchPaths.size(); ++i )
+        surface.fill(m_SearchBrushes[i], m_SearchPaths[i]);
+}
+
+template <typename Surface>
+void Render::DrawPath(Surface &surface) const{
+    io2d::brush foreBrush{ io2d::rgba_color::orange}; 
+    float width = 5.0f;
+    // the alternatives go under the route, thinner
+    for( auto &alternative: m_AlternativePaths )
+        surface.stroke(m_AlternativeBrush, alternative, std::nullopt, io2d::stroke_props{0.7f * width});
+    surface.stroke(foreBrush, m_RoutePath, std::nullopt, io2d::stroke_props{width});
+
+}
+
+template <typename Surface>
+void Render::DrawEndPosition(Surface &surface) const{
+    if (m_Route.empty()) return;
+    io2d::render_props aliased{ io2d::antialias::none };
+    io2d::brush foreBrush{ io2d::rgba_color::red };
+    surface.fill(foreBrush, m_EndMarker);
+    surface.stroke(foreBrush, m_EndMarker, std::nullopt, std::nullopt, std::nullopt, aliased);
+}
+
+template <typename Surface>
+void Render::DrawStartPosition(Surface &surface) const{
+    if (m_Route.empty()) return;
+    io2d::render_props aliased{ io2d::antialias::none };
+    io2d::brush foreBrush{ io2d::rgba_color::green };
+    surface.fill(foreBrush, m_StartMarker);
+    surface.stroke(foreBrush, m_StartMarker, std::nullopt, std::nullopt, std::nullopt, aliased);
+}
+
+template <typename Surface>
+void Render::DrawBuildings(Surface &surface) const
+{
+    surface.fill(m_BuildingFillBrush, m_BuildingsPath);        
+    surface.stroke(m_BuildingOutlineBrush, m_BuildingsPath, std::nullopt, m_BuildingOutlineStrokeProps);
+}
+
+template <typename Surface>
+void Render::DrawLeisure(Surface &surface) const
+{
+    surface.fill(m_LeisureFillBrush, m_LeisuresPath);        
+    surface.stroke(m_LeisureOutlineBrush, m_LeisuresPath, std::nullopt, m_LeisureOutlineStrokeProps);
+}
+
+template <typename Surface>
+void Render::DrawWater(Surface &surface) const
+{
+    surface.fill(m_WaterFillBrush, m_WatersPath);
 }
 
-io2d::interpreted_path Render::PathFromWay(const Model::Way &way) const
+template <typename Surface>
+void Render::DrawLanduses(Surface &surface) const
+{
+    for( auto &[brush, path]: m_LandusePaths )
+        surface.fill(*brush, path);
+}
+
+template <typename Surface>
+void Render::DrawHighways(Surface &surface) const
+{
+    for( auto &[rep, path]: m_HighwayPaths ) {
+        auto width = rep->metric_width > 0.f ? (rep->metric_width * m_PixelsInMeter) : 1.f;
+        auto sp = io2d::stroke_props{width, io2d::line_cap::round};
+        surface.stroke(rep->brush, path, std::nullopt, sp, rep->dashes);        
+    }
+}
+
+template <typename Surface>
+void Render::DrawRailways(Surface &surface) const
+{     
+    surface.stroke(m_RailwayStrokeBrush, m_RailwaysPath, std::nullopt, io2d::stroke_props{m_RailwayOuterWidth * m_PixelsInMeter});
+    surface.stroke(m_RailwayDashBrush, m_RailwaysPath, std::nullopt, io2d::stroke_props{m_RailwayInnerWidth * m_PixelsInMeter}, m_RailwayDashes);
+}
+
+io2d::interpreted_path Render::PathLine(const std::vector<int> &path) const
 {    
-    if( way.nodes.empty() )
+    if( path.empty() )
         return {};
 
     const auto nodes = m_Model.Nodes().data();    
     
     auto pb = io2d::path_builder{};
     pb.matrix(m_Matrix);
-    pb.new_figure( ToPoint2D(nodes[way.nodes.front()]) );
-    for( auto it = ++way.nodes.begin(); it != std::end(way.nodes); ++it )
-        pb.line( ToPoint2D(nodes[*it]) );     
+    pb.new_figure( ToPoint2D(nodes[path[0]]) );
+
+    for( int i=1; i< path.size();i++ )
+        pb.line( ToPoint2D(nodes[path[i]]) ); 
+
+      
     return io2d::interpreted_path{pb};
 }
 
-io2d::interpreted_path Render::PathFromMP(const Model::Multipolygon &mp) const
+// A small square marking a node of the route
+io2d::interpreted_path Render::PathMarker(const Model::Node &node) const
 {
-    const auto nodes = m_Model.Nodes().data();
-    const auto ways = m_Model.Ways().data();
+    auto pb = io2d::path_builder{}; 
+    pb.matrix(m_Matrix);
 
-    auto pb = io2d::path_builder{};    
-    pb.matrix(m_Matrix);    
-    
-    auto commit = [&](const Model::Way &way) {
-        if( way.nodes.empty() )
-            return;
-        pb.new_figure( ToPoint2D(nodes[way.nodes.front()]) );
-        for( auto it = ++way.nodes.begin(); it != std::end(way.nodes); ++it )
-            pb.line( ToPoint2D(nodes[*it]) );        
+    pb.new_figure({(float) node.x, (float) node.y});
+    float constexpr l_marker = 0.01f;
+    pb.rel_line({l_marker, 0.f});
+    pb.rel_line({0.f, l_marker});
+    pb.rel_line({-l_marker, 0.f});
+    pb.rel_line({0.f, -l_marker});
+    pb.close_figure();
+    return io2d::interpreted_path{pb};
+}
+
+// Appends the way as a new figure to the path builder, closed for polygon rings. The way is taken from
+// the simplification level of the current zoom, and left out if it is smaller than a pixel.
+void Render::AddWay(io2d::path_builder &pb, int way, bool close) const
+{
+    if( m_Pyramid->Extent(way) < m_MinExtent )
+        return;
+    const auto way_nodes = m_Pyramid->Nodes(m_Level, way);
+    if( way_nodes.empty() )
+        return;
+
+    const auto nodes = m_Model.Nodes().data();    
+    pb.new_figure( ToPoint2D(nodes[*way_nodes.begin()]) );
+    for( auto it = way_nodes.begin() + 1; it != way_nodes.end(); ++it )
+        pb.line( ToPoint2D(nodes[*it]) );     
+    if( close )
         pb.close_figure();        
-    };
-    
+}
+
+// Appends the outer and inner rings of the multipolygon as closed figures to the path builder.
+void Render::AddMP(io2d::path_builder &pb, const Model::Multipolygon &mp) const
+{
     for( auto way_num: mp.outer )
-        commit( ways[way_num] );
+        AddWay( pb, way_num, true );
     for( auto way_num: mp.inner )
-        commit( ways[way_num] );
-    
-    return io2d::interpreted_path{pb};
+        AddWay( pb, way_num, true );
 }
 
 void Render::BuildRoadReps()
@@ -258,4 +572,12 @@ static io2d::dashes RoadDashes(Model::Road::Type type)
 static io2d::point_2d ToPoint2D( const Model::Node &node ) noexcept
 {
     return io2d::point_2d(static_cast<float>(node.x), static_cast<float>(node.y));
-}
\ No newline at end of file
+}
+
+// Display() and DisplayMap() are defined here, so they are instantiated for the two kinds of surface it is used with.
+template void Render::Display(io2d::output_surface &surface);
+template void Render::Display(io2d::image_surface &surface);
+template void Render::DisplayOnce(io2d::output_surface &surface);
+template void Render::DisplayOnce(io2d::image_surface &surface);
+template void Render::DisplayMap(io2d::output_surface &surface);
+template void Render::DisplayMap(io2d::image_surface &surface);
@@ -1,8 +1,17 @@
 #pragma once
 
+#include <memory>
+#include <optional>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 #include <io2d.h>
+#include "isochrone.h"
 #include "route_model.h"
+#include "render_profiler.h"
+#include "search_recorder.h"
+#include "spatial_index.h"
+#include "way_pyramid.h"
 
 using namespace std::experimental;
 
@@ -10,30 +19,93 @@ class Render
 {
 public:
     Render(RouteModel &model );
-    void Display( io2d::output_surface &surface );
+    // A Render that shares the (read-only) spatial index and simplified geometry of the model with
+    // other Render objects, e.g. one per thread.
+    Render(RouteModel &model, std::shared_ptr<const FeatureIndex> index, std::shared_ptr<const WayPyramid> pyramid);
+    // Draws the map and the route onto the surface: an io2d::output_surface window, or an
+    // io2d::image_surface for offscreen rendering.
+    template <typename Surface>
+    void Display( Surface &surface );
+    // The same, for a view that is drawn only once (e.g. a snapshot): the map is drawn straight onto
+    // the surface instead of into the basemap bitmap that Display() keeps for the following frames.
+    template <typename Surface>
+    void DisplayOnce( Surface &surface );
+    // Draws the map without the route. Does not read the route of the model.
+    template <typename Surface>
+    void DisplayMap( Surface &surface );
+
+    // The view is centred on (center_x, center_y) in map coordinates (0 to 1 across the map bounds).
+    // At zoom 1 the whole map fits the surface; at zoom 2 half of it does, and so on.
+    void SetView(float center_x, float center_y, float zoom);
+    // Centres the view on the box (in map coordinates) and zooms so that it fills most of the surface.
+    void FitView(const Box &box, float max_zoom = 64.f);
+    // Moves the view by (dx, dy) pixels.
+    void Pan(float dx, float dy);
+    // Zooms in (factor > 1) or out (factor < 1) around the centre of the view.
+    void Zoom(float factor);
+
+    // Overlays the nodes explored by a recorded search: settled nodes coloured from blue (settled early)
+    // to red (settled late), nodes that were only relaxed in grey. Only the first `events` events are
+    // shown (all if negative), so raising the count from frame to frame animates the search. Call it
+    // again after the recorder records a new search; nullptr removes the overlay.
+    void SetSearchOverlay(const SearchRecorder *recorder, int events = -1);
+
+    // Overlays the reachable area of an isochrone as a translucent fill under the route. Call it again
+    // after the isochrone changes; nullptr removes the overlay.
+    void SetIsochrone(const Isochrone *isochrone);
+
+    // Records the time of each layer and of each frame into the profiler (nullptr stops profiling).
+    // With overlay the rolling median and 95th percentile of each layer are drawn as bars on each frame.
+    void SetProfiler(RenderProfiler *profiler, bool overlay = false);
     
 private:
     void BuildRoadReps();
     void BuildLanduseBrushes();
+    void UpdateView(int width, int height);
+    void PrepareMap(int width, int height);
+    void BuildPaths();
+    void BuildRoutePaths();
+    void BuildSearchPaths();
+    void BuildAreaPath();
     
-    void DrawBuildings(io2d::output_surface &surface) const;
-    void DrawHighways(io2d::output_surface &surface) const;
-    void DrawRailways(io2d::output_surface &surface) const;
-    void DrawLeisure(io2d::output_surface &surface) const;
-    void DrawWater(io2d::output_surface &surface) const;
-    void DrawLanduses(io2d::output_surface &surface) const;
-    void DrawStartPosition(io2d::output_surface &surface) const;
-    void DrawEndPosition(io2d::output_surface &surface) const;
-    void DrawPath(io2d::output_surface &surface) const;
-    io2d::interpreted_path PathFromWay(const Model::Way &way) const;
-    io2d::interpreted_path PathFromMP(const Model::Multipolygon &mp) const;
-    io2d::interpreted_path PathLine() const;
+    template <typename Surface> void DrawMap(Surface &surface) const;
+    template <typename Surface> void DrawOverlays(Surface &surface);
+    template <typename Surface> void DrawBuildings(Surface &surface) const;
+    template <typename Surface> void DrawHighways(Surface &surface) const;
+    template <typename Surface> void DrawRailways(Surface &surface) const;
+    template <typename Surface> void DrawLeisure(Surface &surface) const;
+    template <typename Surface> void DrawWater(Surface &surface) const;
+    template <typename Surface> void DrawLanduses(Surface &surface) const;
+    template <typename Surface> void DrawStartPosition(Surface &surface) const;
+    template <typename Surface> void DrawEndPosition(Surface &surface) const;
+    template <typename Surface> void DrawPath(Surface &surface) const;
+    template <typename Surface> void DrawSearch(Surface &surface) const;
+    template <typename Surface> void DrawArea(Surface &surface) const;
+    template <typename Surface> void DrawProfile(Surface &surface) const;
+    template <typename F> void Timed(RenderProfiler::Layer layer, F &&draw) const;
+    void AddWay(io2d::path_builder &pb, int way, bool close) const;
+    void AddMP(io2d::path_builder &pb, const Model::Multipolygon &mp) const;
+    io2d::interpreted_path PathLine(const std::vector<int> &path) const;
+    io2d::interpreted_path PathMarker(const Model::Node &node) const;
 
     
     RouteModel &m_Model;
     float m_Scale = 1.f;
     float m_PixelsInMeter = 1.f;
     io2d::matrix_2d m_Matrix;
+
+    float m_CenterX = 0.5f;
+    float m_CenterY = 0.5f;
+    float m_Zoom = 1.f;
+    bool m_ViewChanged = true;
+    // the visible part of the map in map coordinates; only features that intersect it are drawn
+    Box m_Viewport;
+    std::shared_ptr<const FeatureIndex> m_Index;
+    std::vector<int> m_Visible; // scratch buffer for index queries
+    // simplified geometry; ways are drawn at level m_Level and left out below m_MinExtent map units
+    std::shared_ptr<const WayPyramid> m_Pyramid;
+    int m_Level = 0;
+    float m_MinExtent = 0.f;
     
     io2d::brush m_BackgroundFillBrush{ io2d::rgba_color{238, 235, 227} };
     
@@ -61,4 +133,46 @@ private:
     std::unordered_map<Model::Road::Type, RoadRep> m_RoadReps;
     
     std::unordered_map<Model::Landuse::Type, io2d::brush> m_LanduseBrushes;
+
+    // Interpreted paths are cached between frames. BuildPaths() rebuilds the map layers when the
+    // surface size or the view changes; BuildRoutePaths() rebuilds the route and its markers when the route changes.
+    // All features drawn with the same style are merged into one multi-figure path, so each layer
+    // is drawn with one fill or stroke per style.
+    int m_Width = 0;
+    int m_Height = 0;
+    io2d::interpreted_path m_BuildingsPath;
+    io2d::interpreted_path m_LeisuresPath;
+    io2d::interpreted_path m_WatersPath;
+    io2d::interpreted_path m_RailwaysPath;
+    std::vector<std::pair<const io2d::brush*, io2d::interpreted_path>> m_LandusePaths; // one per landuse type
+    std::vector<std::pair<const RoadRep*, io2d::interpreted_path>> m_HighwayPaths;     // one per road type
+
+    // the map layers drawn into a bitmap of the surface size, painted as the background of each frame
+    std::optional<io2d::brush> m_Basemap;
+
+    std::vector<int> m_Route; // the route m_RoutePath was built for
+    std::vector<std::vector<int>> m_Alternatives; // the alternatives m_AlternativePaths were built for
+    std::vector<io2d::interpreted_path> m_AlternativePaths;
+    io2d::brush m_AlternativeBrush{ io2d::rgba_color{120, 120, 220} };
+    bool m_RouteValid = false; // false if the route paths were built for an older matrix
+    io2d::interpreted_path m_RoutePath;
+    io2d::interpreted_path m_StartMarker;
+    io2d::interpreted_path m_EndMarker;
+
+    // search overlay: one path per brush, the relaxed nodes first and then the settled nodes by heat
+    const SearchRecorder *m_Recorder = nullptr;
+    int m_SearchEvents = -1;
+    bool m_SearchValid = true;
+    std::vector<io2d::brush> m_SearchBrushes;
+    std::vector<io2d::interpreted_path> m_SearchPaths;
+
+    // isochrone overlay: all outlines of the reachable area in one path
+    const Isochrone *m_Isochrone = nullptr;
+    bool m_AreaValid = true;
+    io2d::interpreted_path m_AreaPath;
+    io2d::brush m_AreaFillBrush{ io2d::rgba_color{64, 96, 255, 80} };
+    io2d::brush m_AreaOutlineBrush{ io2d::rgba_color{64, 96, 255, 200} };
+
+    RenderProfiler *m_Profiler = nullptr;
+    bool m_ProfileOverlay = false;
 };
\ No newline at end of file
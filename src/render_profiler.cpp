@@ -0,0 +1,47 @@
+#include "render_profiler.h"
+#include <algorithm>
+#include <cmath>
+
+const char *RenderProfiler::LayerName(Layer layer) noexcept
+{
+    static const char *names[NumLayers] = {"landuse", "leisure", "water", "railways", "highways", "buildings",
+                                           "basemap", "search", "path", "frame"};
+    return layer >= 0 && layer < NumLayers ? names[layer] : "";
+}
+
+RenderProfiler::RenderProfiler(int window): m_Window(std::max(window, 1))
+{
+    for( auto &samples: m_Samples )
+        samples.reserve(m_Window);
+    m_Scratch.reserve(m_Window);
+}
+
+void RenderProfiler::Record(Layer layer, double milliseconds)
+{
+    auto &samples = m_Samples[layer];
+    if( (int)samples.size() < m_Window )
+        samples.push_back(static_cast<float>(milliseconds));
+    else
+        samples[m_Next[layer]] = static_cast<float>(milliseconds);
+    m_Next[layer] = (m_Next[layer] + 1) % m_Window;
+}
+
+double RenderProfiler::Percentile(Layer layer, double p) const
+{
+    const auto &samples = m_Samples[layer];
+    if( samples.empty() )
+        return 0.;
+    // nearest rank
+    m_Scratch.assign(samples.begin(), samples.end());
+    const int rank = std::clamp((int)std::ceil(p / 100. * m_Scratch.size()) - 1, 0, (int)m_Scratch.size() - 1);
+    std::nth_element(m_Scratch.begin(), m_Scratch.begin() + rank, m_Scratch.end());
+    return m_Scratch[rank];
+}
+
+double RenderProfiler::Last(Layer layer) const noexcept
+{
+    const auto &samples = m_Samples[layer];
+    if( samples.empty() )
+        return 0.;
+    return samples[(m_Next[layer] + m_Window - 1) % m_Window];
+}
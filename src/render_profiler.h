@@ -0,0 +1,55 @@
+#ifndef RENDER_PROFILER_H
+#define RENDER_PROFILER_H
+
+#include <chrono>
+#include <vector>
+
+// Collects how long Render spends on each layer, keeping the last `window` samples of each layer
+// so that percentiles follow the recent frames. Times are wall-clock times of the drawing calls,
+// measured with a steady clock.
+class RenderProfiler {
+  public:
+    // The map layers are only drawn when the cached basemap is rebuilt; Basemap is the time to paint the
+    // cached bitmap, and Frame the time of a whole Display() call.
+    enum Layer { Landuse, Leisure, Water, Railways, Highways, Buildings, Basemap, Search, Path, Frame, NumLayers };
+
+    static const char *LayerName(Layer layer) noexcept;
+
+    explicit RenderProfiler(int window = 120);
+
+    void Record(Layer layer, double milliseconds);
+    // the p-th percentile (0 to 100) of the kept samples of the layer in ms, or 0 if there are none
+    double Percentile(Layer layer, double p) const;
+    // the latest sample of the layer in ms, or 0
+    double Last(Layer layer) const noexcept;
+    int Samples(Layer layer) const noexcept { return (int)m_Samples[layer].size(); }
+
+    // Times its own lifetime and records it for the layer; does nothing if the profiler is nullptr.
+    class Timer {
+      public:
+        Timer(RenderProfiler *profiler, Layer layer) : m_Profiler(profiler), m_Layer(layer) {
+            if (m_Profiler)
+                m_Start = std::chrono::steady_clock::now();
+        }
+        ~Timer() {
+            if (m_Profiler)
+                m_Profiler->Record(m_Layer, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_Start).count());
+        }
+        Timer(const Timer&) = delete;
+        Timer &operator=(const Timer&) = delete;
+
+      private:
+        RenderProfiler *m_Profiler;
+        Layer m_Layer;
+        std::chrono::steady_clock::time_point m_Start;
+    };
+
+  private:
+    int m_Window;
+    // per layer a ring buffer of up to m_Window samples; m_Next is where the next sample goes
+    std::vector<float> m_Samples[NumLayers];
+    int m_Next[NumLayers] = {};
+    mutable std::vector<float> m_Scratch;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#include "route_cache.h"
+#include <algorithm>
+
+// the bytes an entry takes apart from its path: list and hash table nodes, the shared_ptr control block
+// and the Route itself
+static constexpr std::size_t EntryOverhead = 128;
+
+RouteCache::RouteCache(const RouteModel &model, std::size_t memory_budget, int n_shards):
+    m_Model(model),
+    m_ShardBudget(memory_budget / std::max(1, n_shards)),
+    m_Shards(std::max(1, n_shards))
+{
+    for( auto &shard: m_Shards )
+        shard.version = model.Version();
+}
+
+std::size_t RouteCache::KeyHash::operator()(const Key &key) const noexcept
+{
+    // a 64 bit mix (from splitmix64) of the four fields, so that the high and the low bits both vary
+    std::uint64_t h = (std::uint64_t(std::uint32_t(key.start)) << 32) | std::uint32_t(key.end);
+    h ^= std::uint64_t(key.profile * RouteModel::NumMetrics + key.metric) * 0x9e3779b97f4a7c15ull;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+    return static_cast<std::size_t>(h ^ (h >> 31));
+}
+
+void RouteCache::Shard::Refresh(std::uint64_t model_version)
+{
+    if( version == model_version )
+        return;
+    entries.clear();
+    index.clear();
+    bytes = 0;
+    version = model_version;
+}
+
+std::shared_ptr<const RouteCache::Route> RouteCache::Find(const Key &key)
+{
+    auto &shard = ShardFor(key);
+    std::lock_guard<std::mutex> lock{shard.mutex};
+    shard.Refresh(m_Model.Version());
+    auto it = shard.index.find(key);
+    if( it == shard.index.end() ) {
+        ++m_Misses;
+        return nullptr;
+    }
+    ++m_Hits;
+    // move the entry to the front: it is now the most recently used
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    return it->second->route;
+}
+
+void RouteCache::Insert(const Key &key, std::uint64_t version, Route route)
+{
+    // the route was computed with edge weights that have changed since
+    if( version != m_Model.Version() )
+        return;
+    const std::size_t bytes = EntryOverhead + route.path.size() * sizeof(int);
+    if( bytes > m_ShardBudget )
+        return;
+    // trim the path to its size before the lock is taken
+    route.path.shrink_to_fit();
+    auto shared = std::make_shared<const Route>(std::move(route));
+
+    auto &shard = ShardFor(key);
+    std::lock_guard<std::mutex> lock{shard.mutex};
+    shard.Refresh(version);
+    if( auto it = shard.index.find(key); it != shard.index.end() ) {
+        // another thread has stored the same query meanwhile
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        return;
+    }
+    shard.entries.push_front({key, std::move(shared), bytes});
+    shard.index.emplace(key, shard.entries.begin());
+    shard.bytes += bytes;
+    while( shard.bytes > m_ShardBudget ) {
+        auto &oldest = shard.entries.back();
+        shard.bytes -= oldest.bytes;
+        shard.index.erase(oldest.key);
+        shard.entries.pop_back();
+        ++m_Evictions;
+    }
+}
+
+void RouteCache::Clear()
+{
+    for( auto &shard: m_Shards ) {
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        shard.entries.clear();
+        shard.index.clear();
+        shard.bytes = 0;
+    }
+}
+
+std::size_t RouteCache::Size() const
+{
+    std::size_t size = 0;
+    for( auto &shard: m_Shards ) {
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        size += shard.entries.size();
+    }
+    return size;
+}
+
+std::size_t RouteCache::MemoryUsed() const
+{
+    std::size_t bytes = 0;
+    for( auto &shard: m_Shards ) {
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        bytes += shard.bytes;
+    }
+    return bytes;
+}
@@ -0,0 +1,87 @@
+#ifndef ROUTE_CACHE_H
+#define ROUTE_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "route_model.h"
+
+// A least recently used cache of routes, keyed on the snapped start and end nodes, the profile and the
+// metric of a query, so that repeated queries skip the search. It is split into shards, each with its own
+// lock and its own share of the memory budget, so that many threads can use it at once.
+//
+// Results depend on the edge weights, so every entry is stamped with the RouteModel::Version() it was
+// computed for: a shard that sees a newer version drops all its entries, and results computed for an
+// older version are not stored.
+class RouteCache {
+  public:
+    struct Key {
+        int start;
+        int end;
+        RouteModel::Profile profile;
+        RouteModel::Metric metric;
+        bool operator==(const Key &other) const noexcept {
+            return start == other.start && end == other.end && profile == other.profile && metric == other.metric;
+        }
+    };
+    // A cached result; its path is shared with the callers that found it, so it is never copied.
+    struct Route {
+        std::vector<int> path;  // node indices from start to end; empty if there is no route
+        float distance = 0.f;
+        float duration = 0.f;
+    };
+
+    // memory_budget is the approximate number of bytes the entries may take in total.
+    explicit RouteCache(const RouteModel &model, std::size_t memory_budget = 64 << 20, int n_shards = 16);
+
+    // The cached route for the key, or nullptr. Counts a hit or a miss.
+    std::shared_ptr<const Route> Find(const Key &key);
+    // Stores a route computed while the model was at the given version; the least recently used
+    // entries of the shard are dropped to stay within its budget.
+    void Insert(const Key &key, std::uint64_t version, Route route);
+    // Drops all entries.
+    void Clear();
+
+    std::uint64_t Hits() const noexcept { return m_Hits; }
+    std::uint64_t Misses() const noexcept { return m_Misses; }
+    std::uint64_t Evictions() const noexcept { return m_Evictions; }
+    std::size_t Size() const;
+    std::size_t MemoryUsed() const;
+
+  private:
+    struct KeyHash {
+        std::size_t operator()(const Key &key) const noexcept;
+    };
+    struct Entry {
+        Key key;
+        std::shared_ptr<const Route> route;
+        std::size_t bytes;
+    };
+    // The entries of a shard, most recently used first, and an index into them.
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> entries;
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+        std::size_t bytes = 0;
+        std::uint64_t version = 0;
+
+        // drops everything if the model has changed since the entries were stored; call with the lock held
+        void Refresh(std::uint64_t model_version);
+    };
+
+    // the shard is chosen by the high bits of the hash, the buckets of its index by the low bits
+    Shard &ShardFor(const Key &key) { return m_Shards[(KeyHash{}(key) >> 32) % m_Shards.size()]; }
+
+    const RouteModel &m_Model;
+    std::size_t m_ShardBudget;
+    std::vector<Shard> m_Shards;
+    std::atomic<std::uint64_t> m_Hits{0};
+    std::atomic<std::uint64_t> m_Misses{0};
+    std::atomic<std::uint64_t> m_Evictions{0};
+};
+
+#endif
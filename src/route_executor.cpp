@@ -0,0 +1,168 @@
+#include "route_executor.h"
+#include <algorithm>
+#include "route_planner.h"
+
+// What a RouteFuture and the worker running its query share. The monitor is read and written without
+// the mutex; everything else is guarded by it.
+struct RouteFuture::State {
+    RouteRequest request;
+    SearchMonitor monitor;
+    std::mutex mutex;
+    std::condition_variable done_changed;
+    bool done = false;
+    RouteResult result;
+    std::function<void(const RouteResult &)> callback;
+
+    // Stores the result, wakes the waiters and runs the callback outside the lock.
+    void Finish(RouteResult &&route) {
+        std::function<void(const RouteResult &)> then;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            result = std::move(route);
+            done = true;
+            then = std::move(callback);
+        }
+        done_changed.notify_all();
+        if( then )
+            then(result);
+    }
+};
+
+bool RouteFuture::Ready() const
+{
+    std::lock_guard<std::mutex> lock{m_State->mutex};
+    return m_State->done;
+}
+
+void RouteFuture::Wait() const
+{
+    std::unique_lock<std::mutex> lock{m_State->mutex};
+    m_State->done_changed.wait(lock, [&] { return m_State->done; });
+}
+
+bool RouteFuture::WaitFor(std::chrono::milliseconds timeout) const
+{
+    std::unique_lock<std::mutex> lock{m_State->mutex};
+    return m_State->done_changed.wait_for(lock, timeout, [&] { return m_State->done; });
+}
+
+const RouteResult &RouteFuture::Get() const
+{
+    Wait();
+    return m_State->result;
+}
+
+void RouteFuture::Cancel()
+{
+    m_State->monitor.Cancel();
+}
+
+float RouteFuture::Progress() const
+{
+    return m_State->monitor.Progress();
+}
+
+int RouteFuture::Settled() const
+{
+    return m_State->monitor.Settled();
+}
+
+void RouteFuture::Then(std::function<void(const RouteResult &)> callback)
+{
+    {
+        std::lock_guard<std::mutex> lock{m_State->mutex};
+        if( !m_State->done ) {
+            m_State->callback = std::move(callback);
+            return;
+        }
+    }
+    // the result does not change once done, so it can be read without the lock
+    callback(m_State->result);
+}
+
+RouteExecutor::RouteExecutor(RouteModel &model, int n_threads):
+    m_Model(model)
+{
+    if( n_threads <= 0 )
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    m_Running.resize(n_threads);
+    for( int i = 0; i < n_threads; ++i )
+        m_Workers.emplace_back(&RouteExecutor::Work, this, i);
+}
+
+RouteExecutor::~RouteExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_Mutex};
+        m_Stopping = true;
+        for( auto &state: m_Queue )
+            state->monitor.Cancel();
+        for( auto &state: m_Running )
+            if( state )
+                state->monitor.Cancel();
+    }
+    m_QueueReady.notify_all();
+    for( auto &worker: m_Workers )
+        worker.join();
+}
+
+RouteFuture RouteExecutor::Submit(const RouteRequest &request)
+{
+    auto state = std::make_shared<RouteFuture::State>();
+    state->request = request;
+    {
+        std::lock_guard<std::mutex> lock{m_Mutex};
+        m_Queue.push_back(state);
+    }
+    m_QueueReady.notify_one();
+    return RouteFuture{state};
+}
+
+int RouteExecutor::Queued() const
+{
+    std::lock_guard<std::mutex> lock{m_Mutex};
+    return (int)m_Queue.size();
+}
+
+// Runs queued queries until the executor stops and the queue is empty; queries cancelled while they
+// waited finish without a search.
+void RouteExecutor::Work(int worker)
+{
+    std::unique_ptr<RoutePlanner> planners[RouteModel::NumProfiles][RouteModel::NumMetrics];
+    while( true ) {
+        std::shared_ptr<RouteFuture::State> state;
+        {
+            std::unique_lock<std::mutex> lock{m_Mutex};
+            m_Running[worker] = nullptr;
+            m_QueueReady.wait(lock, [&] { return m_Stopping || !m_Queue.empty(); });
+            if( m_Queue.empty() )
+                return;
+            state = std::move(m_Queue.front());
+            m_Queue.pop_front();
+            // so that the destructor can cancel it while it runs
+            m_Running[worker] = state;
+        }
+        RouteResult result;
+        if( state->monitor.Cancelled() ) {
+            result.cancelled = true;
+            state->Finish(std::move(result));
+            continue;
+        }
+        const auto &request = state->request;
+        auto &planner = planners[request.profile][request.metric];
+        if( !planner )
+            planner = std::make_unique<RoutePlanner>(m_Model, request.profile, request.metric);
+        planner->SetMonitor(&state->monitor);
+        planner->SetEndpoints(request.start_x, request.start_y, request.end_x, request.end_y);
+        result.found = planner->Search();
+        planner->SetMonitor(nullptr);
+        if( result.found ) {
+            result.path = planner->GetPath();
+            result.distance = planner->GetDistance();
+            result.duration = planner->GetDuration();
+        }
+        else
+            result.cancelled = planner->Cancelled();
+        state->Finish(std::move(result));
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef ROUTE_EXECUTOR_H
+#define ROUTE_EXECUTOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "route_model.h"
+#include "route_protocol.h"
+#include "search_monitor.h"
+
+// The outcome of an asynchronous route query.
+struct RouteResult {
+    bool found = false;
+    bool cancelled = false;  // cancelled before it found a route
+    std::vector<int> path;   // node indices from start to end; empty if no route was found
+    float distance = 0.f;    // in meters
+    float duration = 0.f;    // in seconds
+};
+
+// A handle to a query submitted to a RouteExecutor, shared between the submitter and the worker that
+// runs it. Copies refer to the same query. The result can be waited for, polled, or delivered to a
+// callback by Then(), which is what an event loop (or a coroutine awaiter, which would resume itself
+// from the callback) needs to avoid blocking a thread per query.
+class RouteFuture {
+  public:
+    RouteFuture() = default;
+
+    bool Valid() const noexcept { return m_State != nullptr; }
+    bool Ready() const;
+    void Wait() const;
+    // Waits at most the given time; returns Ready().
+    bool WaitFor(std::chrono::milliseconds timeout) const;
+    // Waits for the query and returns its result, which lives as long as a handle to the query.
+    const RouteResult &Get() const;
+
+    // Stops the query: if it is still queued it is dropped without searching, if it is running its
+    // search stops within SearchMonitor::CheckInterval() settled nodes. Either way the result says
+    // cancelled. Does nothing if it has already finished.
+    void Cancel();
+    // The progress of the search from 0 to 1 and the nodes settled so far (see SearchMonitor).
+    float Progress() const;
+    int Settled() const;
+
+    // Calls callback(result) once the query is done: on the worker thread that finishes it, or at once
+    // on this thread if it is already done. Only one callback can be set; a new one replaces the last.
+    void Then(std::function<void(const RouteResult &)> callback);
+
+  private:
+    friend class RouteExecutor;
+    struct State;
+    explicit RouteFuture(std::shared_ptr<State> state) : m_State(std::move(state)) {}
+    std::shared_ptr<State> m_State;
+};
+
+// Runs route queries on a fixed pool of worker threads, so that hundreds of queries in flight share a
+// few threads, each with its own RoutePlanners (one per profile and metric, made when first needed)
+// over the shared read-only model. Queries are run in the order they are submitted.
+class RouteExecutor {
+  public:
+    explicit RouteExecutor(RouteModel &model, int n_threads = 0);  // the number of hardware threads if 0
+    // Cancels the queries that have not finished and waits for the workers.
+    ~RouteExecutor();
+
+    RouteFuture Submit(const RouteRequest &request);
+    // The number of queries submitted but not started yet.
+    int Queued() const;
+
+  private:
+    void Work(int worker);
+
+    RouteModel &m_Model;
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_QueueReady;
+    std::deque<std::shared_ptr<RouteFuture::State>> m_Queue;
+    bool m_Stopping = false;
+    // the query each worker is running, if any
+    std::vector<std::shared_ptr<RouteFuture::State>> m_Running;
+    std::vector<std::thread> m_Workers;
+};
+
+#endif
@@ -1,6 +1,6 @@
 #include "route_model.h"
+#include <stdexcept>
 #include <iostream>
-#include <map>
 
 // Define the class methods. When the class methods are defined outside the class, the 
 // scope resolution operator :: must be used to indicate which class the method belongs to.
@@ -10,120 +10,209 @@
 // It takes a reference to a vector of bytes (xml) and initializes the RouteModel object by 
 // calling the constructor of its base class, Model, with the same xml parameter. The base class 
 // Model is constructed first, and then the constructor body for RouteModel continues.
-RouteModel::RouteModel(const std::vector<std::byte> &xml) : Model(xml) {
+RouteModel::RouteModel(const std::vector<std::byte> &xml, bool hilbert_order) : Model(xml, hilbert_order) {
     // Create RouteModel nodes.
     int counter = 0; // will be used to assign unique indices to the nodes being created.
     // Iterate over the vector of nodes (m_Nodes) in the base class, Nodes, which were returned by calling the Model::Nodes() member function 
     for (Model::Node node : Nodes()) {
         // create new type of Nodes with additional attributes (in addition to .x and .y) and member functions:
-        // Recall constructor: Node(int idx, RouteModel* search_model, Model::Node node
-        // counter = new node index (same as old node index),  this = this instance of a RouteModel object, node = original node  
-        m_Nodes.emplace_back(Node(counter, this, node));
+        // Recall constructor: Node(int idx, Model::Node node)
+        // counter = new node index (same as old node index), node = original node  
+        m_Nodes.emplace_back(Node(counter, node));
         counter++;
     }
-    CreateNodeToRoadHashmap();
+    BuildProfiles();
+    BuildRoadGraph();
+    for (int profile = 0; profile < NumProfiles; ++profile) {
+        LabelComponents(Profile(profile));
+        BuildEdgeWeights(Profile(profile));
+    }
+}
 
-    /*
-    // print created dictionary
-    std::cout << "NodeToRoadHashmap:\n";
 
-    // sort the keys before printing:
-    std::map<int, std::vector<const Model::Road*>> sorted_node_to_road(node_to_road.begin(), node_to_road.end());
+// Fills in the accessible road types, and the weight and speed per road type of each profile.
+// Cars may not use footways; pedestrians may not use motorways and trunk roads, and prefer
+// quieter roads over main roads.
+void RouteModel::BuildProfiles() {
+    using R = Model::Road;
+    auto set = [](ProfileTable &table, R::Type type, float weight, float speed) {
+        table.road_types |= 1u << type;
+        table.weight[type] = weight;
+        table.speed[type] = speed;
+    };
 
-    for (const auto& pair : sorted_node_to_road) {
-        std::cout << pair.first << ": ";
-        for (auto& road: pair.second){  // roads are memory addresses
-            cout << (*road).way << " "; // prints road way ID
-        }
-        cout << '\n';
+    auto &car = m_Profiles[Car];
+    set(car, R::Motorway, 1.f, 110.f);
+    set(car, R::Trunk, 1.f, 90.f);
+    set(car, R::Primary, 1.f, 70.f);
+    set(car, R::Secondary, 1.f, 60.f);
+    set(car, R::Tertiary, 1.f, 50.f);
+    set(car, R::Unclassified, 1.f, 40.f);
+    set(car, R::Residential, 1.f, 30.f);
+    set(car, R::Service, 1.f, 20.f);
+
+    auto &pedestrian = m_Profiles[Pedestrian];
+    set(pedestrian, R::Footway, 1.f, 5.f);
+    set(pedestrian, R::Residential, 1.f, 5.f);
+    set(pedestrian, R::Service, 1.f, 5.f);
+    set(pedestrian, R::Unclassified, 1.f, 5.f);
+    set(pedestrian, R::Tertiary, 1.1f, 5.f);
+    set(pedestrian, R::Secondary, 1.2f, 5.f);
+    set(pedestrian, R::Primary, 1.2f, 5.f);
+}
+
+// Precomputes the edge weights of a profile for every metric from its weight and speed tables.
+// Edges the profile may not use keep a weight of 0; they are never relaxed.
+void RouteModel::BuildEdgeWeights(Profile profile) {
+    const auto &table = m_Profiles[profile];
+    const std::size_t n_edges = m_EdgeTo.size();
+    auto &distance = m_EdgeWeight[profile][Distance];
+    auto &time = m_EdgeWeight[profile][Time];
+    distance.assign(n_edges, 0.f);
+    time.assign(n_edges, 0.f);
+
+    // edge lengths are in map units; MetricScale() converts them to meters
+    const float meters_per_unit = static_cast<float>(MetricScale());
+    for (std::size_t e = 0; e < n_edges; ++e) {
+        if (!EdgeAccessible((int)e, profile))
+            continue;
+        const auto type = m_EdgeRoadType[e];
+        distance[e] = m_EdgeLength[e] * table.weight[type];
+        time[e] = m_EdgeLength[e] * meters_per_unit / (table.speed[type] / 3.6f);
     }
+}
 
-    cout << "Number of nodes in dictionary: " << node_to_road.size() << '\n';
-    */
+void RouteModel::SetSpeed(Profile profile, Model::Road::Type type, float speed) {
+    m_Profiles[profile].speed[type] = speed;
+    BuildEdgeWeights(profile);
+    ++m_Version;
 }
 
+// Builds the static road graph shared by all profiles: consecutive nodes of every road that at least one
+// profile may use are joined by an edge in both directions. The edges are stored in compressed sparse row
+// form (see route_model.h), and each edge records which profiles may use it.
+void RouteModel::BuildRoadGraph() {
+    const int n_nodes = (int)m_Nodes.size();
+    auto profiles = [&](Model::Road::Type type) {
+        std::uint8_t mask = 0;
+        for (int profile = 0; profile < NumProfiles; ++profile)
+            if (m_Profiles[profile].Accessible(type))
+                mask |= 1u << profile;
+        return mask;
+    };
+    auto routable = [&](const Model::Road &road) { return profiles(road.type) != 0; };
 
-void RouteModel::CreateNodeToRoadHashmap() {
-    // iterate over the vector of roads (m_Roads) in the base class:
+    // first pass: count the edges leaving each node
+    std::vector<int> degree(n_nodes, 0);
     for (const Model::Road &road : Roads()) {
-        // roads have a way ID, "way" and a type, Type (one of 10 options)
-        // If the road is not a footway:
-        if (road.type != Model::Road::Type::Footway) {
-            // get the nodes that correspond to the current road and iterate over them  
-            for (int node_idx : Ways()[road.way].nodes) {
-                // recall, at creation, node_to_road is a dictionary key: int, value: vector<const Model::Road*> (vector of pointers to Road objects)
-                // .find() either points to sought-after element, or end() if not found.
-                // If the current node index is not already a key in the dict 
-                if (node_to_road.find(node_idx) == node_to_road.end()) {
-                    // adds a new entry with an empty vector as the initial value
-                    node_to_road[node_idx] = std::vector<const Model::Road*> ();
-                }
-                // append the current road pointer to the vector associated with the node index
-                node_to_road[node_idx].push_back(&road);
-            }
+        if (!routable(road))
+            continue;
+        const auto &nodes = Ways()[road.way].nodes;
+        for (std::size_t i = 1; i < nodes.size(); ++i) {
+            if (nodes[i - 1] == nodes[i])
+                continue;
+            degree[nodes[i - 1]]++;
+            degree[nodes[i]]++;
         }
     }
-}
 
-// finds neighbours of a node (my_node) given the IDs of nodes that are on the same roads as my_node
-RouteModel::Node* RouteModel::Node::FindNeighbor(std::vector<int> node_indices) {
-    // Initialise a pointer to a Node object and set it to nullptr. 
-    // This pointer will eventually point to the closest node in the loop.
-    Node *closest_node = nullptr;
-    // create a local Node object called node
-    // It is used to store the node obtained from the parent_model during each iteration
-    Node node;
-
-    // interate through each node in node_indices
-    for (int node_index : node_indices) {
-        // parent_model is a pointer to the parent RouteModel object
-        // parent_model->SNodes() accesses the SNodes() member function of the parent_model
-        // which returns a reference to the nodes vector in the parent model. 
-        // get the current node
-        node = parent_model->SNodes()[node_index];
-        // this->distance(node) accesses the distance() member function of the RouteModel object
-        // make sure the current node is not my_node and the node has not been visited
-        if (this->distance(node) != 0 && !node.visited) {
-            // if we haven't found a closest node yet, or the distance between my_node and the current node 
-            // is less than that for the current closest_node, then set closest_node = current node
-            if (closest_node == nullptr || this->distance(node) < this->distance(*closest_node)) {
-                //
-                closest_node = &parent_model->SNodes()[node_index];
-            }
+    // prefix sum gives the position of the first edge of each node
+    m_FirstEdge.assign(n_nodes + 1, 0);
+    for (int i = 0; i < n_nodes; ++i)
+        m_FirstEdge[i + 1] = m_FirstEdge[i] + degree[i];
+
+    const int n_edges = m_FirstEdge[n_nodes];
+    m_EdgeTo.resize(n_edges);
+    m_EdgeLength.resize(n_edges);
+    m_EdgeRoadType.resize(n_edges);
+    m_EdgeProfiles.resize(n_edges);
+
+    // second pass: fill in the edges, next[i] is the position of the next free edge slot of node i
+    std::vector<int> next(m_FirstEdge.begin(), m_FirstEdge.end() - 1);
+    auto add_edge = [&](int from, int to, float length, Model::Road::Type type) {
+        const int e = next[from]++;
+        m_EdgeTo[e] = to;
+        m_EdgeLength[e] = length;
+        m_EdgeRoadType[e] = type;
+        m_EdgeProfiles[e] = profiles(type);
+    };
+    for (const Model::Road &road : Roads()) {
+        if (!routable(road))
+            continue;
+        const auto &nodes = Ways()[road.way].nodes;
+        for (std::size_t i = 1; i < nodes.size(); ++i) {
+            const int a = nodes[i - 1], b = nodes[i];
+            if (a == b)
+                continue;
+            const float length = m_Nodes[a].distance(m_Nodes[b]);
+            add_edge(a, b, length, road.type);
+            add_edge(b, a, length, road.type);
         }
     }
-    return closest_node;
 }
 
-// finds neighbours of a node, let's say "my_node" and puts them in the neighbours attribute 
-void RouteModel::Node::FindNeighbors() {                         // my_node.FindNeighbours()
-    // iterate over all the roads that contain my_node. parent_model->node_to_road means use the 
-    // node_to_road dictionary that belongs to the RouteModel object, parent_model
-    for (auto &road : parent_model->node_to_road[this->index]) { // 'this' is my_node, my_node->index = my_node.index
-        // call FindNeighbor() on my_node with input = nodes in the same roads as my_node. to get these node IDs:
-        // for the current road get the way ID, and then find the node IDs that belong to the way
-        RouteModel::Node* new_neighbor = this->FindNeighbor(parent_model->Ways()[road->way].nodes);
-        if (new_neighbor) {
-            this->neighbors.emplace_back(new_neighbor);
+// Labels every node with the connected component of the profile's road graph it belongs to, so that queries
+// between different components can be rejected in O(1) instead of exhausting the reachable set.
+void RouteModel::LabelComponents(Profile profile) {
+    const int n_nodes = (int)m_Nodes.size();
+    auto &component = m_Component[profile];
+    component.assign(n_nodes, -1);
+    m_LargestComponent[profile] = -1;
+
+    // true if the node has at least one edge the profile may use
+    auto on_road = [&](int node) {
+        for (int e = m_FirstEdge[node]; e < m_FirstEdge[node + 1]; ++e)
+            if (EdgeAccessible(e, profile))
+                return true;
+        return false;
+    };
+
+    std::vector<int> stack;
+    int n_components = 0;
+    int largest_size = 0;
+    for (int root = 0; root < n_nodes; ++root) {
+        // skip nodes that are already labelled or are not on a routable road
+        if (component[root] >= 0 || !on_road(root))
+            continue;
+        const int label = n_components++;
+        int size = 0;
+        component[root] = label;
+        stack.push_back(root);
+        while (!stack.empty()) {
+            const int node = stack.back();
+            stack.pop_back();
+            ++size;
+            for (int e = m_FirstEdge[node]; e < m_FirstEdge[node + 1]; ++e)
+                if (EdgeAccessible(e, profile) && component[m_EdgeTo[e]] < 0) {
+                    component[m_EdgeTo[e]] = label;
+                    stack.push_back(m_EdgeTo[e]);
+                }
+        }
+        if (size > largest_size) {
+            largest_size = size;
+            m_LargestComponent[profile] = label;
         }
     }
 }
 
 // m_Model.FindClosestNode mwill be used to find the closest nodes to the starting and ending coordinates.
-RouteModel::Node& RouteModel::FindClosestNode(float x, float y) {
+int RouteModel::ClosestNodeIndex(float x, float y, Profile profile, bool largest_component_only) {
     Node input;
     input.x = x;
     input.y = y;
 
     float min_dist = std::numeric_limits<float>::max();
     float dist;
-    int closest_idx;
+    // stays -1 if no node matches
+    int closest_idx = -1;
 
-    // for each road that isn't a Footway
+    // for each road that the profile may use
     for (const Model::Road &road : Roads()) {
-        if (road.type != Model::Road::Type::Footway) {
+        if (m_Profiles[profile].Accessible(road.type)) {
             // for each node in the road
             for (int node_idx : Ways()[road.way].nodes) {
+                if (largest_component_only && m_Component[profile][node_idx] != m_LargestComponent[profile])
+                    continue;
                 // calculate the distance between the input coordinates and the current node
                 dist = input.distance(SNodes()[node_idx]);
                 // if its less than the current minimum distance
@@ -134,6 +223,13 @@ RouteModel::Node& RouteModel::FindClosestNode(float x, float y) {
             }
         }
     }
+    return closest_idx;
+}
+
+RouteModel::Node& RouteModel::FindClosestNode(float x, float y, Profile profile, bool largest_component_only) {
+    const int closest_idx = ClosestNodeIndex(x, y, profile, largest_component_only);
+    if (closest_idx < 0)
+        throw std::out_of_range("no node on a road of the profile matches the coordinates");
     //SNodes() was defined in the header file as:
     // auto& SNodes() { return m_Nodes; }
     // returns reference to the vector of nodes, m_Nodes
@@ -4,6 +4,7 @@
 #include <limits>
 #include <cmath>
 #include <unordered_map>
+#include <cstdint>
 #include "model.h"
 #include <iostream>
 
@@ -19,16 +20,10 @@ class RouteModel : public Model {
     // it is a nested class, which means it can access both public and private member of the RouteModel class
     class Node : public Model::Node {
       public:
-        Node* parent = nullptr;
-        float h_value = std::numeric_limits<float>::max(); // returns the maximum finite representable value for the float data type
-        float g_value = 0.0;
-        bool visited = false;
-        std::vector<Node*> neighbors; // declares a vector that will store pointers to neighbouring nodes (Node objects)
-
-        void FindNeighbors();
-
-        float distance(Node other) const {
-            return std::sqrt(std::pow((x - other.x), 2) + std::pow((y - other.y), 2));
+        // Takes the other node by reference: the search calls this for every edge and heuristic evaluation.
+        float distance(const Model::Node &other) const noexcept {
+            const double dx = x - other.x, dy = y - other.y;
+            return static_cast<float>(std::sqrt(dx * dx + dy * dy));
         }
       
         auto &Index() const noexcept { return index; }
@@ -39,29 +34,104 @@ class RouteModel : public Model {
         Node(){}
         
         // Node constructor = uses an initialiser list
-        Node(int idx, RouteModel* search_model, Model::Node node) : Model::Node(node), parent_model(search_model), index(idx) {}
+        Node(int idx, Model::Node node) : Model::Node(node), index(idx) {}
         // Model::Node(node) copies the Node "node" (copy constructor) to obtain its attributes (.x and .y)
         // Copy constructors are the member functions of a class that initialize the data members of the class using another object of the same class. It copies the values of the data variables of one object of a class to the data members of another object of the same class.
-        // parent_model(search_model) initializes the parent_model variable of the Node class with the value of the search_model parameter.
         // index(idx)                 initialises the index variable      
+        // The search state (g-values, parents, ...) is not stored in the nodes but in a SearchContext
+        // (see search_context.h), so that the model can be shared by many searches.
 
       private:
-        int index;
-        Node* FindNeighbor(std::vector<int> node_indices);
-        // pointer to a RouteModel object
-        RouteModel* parent_model = nullptr;
+        int index = -1;
+    };
+
+    // Routing profiles. All profiles share the one road graph; each profile has its own set of
+    // accessible road types and its own weight per road type (see ProfileTable).
+    enum Profile { Car, Pedestrian };
+    static constexpr int NumProfiles = 2;
+
+    // What a route minimises: its (weighted) length, or its travel time.
+    enum Metric { Distance, Time };
+    static constexpr int NumMetrics = 2;
+
+    // For the Distance metric the weight of an edge is its length multiplied by weight[road type]; weights
+    // are at least 1 so that the straight line distance stays an admissible A* heuristic. For the Time metric
+    // the weight of an edge is the time in seconds needed to travel it at speed[road type] (in km/h).
+    struct ProfileTable {
+        std::uint32_t road_types = 0; // bit (1 << type) is set if the profile may use roads of that type
+        float weight[Model::Road::Footway + 1] = {};
+        float speed[Model::Road::Footway + 1] = {};
+        bool Accessible(Model::Road::Type type) const noexcept { return road_types & (1u << type); }
+        // the highest speed on any accessible road type, in km/h
+        float MaxSpeed() const noexcept {
+            float max_speed = 0.f;
+            for (int type = 0; type <= Model::Road::Footway; ++type)
+                if (Accessible(Model::Road::Type(type)) && speed[type] > max_speed)
+                    max_speed = speed[type];
+            return max_speed;
+        }
     };
 
     // RouteModel constructor (defined in cpp file)
-    RouteModel(const std::vector<std::byte> &xml);
-    Node &FindClosestNode(float x, float y);
+    RouteModel(const std::vector<std::byte> &xml, bool hilbert_order = false);
+    // Returns the index of the closest node on a road the profile may use. If largest_component_only is true,
+    // only nodes in the largest connected part of the profile's road graph are considered. Returns -1 if no
+    // node qualifies: the profile may use no road, or x or y is not a number.
+    int ClosestNodeIndex(float x, float y, Profile profile = Car, bool largest_component_only = false);
+    // The same node itself; throws std::out_of_range if there is none.
+    Node &FindClosestNode(float x, float y, Profile profile = Car, bool largest_component_only = false);
     auto &SNodes() { return m_Nodes; }
-    std::vector<Node> path;
+    // indices of the nodes of the route to display, from start to end (see RoutePlanner::AStarSearch())
+    std::vector<int> path;
+    // alternative routes to display next to it, in the same form (see AlternativeRoutes)
+    std::vector<std::vector<int>> alternatives;
+
+    // The routable road graph, built once in the constructor, in compressed sparse row form:
+    // the edges leaving node i are stored at positions FirstEdge()[i] ... FirstEdge()[i+1] - 1 of
+    // EdgeTo() (the node the edge leads to), EdgeLength() and EdgeRoadType().
+    auto &FirstEdge() const noexcept { return m_FirstEdge; }
+    auto &EdgeTo() const noexcept { return m_EdgeTo; }
+    auto &EdgeLength() const noexcept { return m_EdgeLength; }
+    auto &EdgeRoadType() const noexcept { return m_EdgeRoadType; }
+    // bit (1 << profile) of EdgeProfiles()[e] is set if the profile may use edge e
+    auto &EdgeProfiles() const noexcept { return m_EdgeProfiles; }
+    bool EdgeAccessible(int e, Profile profile) const noexcept { return m_EdgeProfiles[e] & (1u << profile); }
+    // The edge weights of each profile and metric are precomputed, so a query only does an array lookup.
+    auto &EdgeWeights(Profile profile, Metric metric = Distance) const noexcept { return m_EdgeWeight[profile][metric]; }
+    float EdgeWeight(int e, Profile profile, Metric metric = Distance) const noexcept { return m_EdgeWeight[profile][metric][e]; }
+    auto &Profiles(Profile profile) const noexcept { return m_Profiles[profile]; }
+    // Changes the travel speed (in km/h, greater than 0) of a road type for a profile and recomputes the
+    // profile's travel time edge weights.
+    void SetSpeed(Profile profile, Model::Road::Type type, float speed);
+    // Counts the changes of the edge weights, so that results computed before a change can be recognised.
+    std::uint64_t Version() const noexcept { return m_Version; }
+
+    // Connected component label of each node in the profile's road graph, or -1 if the node is not on a road
+    // the profile may use. Roads are not directed, so the strongly connected components are the connected components.
+    int Component(int node_idx, Profile profile = Car) const noexcept { return m_Component[profile][node_idx]; }
+    int LargestComponent(Profile profile = Car) const noexcept { return m_LargestComponent[profile]; }
+    // true if there is a path between the two nodes in the profile's road graph
+    bool Connected(int a, int b, Profile profile = Car) const noexcept {
+        return m_Component[profile][a] >= 0 && m_Component[profile][a] == m_Component[profile][b];
+    }
     
   private:
-    void CreateNodeToRoadHashmap();
-    std::unordered_map<int, std::vector<const Model::Road*>> node_to_road;
+    void BuildProfiles();
+    void BuildRoadGraph();
+    void LabelComponents(Profile profile);
+    void BuildEdgeWeights(Profile profile);
     std::vector<Node> m_Nodes;
+    ProfileTable m_Profiles[NumProfiles];
+
+    std::vector<int> m_FirstEdge;
+    std::vector<int> m_EdgeTo;
+    std::vector<float> m_EdgeLength;
+    std::vector<Model::Road::Type> m_EdgeRoadType;
+    std::vector<std::uint8_t> m_EdgeProfiles;
+    std::vector<float> m_EdgeWeight[NumProfiles][NumMetrics];
+    std::vector<int> m_Component[NumProfiles];
+    int m_LargestComponent[NumProfiles] = {-1, -1};
+    std::uint64_t m_Version = 0;
 
 };
 
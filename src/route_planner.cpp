@@ -1,150 +1,285 @@
 #include "route_planner.h"
 #include <algorithm>
+#include <limits>
 
 // : m_Model(model): is the member initializer list. It initializes the member variable m_Model with the provided model. 
-RoutePlanner::RoutePlanner(RouteModel &model, float start_x, float start_y, float end_x, float end_y): m_Model(model) {
+RoutePlanner::RoutePlanner(RouteModel &model, RouteModel::Profile profile, RouteModel::Metric metric)
+    : m_Model(model), m_Profile(profile), m_Metric(metric) {
+    // For the Time metric the heuristic is the time needed to reach the end node in a straight line at the
+    // highest speed of the profile, which no route can beat, so it stays admissible.
+    if (m_Metric == RouteModel::Time)
+        m_HeuristicScale = static_cast<float>(m_Model.MetricScale()) / (m_Model.Profiles(m_Profile).MaxSpeed() / 3.6f);
+
+    // size the scratch buffers once for this model
+    m_Context.Resize((int)m_Model.SNodes().size(), (int)m_Model.EdgeTo().size());
+    m_Path.reserve(m_Model.SNodes().size());
+}
+
+RoutePlanner::RoutePlanner(RouteModel &model, float start_x, float start_y, float end_x, float end_y,
+                           RouteModel::Profile profile, RouteModel::Metric metric)
+    : RoutePlanner(model, profile, metric) {
+    SetEndpoints(start_x, start_y, end_x, end_y);
+
+    auto &nodes = m_Model.SNodes();
+    if (start_node >= 0)
+        cout << "start_node: index = " << start_node <<  "co-ordinates = (" << nodes[start_node].x << ", " << nodes[start_node].y << ")\n";
+    if (end_node >= 0)
+        cout << "end_node: index = " << end_node <<  "co-ordinates = (" << nodes[end_node].x << ", " << nodes[end_node].y << ")\n";
+}
+
+void RoutePlanner::SetEndpoints(float start_x, float start_y, float end_x, float end_y) {
     // Convert inputs to proportion:
     start_x *= 0.01;
     start_y *= 0.01;
     end_x *= 0.01;
     end_y *= 0.01;
 
-    // Find the closest nodes to the start and end coordinates.
-    start_node = &m_Model.FindClosestNode(start_x, start_y);
-    end_node = &m_Model.FindClosestNode(end_x, end_y);
+    // Find the closest nodes to the start and end coordinates on roads the profile may use. Only the
+    // largest connected part of the profile's road graph is considered, so that a query is not snapped
+    // to an isolated path segment from which nothing else can be reached.
+    // A node is -1 if there is none to snap to; the search then finds no route.
+    SetEndpoints(m_Model.ClosestNodeIndex(start_x, start_y, m_Profile, true),
+                 m_Model.ClosestNodeIndex(end_x, end_y, m_Profile, true));
+}
 
-    cout << "start_node: index = " << start_node->Index() <<  "co-ordinates = (" << start_node->x << ", " << start_node->y << ")\n";
-    cout << "end_node: index = " << end_node->Index() <<  "co-ordinates = (" << end_node->x << ", " << end_node->y << ")\n";
+void RoutePlanner::SetEndpoints(int start, int end) {
+    start_node = start;
+    end_node = end;
+    BeginSearch();
+}
 
-    // set g and h values and mark as visited
-    start_node->g_value = 0.0;
-    start_node->h_value = CalculateHValue(start_node);
-    start_node->visited = true;
+// Forgets the previous search and puts the start node on the open list with a g-value of 0.
+void RoutePlanner::BeginSearch() {
+    m_Context.Clear();
+    m_Path.clear();
+    if (m_Recorder)
+        m_Recorder->Begin();
+    distance = 0.0f;
+    duration = 0.0f;
+    m_Cancelled = false;
+    if (start_node < 0 || end_node < 0)
+        return;
+    m_Context.Reach(start_node, 0.0f, -1, -1);
+    m_Context.Push(start_node, m_HeuristicWeight * CalculateHValue(start_node));
 }
 
-float RoutePlanner::CalculateHValue(RouteModel::Node* const node) {
-    // distance to end Node
-    return node->distance(*end_node);
+float RoutePlanner::CalculateHValue(int node) const {
+    // distance to end Node, converted to the unit of the metric
+    auto &nodes = m_Model.SNodes();
+    return nodes[node].distance(nodes[end_node]) * m_HeuristicScale;
 }
 
 
-// For the current node add all its unvisited neighbors to the open list
-void RoutePlanner::AddNeighbors(RouteModel::Node* current_node) {
-    //cout << "current_node index: " << current_node->Index() << '\n';
-    // populate current_node.neighbors vector with all its neighbors:
-    current_node->FindNeighbors();
-    // go through all the neighbours:
-    for (RouteModel::Node* node : current_node->neighbors){
-        if (node->visited == false){
-            //cout << "Neighbour node index: " << node->Index() << " ";
-            // set the parent:
-            node->parent = current_node;
-            // set the h-value:
-            node->h_value = CalculateHValue(node);
-            // set the g-value
-            node->g_value = current_node->g_value + current_node->distance(*node); // dereference node as its a pointer
-            // set visited to true
-            node->visited = true;
-            // at it to the open_list
-            open_list.emplace_back(node); // open_list is a vector or pointers to RouteModel::Node objects
-            // cout << "Neighbour: node index: " << node->Index() << "parent node: " << node->parent->Index() << '\n';
-        }
+// For the current node add all its unvisited neighbors to the open list, and lower the g-value
+// of neighbors already in the open list if the path through the current node is shorter.
+// The neighbors are the ends of the road graph edges leaving the current node that the profile may use.
+void RoutePlanner::AddNeighbors(int current_node) {
+    auto &first_edge = m_Model.FirstEdge();
+    auto &edge_to = m_Model.EdgeTo();
+    auto &edge_weight = m_Model.EdgeWeights(m_Profile, m_Metric);
+    const float current_g = m_Context.G(current_node);
+
+    for (int e = first_edge[current_node]; e < first_edge[current_node + 1]; ++e) {
+        if (!m_Model.EdgeAccessible(e, m_Profile))
+            continue;
+        const int node = edge_to[e];
+        const float g_value = current_g + edge_weight[e];
+        // Only a cheaper path to the node is recorded. With weight 1 the heuristic is consistent, so
+        // expanded nodes are never improved. With a higher weight they can be: the cheaper path is kept,
+        // but NextNode() does not expand the node again, which still keeps the route within the weight
+        // times the cost of the best one (ImprovePath() remembers such nodes for its next pass instead).
+        if (m_Context.Reached(node) && g_value >= m_Context.G(node))
+            continue;
+        // set the parent and the g-value, and add it to the open list with f = g + weight * h
+        m_Context.Reach(node, g_value, current_node, e);
+        m_Context.Push(node, g_value + m_HeuristicWeight * CalculateHValue(node));
+        if (m_Recorder)
+            m_Recorder->Relax(node);
     }
-    //cout << "open_list: \n";
-    //for (RouteModel::Node* noode : open_list) {
-    //    cout << noode->Index() << " ";
-    //}
-    //cout << '\n';
 }
 
-// Get a pointer to the next_node
-RouteModel::Node* RoutePlanner::NextNode() {
-    auto compare = [&](const RouteModel::Node* node1, const RouteModel::Node* node2){
-        return ((node1->g_value + node1->h_value) > (node2->g_value + node2->h_value));
-    };
-    // Sort the open_list according to f = h + g, in descending order
-    std::sort(this->open_list.begin(), this->open_list.end(), compare);
-
-    //cout << "open_list: ";
-    //for (const RouteModel::Node* noode : this->open_list){
-    //    cout << noode->Index() << ", f = " << (noode->g_value + noode->h_value) << ", g = " << noode->g_value << ", h = " << noode->h_value << '\n';
-    //}
-    //cout << '\n';
-    // Create a pointer to the node in the list with the lowest sum
-    RouteModel::Node* next_node = (this->open_list).back(); 
-    // Remove that node from the open_list
-    (this->open_list).pop_back();
-    //cout << "next_node: " << next_node->Index() << '\n';
+// Returns the open node with the lowest f = g + h and closes it, or -1 if the open list is empty.
+int RoutePlanner::NextNode() {
+    const int next_node = m_Context.Pop();
+    if (next_node >= 0) {
+        m_Context.Close(next_node);
+        if (m_Recorder)
+            m_Recorder->Settle(next_node);
+    }
     return next_node;
 }
 
 
 // Returns the final path found from the A* search.
-// Input: the current (final) node a
-//iteratively follow the 
-//   chain of parents of nodes until the starting node is found.
-// - For each node in the chain, add the distance from the node to its parent to the distance variable.
-// - The returned vector should be in the correct order: the start node should be the first element
-//   of the vector, the end node should be the last element.
-
-std::vector<RouteModel::Node> RoutePlanner::ConstructFinalPath(RouteModel::Node* current_node) {
-    // Create path_found vector
+// Input: the current (final) node.
+// Follows the chain of parents of nodes until the starting node is found, adding up the distance
+// and travel time of each step. The returned vector is in the correct order: the start node is the 
+// first element of the vector, the end node is the last element.
+const std::vector<int> &RoutePlanner::ConstructFinalPath(int current_node) {
     distance = 0.0f;
-    std::vector<RouteModel::Node> path_found;
+    duration = 0.0f;
+    m_Path.clear();
 
-    while (current_node->Index() != start_node->Index() ){
-        path_found.emplace(path_found.begin(), *current_node);
+    auto &nodes = m_Model.SNodes();
+    // collect the nodes from the end to the start, then reverse them once
+    while (current_node != start_node) {
+        m_Path.push_back(current_node);
+        const int parent = m_Context.Parent(current_node);
         // add distance from current_node to its parent
-        distance += current_node->distance(*(current_node->parent));
+        distance += nodes[current_node].distance(nodes[parent]);
+        // add the travel time of the road graph edge from the parent to current_node
+        if (const int e = m_Context.ParentEdge(current_node); e >= 0)
+            duration += m_Model.EdgeWeight(e, m_Profile, RouteModel::Time);
         // set the current_node equal to the parent
-        current_node = current_node->parent;
+        current_node = parent;
     }
     // add start node
-    path_found.emplace(path_found.begin(), *start_node);
+    m_Path.push_back(start_node);
+    std::reverse(m_Path.begin(), m_Path.end());
 
     distance *= m_Model.MetricScale(); // Multiply the distance by the scale of the map to get meters.
-    cout << "distance: " << distance << '\n';
-    return path_found;
+    return m_Path;
 }
 
 
-// TODO 7: Write the A* Search algorithm here.
-// Tips:
-// - Use the AddNeighbors method to add all of the neighbors of the current node to the open_list.
-// - Use the NextNode() method to sort the open_list and return the next node.
-// - When the search has reached the end_node, use the ConstructFinalPath method to return the final path that was found.
-// - Store the final path in the m_Model.path attribute before the method exits. This path will then be displayed on the map tile.
-
-void RoutePlanner::AStarSearch() {
-    RouteModel::Node* current_node = nullptr;
-
-    current_node = start_node;
+bool RoutePlanner::Search() {
+    BeginSearch();
 
-    cout << "current node: " << current_node->Index() << ", ";
+    // no start or end, or start and end in different components of the road graph: fail without searching
+    if (start_node < 0 || end_node < 0 || !m_Model.Connected(start_node, end_node, m_Profile))
+        return false;
 
-    // do until current_node = end_node
-    while (current_node->Index() != end_node->Index()){
-        // add all of the neighbors of the current node to the open_list
+    // expand the node with the lowest f-value until the end node is reached
+    for (int current_node = NextNode(), settled = 1; current_node >= 0; current_node = NextNode(), ++settled) {
+        if (current_node == end_node) {
+            ConstructFinalPath(current_node);
+            if (m_Monitor)
+                m_Monitor->Report(settled, 1.0f);
+            return true;
+        }
+        if (m_Monitor && !CheckMonitor(current_node, settled))
+            return false;
         AddNeighbors(current_node);
+    }
+    // there are no more nodes to explore, so there is no route
+    return false;
+}
 
-        // if there are nodes in the open_list    
-        if (open_list.size() > 0 ){    
-            // do we need to update the g-values?
+bool RoutePlanner::CheckMonitor(int current_node, int settled) {
+    if (settled % m_Monitor->CheckInterval() != 0)
+        return true;
+    const float start_h = CalculateHValue(start_node);
+    const float progress = start_h > 0.0f ? 1.0f - CalculateHValue(current_node) / start_h : 1.0f;
+    // a cancel that arrives after the search has ended on its own is not counted
+    m_Cancelled = !m_Monitor->Report(settled, progress);
+    return !m_Cancelled;
+}
 
-            // sort the open_list and return the next node
-            current_node = NextNode();
-            cout << current_node->Index() << ", ";
+bool RoutePlanner::ImprovePath(float weight, std::chrono::steady_clock::time_point deadline) {
+    auto &first_edge = m_Model.FirstEdge();
+    auto &edge_to = m_Model.EdgeTo();
+    auto &edge_weight = m_Model.EdgeWeights(m_Profile, m_Metric);
+    // the clock is read before the first expansion, so that a pass never starts after the deadline,
+    // and then every few hundred expansions
+    for (int expanded = 0; m_Context.G(end_node) > m_Context.MinKey(); ++expanded) {
+        if (expanded % 256 == 0 && std::chrono::steady_clock::now() >= deadline)
+            return false;
+        const int current_node = NextNode();
+        if (current_node < 0)
+            break;
+        if (m_Monitor && !CheckMonitor(current_node, expanded + 1))
+            return false;
+        const float current_g = m_Context.G(current_node);
+        for (int e = first_edge[current_node]; e < first_edge[current_node + 1]; ++e) {
+            if (!m_Model.EdgeAccessible(e, m_Profile))
+                continue;
+            const int node = edge_to[e];
+            const float g_value = current_g + edge_weight[e];
+            if (g_value >= m_Context.G(node))
+                continue;
+            m_Context.Reach(node, g_value, current_node, e);
+            // with a weighted heuristic a closed node can be improved; it is expanded again in the next pass
+            if (m_Context.Closed(node))
+                m_Inconsistent.push_back(node);
+            else
+                m_Context.Push(node, g_value + weight * CalculateHValue(node));
+            if (m_Recorder)
+                m_Recorder->Relax(node);
         }
-        else {
-            // we aren't at the end node and there are no more nodes to explore
-            cout << "No path found!";
+    }
+    return true;
+}
+
+bool RoutePlanner::AnytimeSearch(const AnytimeOptions &options) {
+    const auto begin = std::chrono::steady_clock::now();
+    const float scale = m_Metric == RouteModel::Distance ? static_cast<float>(m_Model.MetricScale()) : 1.0f;
+    m_AnytimeRoutes.clear();
+    m_Inconsistent.clear();
+    BeginSearch();
+    if (start_node < 0 || end_node < 0 || !m_Model.Connected(start_node, end_node, m_Profile))
+        return false;
+
+    float weight = std::max(options.initial_weight, 1.0f);
+    m_Context.Rekey([&](int node) { return m_Context.G(node) + weight * CalculateHValue(node); });
+    while (ImprovePath(weight, options.deadline)) {
+        if (!m_Context.Reached(end_node))
             break;
+        // record the route if it is cheaper than the last one
+        const float cost = m_Context.G(end_node);
+        if (m_AnytimeRoutes.empty() || cost * scale < m_AnytimeRoutes.back().cost) {
+            ConstructFinalPath(end_node);
+            AnytimeRoute route;
+            route.path = m_Path;
+            route.cost = cost * scale;
+            route.distance = distance;
+            route.duration = duration;
+            route.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            m_AnytimeRoutes.push_back(std::move(route));
         }
+        // Every route yet to be found passes an open or improved node, and g + h of such a node is a
+        // lower bound of its cost, so the smallest g + h bounds the cost of the best route from below.
+        const float next_weight = std::max(1.0f, weight - options.weight_step);
+        float lower = std::numeric_limits<float>::max();
+        m_Context.Rekey([&](int node) {
+            lower = std::min(lower, m_Context.G(node) + CalculateHValue(node));
+            return m_Context.G(node) + next_weight * CalculateHValue(node);
+        });
+        for (int node : m_Inconsistent)
+            lower = std::min(lower, m_Context.G(node) + CalculateHValue(node));
+        // a pass that found no cheaper route still tightens the bound of the last one
+        const float bound = std::max(1.0f, lower > 0.0f ? std::min(weight, cost / lower) : 1.0f);
+        auto &last = m_AnytimeRoutes.back();
+        last.bound = last.bound > 0.0f ? std::min(last.bound, bound) : bound;
+        if (weight <= 1.0f || lower >= cost)
+            break;
+        // the next pass expands the open and the improved nodes again with the lower weight
+        weight = next_weight;
+        m_Context.ClearClosed();
+        for (int node : m_Inconsistent)
+            m_Context.Push(node, m_Context.G(node) + weight * CalculateHValue(node));
+        m_Inconsistent.clear();
     }
-    m_Model.path = ConstructFinalPath(current_node);
+    if (m_AnytimeRoutes.empty())
+        return false;
+    // the planner reports the best route found
+    auto &best = m_AnytimeRoutes.back();
+    m_Path = best.path;
+    distance = best.distance;
+    duration = best.duration;
+    return true;
+}
+
+void RoutePlanner::AStarSearch() {
+    if (!Search()) {
+        cout << "No path found!\n";
+        m_Model.path.clear();
+        return;
+    }
+    m_Model.path = m_Path;
+    cout << "distance: " << distance << '\n';
     cout << "Path found: ";    
-    for (RouteModel::Node node : m_Model.path){
-        cout << node.Index() << " ";
+    for (int node : m_Model.path){
+        cout << node << " ";
     }
     cout << '\n';
 }
@@ -1,33 +1,120 @@
 #ifndef ROUTE_PLANNER_H
 #define ROUTE_PLANNER_H
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <vector>
 #include <string>
 #include "route_model.h"
+#include "search_context.h"
+#include "search_monitor.h"
+#include "search_recorder.h"
 
 
+// A* search over the road graph of a RouteModel. A RoutePlanner can be reused for many queries:
+// its scratch buffers are kept between queries, so once warmed up a query does not allocate.
+// The model is only read, so several planners (e.g. one per thread) may share it.
 class RoutePlanner {
   public:
-    RoutePlanner(RouteModel &model, float start_x, float start_y, float end_x, float end_y);
+    // Plans from and to the nodes closest to the given coordinates (in percent of the map).
+    RoutePlanner(RouteModel &model, float start_x, float start_y, float end_x, float end_y,
+                 RouteModel::Profile profile = RouteModel::Car, RouteModel::Metric metric = RouteModel::Distance);
+    // A planner without a query yet; call SetEndpoints() before Search().
+    RoutePlanner(RouteModel &model, RouteModel::Profile profile = RouteModel::Car, RouteModel::Metric metric = RouteModel::Distance);
+
+    // Set the start and end of the next query, from coordinates in percent of the map or from node indices.
+    void SetEndpoints(float start_x, float start_y, float end_x, float end_y);
+    void SetEndpoints(int start, int end);
+
     // Add public variables or methods declarations here.
     float GetDistance() const {return distance;}
+    // travel time of the route found in seconds, at the speeds of the profile
+    float GetDuration() const {return duration;}
+    // indices of the nodes of the route found, from start to end; empty if there is no route
+    const std::vector<int> &GetPath() const {return m_Path;}
+    int StartNode() const {return start_node;}
+    int EndNode() const {return end_node;}
+
+    // Runs A* between the current endpoints; returns false if there is no route. Does not allocate once warmed up.
+    bool Search();
+
+    // Weighted A*: Search() orders the open list by f = g + weight * h. A weight above 1 expands far fewer
+    // nodes, and the route found costs at most weight times as much as the best route. 1 by default.
+    void SetHeuristicWeight(float weight) {m_HeuristicWeight = std::max(weight, 1.0f);}
+    float HeuristicWeight() const {return m_HeuristicWeight;}
+
+    // Anytime A* (ARA*): weighted searches with a falling weight, each reusing the work of the one before,
+    // so that a route is found quickly and then improved until it is the best route or the deadline passes.
+    struct AnytimeOptions {
+        float initial_weight = 3.0f;
+        float weight_step = 0.5f;  // the weight falls by this much after each route found, down to 1
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    };
+    // one route of the improving sequence
+    struct AnytimeRoute {
+        std::vector<int> path;
+        float cost = 0.0f;      // in the unit of the metric: meters (weighted by road type) or seconds
+        float bound = 0.0f;     // the route costs at most this many times as much as the best route
+        float distance = 0.0f;  // in meters
+        float duration = 0.0f;  // in seconds
+        double elapsed_ms = 0.0;  // since the start of the search
+    };
+    // Returns false if no route was found by the deadline or before a monitor cancelled it (or there is none). Otherwise GetPath(),
+    // GetDistance() and GetDuration() describe the best route found, and AnytimeRoutes() all routes found,
+    // each cheaper than the one before.
+    bool AnytimeSearch(const AnytimeOptions &options);
+    bool AnytimeSearch() {return AnytimeSearch(AnytimeOptions{});}
+    const std::vector<AnytimeRoute> &AnytimeRoutes() const {return m_AnytimeRoutes;}
+    // Search(), then stores the route in the model for display and prints a summary.
     void AStarSearch();
 
     // The following methods have been made public so we can test them individually.
-    void AddNeighbors(RouteModel::Node* current_node);
-    float CalculateHValue(RouteModel::Node* const node);
-    std::vector<RouteModel::Node> ConstructFinalPath(RouteModel::Node* );
-    RouteModel::Node* NextNode();
+    void AddNeighbors(int current_node);
+    float CalculateHValue(int node) const;
+    const std::vector<int> &ConstructFinalPath(int current_node);
+    int NextNode();
+    SearchContext &Context() {return m_Context;}
+
+    // Records the nodes settled and relaxed by the following searches into the recorder, or stops
+    // recording if it is nullptr. The recorder must outlive its use by the planner.
+    void SetRecorder(SearchRecorder *recorder) {m_Recorder = recorder;}
+
+    // Reports the progress of the following searches to the monitor and stops them when it is cancelled
+    // (see SearchMonitor), or stops doing so if it is nullptr. The monitor must outlive its use.
+    void SetMonitor(SearchMonitor *monitor) {m_Monitor = monitor;}
+    // Whether the last search was stopped by its monitor being cancelled, rather than ending on its own.
+    bool Cancelled() const {return m_Cancelled;}
 
   private:
     // Add private variables or methods declarations here.
-    std::vector<RouteModel::Node*> open_list;
-    RouteModel::Node* start_node;
-    RouteModel::Node* end_node;
+    void BeginSearch();
+    // Reports to the monitor every CheckInterval() settled nodes; returns false if the search should stop.
+    bool CheckMonitor(int current_node, int settled);
+    // One ARA* pass: expands nodes in order of g + weight * h until no open node can lead to a cheaper
+    // route to the end node. Closed nodes that are improved go to m_Inconsistent. Returns false if the
+    // deadline passed first.
+    bool ImprovePath(float weight, std::chrono::steady_clock::time_point deadline);
 
-    float distance = 0.0f;
     RouteModel& m_Model;
+    RouteModel::Profile m_Profile;
+    RouteModel::Metric m_Metric;
+    // CalculateHValue() multiplies the straight line distance to the end node by this factor
+    float m_HeuristicScale = 1.0f;
+    float m_HeuristicWeight = 1.0f;
+
+    int start_node = -1;
+    int end_node = -1;
+    float distance = 0.0f;
+    float duration = 0.0f;
+
+    SearchContext m_Context;
+    std::vector<int> m_Path;
+    SearchRecorder *m_Recorder = nullptr;
+    SearchMonitor *m_Monitor = nullptr;
+    bool m_Cancelled = false;
+    std::vector<int> m_Inconsistent;
+    std::vector<AnytimeRoute> m_AnytimeRoutes;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,279 @@
+#include "route_protocol.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+// A position in the request line that is being parsed. The parser only knows the JSON that requests use:
+// one object of strings, numbers, booleans and arrays of two numbers; other values are skipped.
+struct JsonCursor {
+    const std::string &text;
+    std::size_t pos = 0;
+
+    void SkipSpace() {
+        while( pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n') )
+            ++pos;
+    }
+    // skips white space and consumes c if it comes next
+    bool Consume(char c) {
+        SkipSpace();
+        if( pos < text.size() && text[pos] == c ) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+    bool ConsumeWord(const char *word) {
+        SkipSpace();
+        const std::string_view w{word};
+        if( text.compare(pos, w.size(), w) != 0 )
+            return false;
+        pos += w.size();
+        return true;
+    }
+    char Peek() {
+        SkipSpace();
+        return pos < text.size() ? text[pos] : '\0';
+    }
+};
+
+static bool ParseString(JsonCursor &c, std::string &out)
+{
+    if( !c.Consume('"') )
+        return false;
+    out.clear();
+    while( c.pos < c.text.size() ) {
+        char ch = c.text[c.pos++];
+        if( ch == '"' )
+            return true;
+        if( ch != '\\' ) {
+            out.push_back(ch);
+            continue;
+        }
+        if( c.pos >= c.text.size() )
+            return false;
+        switch( ch = c.text[c.pos++] ) {
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u':
+                // only ids and names are strings, so characters outside ASCII are just replaced
+                if( c.pos + 4 > c.text.size() )
+                    return false;
+                out.push_back('?');
+                c.pos += 4;
+                break;
+            default: out.push_back(ch); break;
+        }
+    }
+    return false;
+}
+
+// The length of the JSON number at pos, or 0 if there is none:
+// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+static std::size_t JsonNumberLength(const std::string &text, std::size_t pos)
+{
+    const std::size_t begin = pos;
+    auto digit = [&](std::size_t i) { return i < text.size() && text[i] >= '0' && text[i] <= '9'; };
+    auto digits = [&] {
+        const std::size_t first = pos;
+        while( digit(pos) )
+            ++pos;
+        return pos > first;
+    };
+    if( pos < text.size() && text[pos] == '-' )
+        ++pos;
+    if( pos < text.size() && text[pos] == '0' )
+        ++pos;
+    else if( !digits() )
+        return 0;
+    if( pos < text.size() && text[pos] == '.' ) {
+        ++pos;
+        if( !digits() )
+            return 0;
+    }
+    if( pos < text.size() && (text[pos] == 'e' || text[pos] == 'E') ) {
+        ++pos;
+        if( pos < text.size() && (text[pos] == '+' || text[pos] == '-') )
+            ++pos;
+        if( !digits() )
+            return 0;
+    }
+    return pos - begin;
+}
+
+static bool ParseNumber(JsonCursor &c, double &out, std::string *text = nullptr)
+{
+    // strtod() also reads "nan", "inf" and hexadecimal numbers, which are not JSON numbers; since an id
+    // is echoed back as it was written, only what the JSON grammar allows is passed to it
+    c.SkipSpace();
+    const std::size_t length = JsonNumberLength(c.text, c.pos);
+    if( length == 0 )
+        return false;
+    const std::string number = c.text.substr(c.pos, length);
+    out = std::strtod(number.c_str(), nullptr);
+    if( text )
+        *text = number;
+    c.pos += length;
+    return true;
+}
+
+// Skips any JSON value, including nested arrays and objects.
+static bool SkipValue(JsonCursor &c)
+{
+    std::string s;
+    double d;
+    switch( c.Peek() ) {
+        case '"': return ParseString(c, s);
+        case 't': return c.ConsumeWord("true");
+        case 'f': return c.ConsumeWord("false");
+        case 'n': return c.ConsumeWord("null");
+        case '[':
+            c.Consume('[');
+            if( c.Consume(']') )
+                return true;
+            do {
+                if( !SkipValue(c) )
+                    return false;
+            } while( c.Consume(',') );
+            return c.Consume(']');
+        case '{':
+            c.Consume('{');
+            if( c.Consume('}') )
+                return true;
+            do {
+                if( !ParseString(c, s) || !c.Consume(':') || !SkipValue(c) )
+                    return false;
+            } while( c.Consume(',') );
+            return c.Consume('}');
+        default: return ParseNumber(c, d);
+    }
+}
+
+static bool ParsePoint(JsonCursor &c, float &x, float &y)
+{
+    double dx, dy;
+    if( !c.Consume('[') || !ParseNumber(c, dx) || !c.Consume(',') || !ParseNumber(c, dy) || !c.Consume(']') )
+        return false;
+    x = static_cast<float>(dx);
+    y = static_cast<float>(dy);
+    return true;
+}
+
+// The string as a JSON string literal.
+static std::string Quote(const std::string &s)
+{
+    std::string quoted = "\"";
+    for( char ch: s ) {
+        if( ch == '"' || ch == '\\' ) {
+            quoted.push_back('\\');
+            quoted.push_back(ch);
+        }
+        else if( static_cast<unsigned char>(ch) < 0x20 ) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof escaped, "\\u%04x", ch);
+            quoted += escaped;
+        }
+        else
+            quoted.push_back(ch);
+    }
+    return quoted + "\"";
+}
+
+std::string ParseRouteRequest(const std::string &line, RouteRequest &request)
+{
+    request = RouteRequest{};
+    JsonCursor c{line};
+    if( !c.Consume('{') )
+        return "request is not a JSON object";
+    bool has_start = false, has_end = false;
+    if( !c.Consume('}') ) {
+        do {
+            std::string key, value;
+            if( !ParseString(c, key) || !c.Consume(':') )
+                return "malformed JSON";
+            if( key == "id" ) {
+                if( c.Peek() == '"' ) {
+                    if( !ParseString(c, value) )
+                        return "malformed id";
+                    request.id = Quote(value);
+                }
+                else {
+                    double number;
+                    if( !ParseNumber(c, number, &request.id) )
+                        return "id must be a number or a string";
+                }
+            }
+            else if( key == "start" || key == "end" ) {
+                auto &x = key == "start" ? request.start_x : request.end_x;
+                auto &y = key == "start" ? request.start_y : request.end_y;
+                if( !ParsePoint(c, x, y) )
+                    return key + " must be an array of two numbers";
+                // the planner can not snap points that are not on the map (or not numbers at all)
+                if( !std::isfinite(x) || !std::isfinite(y) || x < 0.f || x > 100.f || y < 0.f || y > 100.f )
+                    return key + " must be in percent of the map, from 0 to 100";
+                (key == "start" ? has_start : has_end) = true;
+            }
+            else if( key == "profile" ) {
+                if( !ParseString(c, value) || (value != "car" && value != "pedestrian") )
+                    return "profile must be \"car\" or \"pedestrian\"";
+                request.profile = value == "car" ? RouteModel::Car : RouteModel::Pedestrian;
+            }
+            else if( key == "metric" ) {
+                if( !ParseString(c, value) || (value != "distance" && value != "time") )
+                    return "metric must be \"distance\" or \"time\"";
+                request.metric = value == "distance" ? RouteModel::Distance : RouteModel::Time;
+            }
+            else if( key == "path" ) {
+                if( c.ConsumeWord("true") )
+                    request.with_path = true;
+                else if( c.ConsumeWord("false") )
+                    request.with_path = false;
+                else
+                    return "path must be true or false";
+            }
+            else if( !SkipValue(c) )
+                return "malformed JSON";
+        } while( c.Consume(',') );
+        if( !c.Consume('}') )
+            return "malformed JSON";
+    }
+    c.SkipSpace();
+    if( c.pos != line.size() )
+        return "unexpected text after the request";
+    if( !has_start || !has_end )
+        return "start and end are required";
+    return "";
+}
+
+std::string FormatRouteResponse(const RouteRequest &request, const RoutePlanner &planner, bool found)
+{
+    return FormatRouteResponse(request, found, planner.GetDistance(), planner.GetDuration(), planner.GetPath());
+}
+
+std::string FormatRouteResponse(const RouteRequest &request, bool found, float distance, float duration, const std::vector<int> &path)
+{
+    std::string response = "{\"id\": " + request.id + ", \"found\": " + (found ? "true" : "false");
+    if( found ) {
+        char numbers[96];
+        std::snprintf(numbers, sizeof numbers, ", \"distance\": %.2f, \"duration\": %.2f", distance, duration);
+        response += numbers;
+        if( request.with_path ) {
+            response += ", \"path\": [";
+            for( std::size_t i = 0; i < path.size(); ++i ) {
+                if( i > 0 )
+                    response += ", ";
+                response += std::to_string(path[i]);
+            }
+            response += "]";
+        }
+    }
+    return response + "}";
+}
+
+std::string FormatErrorResponse(const std::string &id, const std::string &message)
+{
+    return "{\"id\": " + id + ", \"error\": " + Quote(message) + "}";
+}
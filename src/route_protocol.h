@@ -0,0 +1,37 @@
+#ifndef ROUTE_PROTOCOL_H
+#define ROUTE_PROTOCOL_H
+
+#include <string>
+#include <vector>
+#include "route_model.h"
+#include "route_planner.h"
+
+// One query of the line-delimited JSON protocol of RouteServer, for example
+//   {"id": 7, "start": [10, 10], "end": [90, 90], "profile": "pedestrian", "metric": "time", "path": false}
+// Coordinates are in percent of the map (0 to 100), like on the command line. id (a number or a string) is echoed
+// in the response; profile ("car"), metric ("distance") and path (true) are optional.
+struct RouteRequest {
+    std::string id = "null";  // the id as JSON text
+    float start_x = 0.f;
+    float start_y = 0.f;
+    float end_x = 0.f;
+    float end_y = 0.f;
+    RouteModel::Profile profile = RouteModel::Car;
+    RouteModel::Metric metric = RouteModel::Distance;
+    bool with_path = true;
+};
+
+// Parses a request line. Returns an error message, or an empty string on success.
+std::string ParseRouteRequest(const std::string &line, RouteRequest &request);
+
+// The response line (without the newline) to a request, from the planner that ran it:
+//   {"id": 7, "found": true, "distance": 839.26, "duration": 60.41, "path": [79, 80, ...]}
+// distance is in meters and duration in seconds; path is left out if the request did not ask for it.
+std::string FormatRouteResponse(const RouteRequest &request, const RoutePlanner &planner, bool found);
+// The same from a route found earlier (e.g. in a RouteCache).
+std::string FormatRouteResponse(const RouteRequest &request, bool found, float distance, float duration, const std::vector<int> &path);
+
+// The response line to a request that could not be run: {"id": 7, "error": "..."}
+std::string FormatErrorResponse(const std::string &id, const std::string &message);
+
+#endif
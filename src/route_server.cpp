@@ -0,0 +1,313 @@
+#include "route_server.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <utility>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// requests longer than this close the connection
+static constexpr std::size_t MaxLineLength = 64 * 1024;
+
+// Sends all of data; returns false if the connection is broken.
+static bool SendAll(int fd, const std::string &data)
+{
+    std::size_t sent = 0;
+    while( sent < data.size() ) {
+        const ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if( n < 0 && errno == EINTR )
+            continue;
+        if( n <= 0 )
+            return false;
+        sent += n;
+    }
+    return true;
+}
+
+// A client connection. Requests are numbered in the order they are read; a response is held back until
+// the responses to all earlier requests of the connection have been written.
+struct RouteServer::Connection {
+    explicit Connection(int socket): fd(socket) {}
+    ~Connection() { close(fd); }
+
+    // Stores the response to request `sequence` and writes all responses that are now next in line.
+    void Complete(std::uint64_t sequence, std::string response) {
+        std::lock_guard<std::mutex> lock{mutex};
+        ready.emplace(sequence, std::move(response));
+        // responses that are ready together go out in one send
+        std::string out;
+        for( auto it = ready.begin(); it != ready.end() && it->first == next_write; it = ready.erase(it), ++next_write ) {
+            out += it->second;
+            out += '\n';
+        }
+        if( !out.empty() && !broken && !SendAll(fd, out) ) {
+            broken = true;
+            monitor.Cancel();
+        }
+        written.notify_all();
+    }
+
+    // The client has gone: nothing more is sent, and the searches for it stop (see SearchMonitor).
+    void Abandon() {
+        std::lock_guard<std::mutex> lock{mutex};
+        broken = true;
+        monitor.Cancel();
+    }
+
+    // Waits until the responses to the first `count` requests have been written.
+    void WaitWritten(std::uint64_t count) {
+        std::unique_lock<std::mutex> lock{mutex};
+        written.wait(lock, [&] { return next_write >= count; });
+    }
+
+    const int fd;
+    std::atomic<bool> done{false};  // set when the reader has finished with the connection
+    std::mutex mutex;
+    std::condition_variable written;
+    std::map<std::uint64_t, std::string> ready;
+    std::uint64_t next_write = 0;
+    bool broken = false;
+    // cancelled once the connection is broken, so that its queued and running requests are dropped
+    SearchMonitor monitor;
+};
+
+RouteServer::RouteServer(RouteModel &model, Options options):
+    m_Model(model),
+    m_Options(std::move(options))
+{
+    if( m_Options.cache_bytes > 0 )
+        m_Cache = std::make_unique<RouteCache>(m_Model, m_Options.cache_bytes);
+    if( pipe(m_StopPipe) != 0 )
+        m_StopPipe[0] = m_StopPipe[1] = -1;
+}
+
+RouteServer::~RouteServer()
+{
+    for( int fd: {m_StopPipe[0], m_StopPipe[1], m_ListenFd} )
+        if( fd >= 0 )
+            close(fd);
+}
+
+void RouteServer::Stop() noexcept
+{
+    // write() is async-signal-safe, unlike anything that takes a lock
+    const char byte = 0;
+    if( m_StopPipe[1] >= 0 )
+        (void)!write(m_StopPipe[1], &byte, 1);
+}
+
+bool RouteServer::Listen()
+{
+    const bool unix_socket = !m_Options.unix_path.empty();
+    m_ListenFd = socket(unix_socket ? AF_UNIX : AF_INET, SOCK_STREAM, 0);
+    int result = -1;
+    if( m_ListenFd >= 0 && unix_socket ) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if( m_Options.unix_path.size() < sizeof address.sun_path ) {
+            std::strcpy(address.sun_path, m_Options.unix_path.c_str());
+            // a socket file left behind by an earlier server would make bind() fail
+            unlink(address.sun_path);
+            result = bind(m_ListenFd, reinterpret_cast<sockaddr*>(&address), sizeof address);
+        }
+        else
+            errno = ENAMETOOLONG;
+    }
+    else if( m_ListenFd >= 0 ) {
+        const int on = 1;
+        setsockopt(m_ListenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<std::uint16_t>(m_Options.tcp_port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        result = bind(m_ListenFd, reinterpret_cast<sockaddr*>(&address), sizeof address);
+    }
+    if( result == 0 )
+        result = listen(m_ListenFd, 128);
+    if( result != 0 || m_StopPipe[0] < 0 ) {
+        std::cout << "Failed to listen on " << (unix_socket ? m_Options.unix_path : "port " + std::to_string(m_Options.tcp_port))
+                  << ": " << std::strerror(errno) << std::endl;
+        if( m_ListenFd >= 0 )
+            close(m_ListenFd);
+        m_ListenFd = -1;
+        return false;
+    }
+    return true;
+}
+
+bool RouteServer::Run()
+{
+    if( !Listen() )
+        return false;
+    const int n_workers = m_Options.n_workers > 0 ? m_Options.n_workers : std::max(1u, std::thread::hardware_concurrency());
+    m_Closed = false;
+    for( int i = 0; i < n_workers; ++i )
+        m_Workers.emplace_back(&RouteServer::Work, this);
+
+    pollfd fds[2] = {{m_ListenFd, POLLIN, 0}, {m_StopPipe[0], POLLIN, 0}};
+    while( true ) {
+        if( poll(fds, 2, 1000) < 0 && errno != EINTR )
+            break;
+        if( fds[1].revents )
+            break;
+        // join the readers of closed connections
+        for( auto it = m_Readers.begin(); it != m_Readers.end(); ) {
+            if( it->connection->done ) {
+                it->thread.join();
+                it = m_Readers.erase(it);
+            }
+            else
+                ++it;
+        }
+        if( !(fds[0].revents & POLLIN) )
+            continue;
+        const int fd = accept(m_ListenFd, nullptr, nullptr);
+        if( fd < 0 )
+            continue;
+        if( m_Options.unix_path.empty() ) {
+            // responses are small; send them at once instead of waiting to fill a packet
+            const int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+        }
+        auto connection = std::make_shared<Connection>(fd);
+        m_Readers.push_back({connection, std::thread(&RouteServer::ReadRequests, this, connection)});
+    }
+
+    // Drain: stop accepting, make every reader see the end of its input, and wait until the requests
+    // that have been read are answered before the workers stop.
+    close(m_ListenFd);
+    m_ListenFd = -1;
+    if( !m_Options.unix_path.empty() )
+        unlink(m_Options.unix_path.c_str());
+    for( auto &reader: m_Readers )
+        shutdown(reader.connection->fd, SHUT_RD);
+    for( auto &reader: m_Readers )
+        reader.thread.join();
+    m_Readers.clear();
+    {
+        std::lock_guard<std::mutex> lock{m_QueueMutex};
+        m_Closed = true;
+    }
+    m_QueueReady.notify_all();
+    for( auto &worker: m_Workers )
+        worker.join();
+    m_Workers.clear();
+    return true;
+}
+
+// Reads request lines from the connection and queues them for the workers until the client closes
+// its side or the server drains.
+void RouteServer::ReadRequests(std::shared_ptr<Connection> connection)
+{
+    std::string buffer;
+    char chunk[16 * 1024];
+    std::uint64_t sequence = 0;
+    std::vector<Job> jobs;
+    while( true ) {
+        const ssize_t n = recv(connection->fd, chunk, sizeof chunk, 0);
+        if( n < 0 && errno == EINTR )
+            continue;
+        // an error (not the end of the requests) means the client is gone
+        if( n < 0 )
+            connection->Abandon();
+        if( n <= 0 )
+            break;
+        buffer.append(chunk, n);
+
+        std::size_t start = 0;
+        for( std::size_t newline; (newline = buffer.find('\n', start)) != std::string::npos; start = newline + 1 ) {
+            const std::string line = buffer.substr(start, newline - start);
+            if( line.find_first_not_of(" \t\r") == std::string::npos )
+                continue;
+            RouteRequest request;
+            if( auto error = ParseRouteRequest(line, request); !error.empty() ) {
+                connection->Complete(sequence++, FormatErrorResponse(request.id, error));
+                ++m_Answered;
+            }
+            else
+                jobs.push_back({connection, sequence++, std::move(request)});
+        }
+        buffer.erase(0, start);
+
+        // everything that arrived in this chunk is queued at once
+        if( !jobs.empty() ) {
+            {
+                std::lock_guard<std::mutex> lock{m_QueueMutex};
+                for( auto &job: jobs )
+                    m_Queue.push_back(std::move(job));
+            }
+            jobs.size() == 1 ? m_QueueReady.notify_one() : m_QueueReady.notify_all();
+            jobs.clear();
+        }
+        if( buffer.size() > MaxLineLength ) {
+            connection->Complete(sequence++, FormatErrorResponse("null", "request line too long"));
+            ++m_Answered;
+            break;
+        }
+    }
+    connection->WaitWritten(sequence);
+    shutdown(connection->fd, SHUT_WR);
+    connection->done = true;
+}
+
+// Runs queued requests until the queue is closed and empty. Each worker has a planner per profile and
+// metric, made when it is first needed.
+void RouteServer::Work()
+{
+    std::unique_ptr<RoutePlanner> planners[RouteModel::NumProfiles][RouteModel::NumMetrics];
+    while( true ) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock{m_QueueMutex};
+            m_QueueReady.wait(lock, [&] { return m_Closed || !m_Queue.empty(); });
+            if( m_Queue.empty() )
+                return;
+            job = std::move(m_Queue.front());
+            m_Queue.pop_front();
+        }
+        // requests of a client that has gone are dropped; the response is not sent, but it still has to
+        // take its turn
+        auto &monitor = job.connection->monitor;
+        if( monitor.Cancelled() ) {
+            job.connection->Complete(job.sequence, {});
+            continue;
+        }
+        const auto &request = job.request;
+        auto &planner = planners[request.profile][request.metric];
+        if( !planner )
+            planner = std::make_unique<RoutePlanner>(m_Model, request.profile, request.metric);
+        planner->SetEndpoints(request.start_x, request.start_y, request.end_x, request.end_y);
+        if( !m_Cache ) {
+            planner->SetMonitor(&monitor);
+            const bool found = planner->Search();
+            planner->SetMonitor(nullptr);
+            job.connection->Complete(job.sequence, FormatRouteResponse(request, *planner, found));
+            ++m_Answered;
+            continue;
+        }
+
+        // routes between the same snapped nodes are the same, however the request coordinates differ
+        const RouteCache::Key key{planner->StartNode(), planner->EndNode(), request.profile, request.metric};
+        std::string response;
+        if( auto route = m_Cache->Find(key) )
+            response = FormatRouteResponse(request, !route->path.empty(), route->distance, route->duration, route->path);
+        else {
+            const auto version = m_Model.Version();
+            planner->SetMonitor(&monitor);
+            const bool found = planner->Search();
+            planner->SetMonitor(nullptr);
+            response = FormatRouteResponse(request, *planner, found);
+            // a cancelled search has not shown that there is no route
+            if( !planner->Cancelled() )
+                m_Cache->Insert(key, version, {planner->GetPath(), planner->GetDistance(), planner->GetDuration()});
+        }
+        job.connection->Complete(job.sequence, std::move(response));
+        ++m_Answered;
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef ROUTE_SERVER_H
+#define ROUTE_SERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "route_cache.h"
+#include "route_model.h"
+#include "route_protocol.h"
+#include "search_monitor.h"
+
+// A long-lived route query server: the model is loaded once, and clients send requests as lines of
+// JSON (see RouteRequest) over a Unix domain socket or a TCP port on 127.0.0.1, and get one response
+// line per request. Clients may send many requests without waiting (pipelining); the responses of a
+// connection come back in the order of its requests. Requests are run by a pool of workers, each with
+// its own RoutePlanners and so its own search buffers, all sharing the read-only model. Repeated queries
+// between the same snapped nodes can be answered from a RouteCache without searching. When a client
+// disconnects, its queued requests are dropped and its running searches stop.
+class RouteServer {
+  public:
+    struct Options {
+        std::string unix_path;  // listen on this Unix socket if not empty,
+        int tcp_port = 0;       // otherwise on this TCP port of 127.0.0.1
+        int n_workers = 0;      // the number of hardware threads if 0
+        std::size_t cache_bytes = 0;  // the memory budget of the route cache; no cache if 0
+    };
+
+    RouteServer(RouteModel &model, Options options);
+    ~RouteServer();
+
+    // Serves until Stop() is called. Then it stops accepting connections and reading requests, answers
+    // every request that has been read, closes the connections and returns true. Returns false at once
+    // if the socket can not be opened.
+    bool Run();
+    // Makes Run() drain and return. Safe to call from a signal handler or another thread, before or
+    // during Run().
+    void Stop() noexcept;
+
+    // The number of requests answered so far.
+    std::uint64_t Answered() const noexcept { return m_Answered; }
+    // The cache of routes shared by the workers, or nullptr if there is none.
+    const RouteCache *Cache() const noexcept { return m_Cache.get(); }
+
+  private:
+    struct Connection;
+    struct Job {
+        std::shared_ptr<Connection> connection;
+        std::uint64_t sequence;
+        RouteRequest request;
+    };
+
+    bool Listen();
+    void ReadRequests(std::shared_ptr<Connection> connection);
+    void Work();
+
+    RouteModel &m_Model;
+    Options m_Options;
+    int m_ListenFd = -1;
+    int m_StopPipe[2] = {-1, -1};  // Stop() writes a byte to wake up Run()
+    std::atomic<std::uint64_t> m_Answered{0};
+    std::unique_ptr<RouteCache> m_Cache;
+
+    // requests waiting for a worker; m_Closed is set when all readers are done
+    std::mutex m_QueueMutex;
+    std::condition_variable m_QueueReady;
+    std::deque<Job> m_Queue;
+    bool m_Closed = false;
+    std::vector<std::thread> m_Workers;
+
+    // one reader thread per connection
+    struct Reader {
+        std::shared_ptr<Connection> connection;
+        std::thread thread;
+    };
+    std::vector<Reader> m_Readers;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef SEARCH_CONTEXT_H
+#define SEARCH_CONTEXT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Scratch buffers for one graph search (A* or Dijkstra) over a RouteModel road graph.
+// A SearchContext is reused from query to query: Clear() only bumps a generation counter, and all
+// buffers are sized once in Resize(), so a search on a warmed up context does not allocate.
+// Each thread that searches the same model needs its own SearchContext.
+class SearchContext {
+  public:
+    // Sizes the buffers for a graph with n_nodes nodes and n_edges (directed) edges. The open list
+    // never holds more entries than there are edge relaxations, so it can not grow during a search.
+    void Resize(int n_nodes, int n_edges) {
+        if ((int)m_Stamp.size() != n_nodes) {
+            m_Stamp.assign(n_nodes, 0);
+            m_Closed.assign(n_nodes, 0);
+            m_G.resize(n_nodes);
+            m_Parent.resize(n_nodes);
+            m_ParentEdge.resize(n_nodes);
+            m_Generation = 0;
+            m_ClosedGeneration = 0;
+        }
+        m_Open.reserve(n_edges + 1);
+        Clear();
+    }
+
+    // Forgets the previous search in O(1).
+    void Clear() {
+        m_Open.clear();
+        if (++m_Generation == 0) {
+            // the counter wrapped around: stamps of old searches could look current again
+            std::fill(m_Stamp.begin(), m_Stamp.end(), 0);
+            m_Generation = 1;
+        }
+        ClearClosed();
+    }
+
+    // Reopens all closed nodes but keeps their g-values and parents, for searches that expand nodes
+    // again with a different key (anytime A*). Closed nodes have their own counter for this.
+    void ClearClosed() {
+        if (++m_ClosedGeneration == 0) {
+            std::fill(m_Closed.begin(), m_Closed.end(), 0);
+            m_ClosedGeneration = 1;
+        }
+    }
+
+    int Size() const noexcept { return (int)m_Stamp.size(); }
+
+    // true if the node has been reached (has a g-value) in the current search
+    bool Reached(int node) const noexcept { return m_Stamp[node] == m_Generation; }
+    // true if the node has been expanded in the current search; its g-value is final
+    bool Closed(int node) const noexcept { return m_Closed[node] == m_ClosedGeneration; }
+    float G(int node) const noexcept { return Reached(node) ? m_G[node] : std::numeric_limits<float>::max(); }
+    // the node before this one on the best path found so far, or -1 for the start node
+    int Parent(int node) const noexcept { return Reached(node) ? m_Parent[node] : -1; }
+    // the edge from Parent(node) to node, or -1
+    int ParentEdge(int node) const noexcept { return Reached(node) ? m_ParentEdge[node] : -1; }
+
+    // Records a (better) path to the node.
+    void Reach(int node, float g, int parent, int parent_edge) noexcept {
+        m_Stamp[node] = m_Generation;
+        m_G[node] = g;
+        m_Parent[node] = parent;
+        m_ParentEdge[node] = parent_edge;
+    }
+    void Close(int node) noexcept { m_Closed[node] = m_ClosedGeneration; }
+
+    // The open list is a binary min-heap on the key f. A node whose g-value improves is pushed again
+    // instead of being moved in the heap; the outdated entry is skipped when it is popped.
+    void Push(int node, float f) {
+        m_Open.push_back({f, node});
+        std::push_heap(m_Open.begin(), m_Open.end(), Greater);
+    }
+    // Removes and returns the open node with the lowest key that has not been closed yet, or -1.
+    int Pop() {
+        while (!m_Open.empty()) {
+            std::pop_heap(m_Open.begin(), m_Open.end(), Greater);
+            const int node = m_Open.back().node;
+            m_Open.pop_back();
+            if (!Closed(node))
+                return node;
+        }
+        return -1;
+    }
+    // Drops the entries of closed nodes from the open list and gives the others the new key key(node).
+    template <typename Key>
+    void Rekey(Key key) {
+        m_Open.erase(std::remove_if(m_Open.begin(), m_Open.end(), [&](const OpenEntry &entry) { return Closed(entry.node); }),
+                     m_Open.end());
+        for (auto &entry : m_Open)
+            entry.f = key(entry.node);
+        std::make_heap(m_Open.begin(), m_Open.end(), Greater);
+    }
+    bool OpenEmpty() const noexcept { return m_Open.empty(); }
+    // lowest key in the open list, or max float if it is empty (may belong to an outdated entry)
+    float MinKey() const noexcept { return m_Open.empty() ? std::numeric_limits<float>::max() : m_Open.front().f; }
+
+  private:
+    struct OpenEntry {
+        float f;
+        int node;
+    };
+    static bool Greater(const OpenEntry &a, const OpenEntry &b) noexcept { return a.f > b.f; }
+
+    std::uint32_t m_Generation = 0;
+    std::uint32_t m_ClosedGeneration = 0;
+    std::vector<std::uint32_t> m_Stamp;
+    std::vector<std::uint32_t> m_Closed;
+    std::vector<float> m_G;
+    std::vector<int> m_Parent;
+    std::vector<int> m_ParentEdge;
+    std::vector<OpenEntry> m_Open;
+};
+
+#endif
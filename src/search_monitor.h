@@ -0,0 +1,39 @@
+#ifndef SEARCH_MONITOR_H
+#define SEARCH_MONITOR_H
+
+#include <algorithm>
+#include <atomic>
+
+// Lets other threads watch a running search and stop it. The search reports its progress and checks
+// whether it has been cancelled every CheckInterval() settled nodes, so a cancelled search ends within
+// that many expansions, and the expansions in between only count.
+class SearchMonitor {
+  public:
+    explicit SearchMonitor(int check_interval = 256) : m_CheckInterval(std::max(check_interval, 1)) {}
+
+    // Asks the search to stop; it returns false as if there were no route. Safe to call from any thread.
+    void Cancel() noexcept { m_Cancelled.store(true, std::memory_order_relaxed); }
+    bool Cancelled() const noexcept { return m_Cancelled.load(std::memory_order_relaxed); }
+
+    // The number of nodes settled at the last check, and an estimate of how far the search has got
+    // from 0 to 1: how much closer than the start the settled nodes have come to the end.
+    int Settled() const noexcept { return m_Settled.load(std::memory_order_relaxed); }
+    float Progress() const noexcept { return m_Progress.load(std::memory_order_relaxed); }
+
+    int CheckInterval() const noexcept { return m_CheckInterval; }
+    // Called by the search; returns false if it should stop.
+    bool Report(int settled, float progress) noexcept {
+        m_Settled.store(settled, std::memory_order_relaxed);
+        if (progress > m_Progress.load(std::memory_order_relaxed))
+            m_Progress.store(std::min(progress, 1.0f), std::memory_order_relaxed);
+        return !Cancelled();
+    }
+
+  private:
+    const int m_CheckInterval;
+    std::atomic<bool> m_Cancelled{false};
+    std::atomic<int> m_Settled{0};
+    std::atomic<float> m_Progress{0.0f};
+};
+
+#endif
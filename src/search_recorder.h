@@ -0,0 +1,62 @@
+#ifndef SEARCH_RECORDER_H
+#define SEARCH_RECORDER_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Records which nodes a search settled (expanded) and relaxed (reached or improved), in order, for
+// debugging and for drawing the explored area afterwards. An event takes 8 bytes, the buffer is
+// allocated once up front, and the clock is read once per settled node (the relax events of an
+// expansion share its time stamp), so recording is cheap enough to leave on. Events beyond the
+// capacity are dropped and Overflowed() is set.
+class SearchRecorder {
+  public:
+    struct Event {
+        int node;
+        // the event kind in the top bit (1 for settled), the time since Begin() in ns in the lower 31 bits
+        std::uint32_t time_and_kind;
+
+        bool IsSettled() const noexcept { return time_and_kind >> 31; }
+        std::uint32_t Nanoseconds() const noexcept { return time_and_kind & TimeMask; }
+    };
+
+    explicit SearchRecorder(std::size_t capacity = 1 << 20) { m_Events.reserve(capacity); }
+
+    // Forgets the previous search and starts the clock.
+    void Begin() noexcept {
+        m_Events.clear();
+        m_Overflowed = false;
+        m_Start = std::chrono::steady_clock::now();
+        m_Now = 0;
+    }
+    void Settle(int node) noexcept {
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_Start).count();
+        // times of more than about 2 s saturate
+        m_Now = elapsed < TimeMask ? static_cast<std::uint32_t>(elapsed) : TimeMask;
+        Add(node, SettledBit | m_Now);
+    }
+    void Relax(int node) noexcept { Add(node, m_Now); }
+
+    const std::vector<Event> &Events() const noexcept { return m_Events; }
+    bool Overflowed() const noexcept { return m_Overflowed; }
+
+  private:
+    static constexpr std::uint32_t SettledBit = 1u << 31;
+    static constexpr std::uint32_t TimeMask = SettledBit - 1;
+
+    void Add(int node, std::uint32_t time_and_kind) noexcept {
+        if (m_Events.size() == m_Events.capacity()) {
+            m_Overflowed = true;
+            return;
+        }
+        m_Events.push_back({node, time_and_kind});
+    }
+
+    std::vector<Event> m_Events;
+    bool m_Overflowed = false;
+    std::chrono::steady_clock::time_point m_Start;
+    std::uint32_t m_Now = 0;
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include "spatial_index.h"
+#include <algorithm>
+#include <cmath>
+
+void Box::Extend(double x, double y) noexcept
+{
+    if( Empty() ) {
+        min_x = max_x = x;
+        min_y = max_y = y;
+        return;
+    }
+    min_x = std::min(min_x, x); max_x = std::max(max_x, x);
+    min_y = std::min(min_y, y); max_y = std::max(max_y, y);
+}
+
+void Box::Extend(const Box &other) noexcept
+{
+    if( other.Empty() )
+        return;
+    Extend(other.min_x, other.min_y);
+    Extend(other.max_x, other.max_y);
+}
+
+SpatialIndex::SpatialIndex(const std::vector<Box> &boxes)
+{
+    for( int i = 0; i < (int)boxes.size(); ++i )
+        if( !boxes[i].Empty() )
+            m_Ids.push_back(i);
+    if( m_Ids.empty() )
+        return;
+
+    auto center_x = [&](int id) { return boxes[id].min_x + boxes[id].max_x; };
+    auto center_y = [&](int id) { return boxes[id].min_y + boxes[id].max_y; };
+
+    // Sort-Tile-Recursive: sort by x, cut into slices of about sqrt(n / NodeSize) nodes each, and sort each
+    // slice by y, so that runs of NodeSize consecutive items are close together
+    const int n = (int)m_Ids.size();
+    const int n_leaves = (n + NodeSize - 1) / NodeSize;
+    const int slice_size = NodeSize * (int)std::ceil(std::sqrt((double)n_leaves));
+    std::sort(m_Ids.begin(), m_Ids.end(), [&](int a, int b) { return center_x(a) < center_x(b); });
+    for( int start = 0; start < n; start += slice_size ) {
+        auto end = m_Ids.begin() + std::min(n, start + slice_size);
+        std::sort(m_Ids.begin() + start, end, [&](int a, int b) { return center_y(a) < center_y(b); });
+    }
+
+    m_Boxes.reserve(n + n / (NodeSize - 1) + 2);
+    for( int id: m_Ids )
+        m_Boxes.push_back(boxes[id]);
+    m_LevelStart = {0, n};
+
+    // pack each level into nodes of NodeSize consecutive boxes until there is a single root
+    while( m_LevelStart.back() - m_LevelStart[m_LevelStart.size() - 2] > 1 ) {
+        const int begin = m_LevelStart[m_LevelStart.size() - 2];
+        const int end = m_LevelStart.back();
+        for( int child = begin; child < end; child += NodeSize ) {
+            Box node;
+            for( int i = child; i < std::min(end, child + NodeSize); ++i )
+                node.Extend(m_Boxes[i]);
+            m_Boxes.push_back(node);
+        }
+        m_LevelStart.push_back((int)m_Boxes.size());
+    }
+}
+
+void SpatialIndex::Query(const Box &box, std::vector<int> &result) const
+{
+    if( m_LevelStart.size() < 2 )
+        return;
+    const int top = (int)m_LevelStart.size() - 2;
+    QueryNode(top, 0, box, result);
+}
+
+// Visits node `node` (counted from the start of its level) of the given level.
+void SpatialIndex::QueryNode(int level, int node, const Box &box, std::vector<int> &result) const
+{
+    const int position = m_LevelStart[level] + node;
+    if( !m_Boxes[position].Intersects(box) )
+        return;
+    if( level == 0 ) {
+        result.push_back(m_Ids[node]);
+        return;
+    }
+    const int first_child = node * NodeSize;
+    const int n_children = m_LevelStart[level] - m_LevelStart[level - 1];
+    for( int child = first_child; child < std::min(n_children, first_child + NodeSize); ++child )
+        QueryNode(level - 1, child, box, result);
+}
+
+Box WayBox(const Model &model, const Model::Way &way)
+{
+    Box box;
+    for( int node_idx: way.nodes )
+        box.Extend(model.Nodes()[node_idx].x, model.Nodes()[node_idx].y);
+    return box;
+}
+
+Box MultipolygonBox(const Model &model, const Model::Multipolygon &mp)
+{
+    // the inner rings lie inside the outer rings, but a multipolygon without outer rings is still drawn
+    Box box;
+    for( int way_num: mp.outer )
+        box.Extend(WayBox(model, model.Ways()[way_num]));
+    for( int way_num: mp.inner )
+        box.Extend(WayBox(model, model.Ways()[way_num]));
+    return box;
+}
+
+FeatureIndex::FeatureIndex(const Model &model)
+{
+    auto way_boxes = [&](const auto &features) {
+        std::vector<Box> boxes;
+        boxes.reserve(features.size());
+        for( auto &feature: features )
+            boxes.push_back(WayBox(model, model.Ways()[feature.way]));
+        return boxes;
+    };
+    auto mp_boxes = [&](const auto &features) {
+        std::vector<Box> boxes;
+        boxes.reserve(features.size());
+        for( auto &feature: features )
+            boxes.push_back(MultipolygonBox(model, feature));
+        return boxes;
+    };
+    m_Roads = SpatialIndex{way_boxes(model.Roads())};
+    m_Railways = SpatialIndex{way_boxes(model.Railways())};
+    m_Buildings = SpatialIndex{mp_boxes(model.Buildings())};
+    m_Leisures = SpatialIndex{mp_boxes(model.Leisures())};
+    m_Waters = SpatialIndex{mp_boxes(model.Waters())};
+    m_Landuses = SpatialIndex{mp_boxes(model.Landuses())};
+}
+
+Box FeatureIndex::Bounds() const noexcept
+{
+    Box box;
+    for( auto index: {&m_Roads, &m_Railways, &m_Buildings, &m_Leisures, &m_Waters, &m_Landuses} )
+        box.Extend(index->Bounds());
+    return box;
+}
@@ -0,0 +1,76 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <vector>
+#include "model.h"
+
+// An axis aligned bounding box in map coordinates.
+struct Box {
+    double min_x = 0.;
+    double min_y = 0.;
+    double max_x = -1.;
+    double max_y = -1.;
+
+    bool Empty() const noexcept { return max_x < min_x || max_y < min_y; }
+    bool Intersects(const Box &other) const noexcept {
+        return !Empty() && !other.Empty() &&
+               min_x <= other.max_x && other.min_x <= max_x && min_y <= other.max_y && other.min_y <= max_y;
+    }
+    // grow the box so that it contains the point / the other box
+    void Extend(double x, double y) noexcept;
+    void Extend(const Box &other) noexcept;
+};
+
+// A static R-tree over a set of boxes, bulk loaded with the Sort-Tile-Recursive method: the boxes are
+// sorted into vertical slices by x, each slice is sorted by y, and consecutive runs of boxes are packed
+// into nodes. The tree is stored level by level in flat arrays and can not be changed after it is built.
+class SpatialIndex {
+  public:
+    SpatialIndex() = default;
+    // Item i of the index is boxes[i]; empty boxes are left out.
+    explicit SpatialIndex(const std::vector<Box> &boxes);
+
+    // Appends the ids of the items whose boxes intersect the query box to result.
+    void Query(const Box &box, std::vector<int> &result) const;
+    int Size() const noexcept { return (int)m_Ids.size(); }
+    // box containing all items
+    Box Bounds() const noexcept { return m_LevelStart.size() < 2 ? Box{} : m_Boxes.back(); }
+
+  private:
+    void QueryNode(int level, int node, const Box &box, std::vector<int> &result) const;
+
+    static constexpr int NodeSize = 16;
+    std::vector<Box> m_Boxes;       // the boxes of all levels, starting with the items (level 0)
+    std::vector<int> m_Ids;         // item id of each level 0 box
+    std::vector<int> m_LevelStart;  // position of the first box of each level in m_Boxes, plus the end
+};
+
+// Bounding boxes of model features.
+Box WayBox(const Model &model, const Model::Way &way);
+Box MultipolygonBox(const Model &model, const Model::Multipolygon &mp);
+
+// One SpatialIndex per layer of a Model, over the bounding boxes of its features. Item i of Roads()
+// is model.Roads()[i], and so on.
+class FeatureIndex {
+  public:
+    explicit FeatureIndex(const Model &model);
+
+    auto &Roads() const noexcept { return m_Roads; }
+    auto &Railways() const noexcept { return m_Railways; }
+    auto &Buildings() const noexcept { return m_Buildings; }
+    auto &Leisures() const noexcept { return m_Leisures; }
+    auto &Waters() const noexcept { return m_Waters; }
+    auto &Landuses() const noexcept { return m_Landuses; }
+    // box containing all indexed features
+    Box Bounds() const noexcept;
+
+  private:
+    SpatialIndex m_Roads;
+    SpatialIndex m_Railways;
+    SpatialIndex m_Buildings;
+    SpatialIndex m_Leisures;
+    SpatialIndex m_Waters;
+    SpatialIndex m_Landuses;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#include "tile_grid.h"
+#include <algorithm>
+#include <cmath>
+
+Box TileBox(const Model &model, const TileId &tile)
+{
+    const double size = std::ldexp(1., -tile.z);
+    Box box;
+    // world y grows southwards, model y northwards
+    box.Extend(model.ModelX(tile.x * size), model.ModelY((tile.y + 1) * size));
+    box.Extend(model.ModelX((tile.x + 1) * size), model.ModelY(tile.y * size));
+    return box;
+}
+
+std::vector<TileId> TilesCovering(const Model &model, const Box &box, int z)
+{
+    std::vector<TileId> tiles;
+    if( box.Empty() )
+        return tiles;
+    const double n = std::ldexp(1., z);
+    const int last = (1 << z) - 1;
+    auto tile_index = [&](double world) { return std::clamp((int)std::floor(world * n), 0, last); };
+    const int min_x = tile_index(model.WorldX(box.min_x)), max_x = tile_index(model.WorldX(box.max_x));
+    const int min_y = tile_index(model.WorldY(box.max_y)), max_y = tile_index(model.WorldY(box.min_y));
+    tiles.reserve((max_x - min_x + 1) * (max_y - min_y + 1));
+    for( int y = min_y; y <= max_y; ++y )
+        for( int x = min_x; x <= max_x; ++x )
+            tiles.push_back({z, x, y});
+    return tiles;
+}
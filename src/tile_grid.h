@@ -0,0 +1,22 @@
+#ifndef TILE_GRID_H
+#define TILE_GRID_H
+
+#include <vector>
+#include "model.h"
+#include "spatial_index.h"
+
+// A tile of the standard XYZ ("slippy map") grid: at zoom level z the Web Mercator world is cut into
+// 2^z x 2^z tiles, numbered from west to east (x) and from north to south (y).
+struct TileId {
+    int z = 0;
+    int x = 0;
+    int y = 0;
+};
+
+// The area of the tile in model coordinates.
+Box TileBox(const Model &model, const TileId &tile);
+
+// The tiles of zoom level z that intersect the box (in model coordinates), row by row.
+std::vector<TileId> TilesCovering(const Model &model, const Box &box, int z);
+
+#endif
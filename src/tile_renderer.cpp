@@ -0,0 +1,133 @@
+#include "tile_renderer.h"
+#include <atomic>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Draws the map area of the box (a tile) so that it fills the surface.
+static void DrawTile(Render &render, const Box &box, io2d::image_surface &surface)
+{
+    // at zoom 1 Render fits a side of length 1 into the surface, so a tile needs a zoom of 1 / its side
+    render.SetView(static_cast<float>((box.min_x + box.max_x) / 2.), static_cast<float>((box.min_y + box.max_y) / 2.),
+                   static_cast<float>(1. / (box.max_x - box.min_x)));
+    render.DisplayMap(surface);
+}
+
+TileRenderer::TileRenderer(RouteModel &model):
+    m_Model(model),
+    m_Index(std::make_shared<FeatureIndex>(model)),
+    m_Pyramid(std::make_shared<WayPyramid>(model))
+{
+}
+
+// true if any feature lies within the box, widened by the widest road so that strokes are not cut off
+bool TileRenderer::HasFeatures(const Box &box, std::vector<int> &scratch) const
+{
+    const double margin = 10. / m_Model.MetricScale();
+    Box query = box;
+    query.Extend(box.min_x - margin, box.min_y - margin);
+    query.Extend(box.max_x + margin, box.max_y + margin);
+    scratch.clear();
+    for( auto index: {&m_Index->Roads(), &m_Index->Railways(), &m_Index->Buildings(),
+                      &m_Index->Leisures(), &m_Index->Waters(), &m_Index->Landuses()} ) {
+        index->Query(query, scratch);
+        if( !scratch.empty() )
+            return true;
+    }
+    return false;
+}
+
+TileRenderer::Stats TileRenderer::RenderTiles(int min_zoom, int max_zoom, const std::string &dir, int n_threads)
+{
+    std::vector<TileId> tiles;
+    for( int z = min_zoom; z <= max_zoom; ++z ) {
+        auto level = TilesCovering(m_Model, m_Index->Bounds(), z);
+        tiles.insert(tiles.end(), level.begin(), level.end());
+    }
+    if( n_threads <= 0 )
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    auto tile_path = [&](const TileId &tile) {
+        return fs::path{dir} / std::to_string(tile.z) / std::to_string(tile.x) / (std::to_string(tile.y) + ".png");
+    };
+
+    // Tiles without features are all plain background, so only one of them is drawn (after the workers
+    // are done) and the others are linked to it.
+    std::atomic<std::size_t> next{0};
+    std::atomic<int> rendered{0}, failed{0};
+    std::mutex background_mutex;
+    std::vector<TileId> background;
+
+    auto worker = [&]() {
+        Render render{m_Model, m_Index, m_Pyramid};
+        io2d::image_surface surface{io2d::format::argb32, TileSize, TileSize};
+        std::vector<int> scratch;
+        for( std::size_t i; (i = next++) < tiles.size(); ) {
+            const auto &tile = tiles[i];
+            const auto box = TileBox(m_Model, tile);
+            if( !HasFeatures(box, scratch) ) {
+                std::lock_guard<std::mutex> lock{background_mutex};
+                background.push_back(tile);
+                continue;
+            }
+            DrawTile(render, box, surface);
+            const auto file = tile_path(tile);
+            std::error_code ec;
+            fs::create_directories(file.parent_path(), ec);
+            try {
+                surface.save(file, io2d::image_file_format::png);
+                ++rendered;
+            }
+            catch( const std::system_error &e ) {
+                std::cout << "Failed to write " << file << ": " << e.what() << std::endl;
+                ++failed;
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for( int t = 0; t < n_threads; ++t )
+        threads.emplace_back(worker);
+    for( auto &thread: threads )
+        thread.join();
+
+    Stats stats;
+    stats.rendered = rendered;
+    stats.failed = failed;
+    if( background.empty() )
+        return stats;
+
+    const auto background_file = fs::path{dir} / "background.png";
+    try {
+        Render render{m_Model, m_Index, m_Pyramid};
+        io2d::image_surface surface{io2d::format::argb32, TileSize, TileSize};
+        const auto box = TileBox(m_Model, background.front());
+        DrawTile(render, box, surface);
+        fs::create_directories(dir);
+        surface.save(background_file, io2d::image_file_format::png);
+    }
+    catch( const std::system_error &e ) {
+        std::cout << "Failed to write " << background_file << ": " << e.what() << std::endl;
+        stats.failed += (int)background.size();
+        return stats;
+    }
+    for( auto &tile: background ) {
+        const auto file = tile_path(tile);
+        std::error_code ec;
+        fs::create_directories(file.parent_path(), ec);
+        fs::remove(file, ec);
+        // fall back to a copy on file systems without hard links
+        fs::create_hard_link(background_file, file, ec);
+        if( ec )
+            fs::copy_file(background_file, file, ec);
+        if( ec )
+            ++stats.failed;
+        else
+            ++stats.background;
+    }
+    return stats;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <io2d.h>
+#include "render.h"
+#include "route_model.h"
+#include "spatial_index.h"
+#include "tile_grid.h"
+#include "way_pyramid.h"
+
+using namespace std::experimental;
+
+// Renders the map into a pyramid of 256 x 256 PNG tiles in the standard XYZ layout (dir/z/x/y.png),
+// with the styles of Render. The tiles are shared out among worker threads; each thread has its own
+// Render and surface, and all of them share the model, its spatial index and its simplified geometry.
+class TileRenderer
+{
+public:
+    static constexpr int TileSize = 256;
+
+    struct Stats {
+        int rendered = 0;    // tiles drawn and saved
+        int background = 0;  // tiles without features, linked to one shared background tile
+        int failed = 0;      // tiles that could not be written
+    };
+
+    explicit TileRenderer(RouteModel &model);
+
+    // Renders every tile from min_zoom to max_zoom that covers the map, using n_threads threads
+    // (the number of hardware threads if 0). Tiles outside the map are not written.
+    Stats RenderTiles(int min_zoom, int max_zoom, const std::string &dir, int n_threads = 0);
+
+private:
+    bool HasFeatures(const Box &box, std::vector<int> &scratch) const;
+
+    RouteModel &m_Model;
+    std::shared_ptr<const FeatureIndex> m_Index;
+    std::shared_ptr<const WayPyramid> m_Pyramid;
+};
@@ -0,0 +1,124 @@
+#include "way_pyramid.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+// Distance from node p to the segment from node a to node b.
+static double SegmentDistance(const Model::Node &p, const Model::Node &a, const Model::Node &b)
+{
+    const double dx = b.x - a.x, dy = b.y - a.y;
+    const double length2 = dx * dx + dy * dy;
+    double t = length2 > 0. ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / length2 : 0.;
+    t = std::clamp(t, 0., 1.);
+    const double ex = a.x + t * dx - p.x, ey = a.y + t * dy - p.y;
+    return std::sqrt(ex * ex + ey * ey);
+}
+
+void SimplifyWay(const Model &model, const std::vector<int> &nodes, double tolerance, std::vector<int> &result)
+{
+    const int n = (int)nodes.size();
+    if( n < 3 ) {
+        result.insert(result.end(), nodes.begin(), nodes.end());
+        return;
+    }
+    const auto coords = model.Nodes().data();
+
+    std::vector<char> keep(n, 0);
+    keep[0] = keep[n - 1] = 1;
+    // explicit stack of (first, last) ranges still to be simplified
+    std::vector<std::pair<int, int>> ranges;
+    if( nodes.front() == nodes.back() ) {
+        // a closed ring: the chord from the first to the last node is a single point, so split the ring
+        // at the node farthest from its start first
+        int farthest = 1;
+        double max_dist = -1.;
+        for( int i = 1; i < n - 1; ++i ) {
+            const double dist = SegmentDistance(coords[nodes[i]], coords[nodes[0]], coords[nodes[0]]);
+            if( dist > max_dist ) {
+                max_dist = dist;
+                farthest = i;
+            }
+        }
+        keep[farthest] = 1;
+        ranges = {{0, farthest}, {farthest, n - 1}};
+    }
+    else
+        ranges = {{0, n - 1}};
+
+    while( !ranges.empty() ) {
+        auto [first, last] = ranges.back();
+        ranges.pop_back();
+        int farthest = -1;
+        double max_dist = tolerance;
+        for( int i = first + 1; i < last; ++i ) {
+            const double dist = SegmentDistance(coords[nodes[i]], coords[nodes[first]], coords[nodes[last]]);
+            if( dist > max_dist ) {
+                max_dist = dist;
+                farthest = i;
+            }
+        }
+        if( farthest < 0 )
+            continue;
+        keep[farthest] = 1;
+        ranges.emplace_back(first, farthest);
+        ranges.emplace_back(farthest, last);
+    }
+
+    for( int i = 0; i < n; ++i )
+        if( keep[i] )
+            result.push_back(nodes[i]);
+}
+
+WayPyramid::WayPyramid(const Model &model): m_Model(model)
+{
+    const auto &ways = model.Ways();
+    m_Extent.resize(ways.size());
+    for( std::size_t i = 0; i < ways.size(); ++i ) {
+        if( ways[i].nodes.empty() )
+            continue;
+        double min_x = model.Nodes()[ways[i].nodes.front()].x, max_x = min_x;
+        double min_y = model.Nodes()[ways[i].nodes.front()].y, max_y = min_y;
+        for( int node_idx: ways[i].nodes ) {
+            auto &node = model.Nodes()[node_idx];
+            min_x = std::min(min_x, node.x); max_x = std::max(max_x, node.x);
+            min_y = std::min(min_y, node.y); max_y = std::max(max_y, node.y);
+        }
+        m_Extent[i] = static_cast<float>(std::max(max_x - min_x, max_y - min_y));
+    }
+
+    // every level is simplified from the full geometry, so the errors do not add up
+    for( int level = 1; level < NumLevels; ++level ) {
+        auto &offsets = m_Offsets[level];
+        auto &nodes = m_Nodes[level];
+        offsets.reserve(ways.size() + 1);
+        offsets.push_back(0);
+        for( auto &way: ways ) {
+            SimplifyWay(model, way.nodes, Tolerance(level), nodes);
+            offsets.push_back((int)nodes.size());
+        }
+    }
+}
+
+// The tolerance grows by a factor of 4 per level, starting at 1/4096 of the map size at level 1.
+double WayPyramid::Tolerance(int level) noexcept
+{
+    return level == 0 ? 0. : std::ldexp(1., 2 * (level - 1) - 12);
+}
+
+int WayPyramid::LevelFor(double max_error) noexcept
+{
+    int level = 0;
+    while( level + 1 < NumLevels && Tolerance(level + 1) <= max_error )
+        ++level;
+    return level;
+}
+
+WayPyramid::NodeSpan WayPyramid::Nodes(int level, int way) const noexcept
+{
+    if( level == 0 ) {
+        auto &nodes = m_Model.Ways()[way].nodes;
+        return {nodes.data(), nodes.data() + nodes.size()};
+    }
+    const int *data = m_Nodes[level].data();
+    return {data + m_Offsets[level][way], data + m_Offsets[level][way + 1]};
+}
@@ -0,0 +1,47 @@
+#ifndef WAY_PYRAMID_H
+#define WAY_PYRAMID_H
+
+#include <vector>
+#include "model.h"
+
+// Simplified geometry of every way of a Model at several levels of detail, precomputed with the
+// Douglas-Peucker algorithm. Level 0 is the full geometry; at level k > 0 no node that is left out is
+// farther than Tolerance(k) (in map units) from the simplified way. A renderer picks the coarsest
+// level whose tolerance is below a pixel, so sub-pixel detail is never drawn.
+class WayPyramid {
+  public:
+    static constexpr int NumLevels = 5;
+
+    // The node indices of one way at one level.
+    struct NodeSpan {
+        const int *first = nullptr;
+        const int *last = nullptr;
+        const int *begin() const noexcept { return first; }
+        const int *end() const noexcept { return last; }
+        int size() const noexcept { return (int)(last - first); }
+        bool empty() const noexcept { return first == last; }
+    };
+
+    explicit WayPyramid(const Model &model);
+
+    static double Tolerance(int level) noexcept;
+    // the coarsest level whose tolerance is not larger than max_error
+    static int LevelFor(double max_error) noexcept;
+
+    NodeSpan Nodes(int level, int way) const noexcept;
+    // the larger of the width and the height of the way, in map units
+    float Extent(int way) const noexcept { return m_Extent[way]; }
+
+  private:
+    const Model &m_Model;
+    // for level k > 0, the nodes of way i are m_Nodes[k][m_Offsets[k][i]] ... m_Nodes[k][m_Offsets[k][i+1] - 1]
+    std::vector<int> m_Nodes[NumLevels];
+    std::vector<int> m_Offsets[NumLevels];
+    std::vector<float> m_Extent;
+};
+
+// Appends the nodes of the polyline that Douglas-Peucker keeps for the given tolerance to result.
+// The first and last nodes are always kept.
+void SimplifyWay(const Model &model, const std::vector<int> &nodes, double tolerance, std::vector<int> &result);
+
+#endif
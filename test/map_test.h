@@ -0,0 +1,82 @@
+#ifndef MAP_TEST_H
+#define MAP_TEST_H
+
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../src/route_model.h"
+#include "../src/search_context.h"
+#include "../src/utility_route_model.h"
+
+// The fixture of the tests that run on the test map. Each test gets its own model, which it may change.
+// A test whose map can not be read fails in SetUp() and does not run.
+class MapTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        auto osm_data = ReadFile("../map.osm");
+        ASSERT_TRUE(osm_data) << "Failed to read ../map.osm";
+        model = std::make_unique<RouteModel>(*osm_data);
+    }
+
+    // n random nodes on roads of the profile, the same for the same seed
+    std::vector<int> RandomNodes(int n, unsigned seed, RouteModel::Profile profile = RouteModel::Car) {
+        std::mt19937 rng{seed};
+        std::uniform_real_distribution<float> coordinate{0.f, 100.f};
+        std::vector<int> nodes;
+        for (int i = 0; i < n; i++)
+            nodes.push_back(model->ClosestNodeIndex(coordinate(rng) * 0.01f, coordinate(rng) * 0.01f, profile, true));
+        return nodes;
+    }
+
+    // The costs from the source to every node by Dijkstra over the road graph with the given edge
+    // weights (in the order of RouteModel::EdgeTo()); the largest float, like ContractionHierarchy::Infinity,
+    // for nodes that can not be reached.
+    std::vector<float> Dijkstra(int source, const std::vector<float> &weights, RouteModel::Profile profile = RouteModel::Car) {
+        SearchContext context;
+        context.Resize((int)model->SNodes().size(), (int)model->EdgeTo().size());
+        context.Reach(source, 0.f, -1, -1);
+        context.Push(source, 0.f);
+        for (int node = context.Pop(); node >= 0; node = context.Pop()) {
+            context.Close(node);
+            for (int e = model->FirstEdge()[node]; e < model->FirstEdge()[node + 1]; e++) {
+                const float g = context.G(node) + weights[e];
+                if (model->EdgeAccessible(e, profile) && g < context.G(model->EdgeTo()[e])) {
+                    context.Reach(model->EdgeTo()[e], g, node, e);
+                    context.Push(model->EdgeTo()[e], g);
+                }
+            }
+        }
+        std::vector<float> costs(model->SNodes().size(), std::numeric_limits<float>::max());
+        for (int node = 0; node < (int)costs.size(); node++)
+            if (context.Closed(node))
+                costs[node] = context.G(node);
+        return costs;
+    }
+
+    // The sum of the weights of the steps of the path, each over the cheapest road between its nodes
+    // that the profile may use; the largest float if a step is not such a road.
+    float PathCost(const std::vector<int> &path, const std::vector<float> &weights, RouteModel::Profile profile = RouteModel::Car) {
+        float sum = 0.f;
+        for (std::size_t i = 1; i < path.size(); i++) {
+            float step = std::numeric_limits<float>::max();
+            for (int e = model->FirstEdge()[path[i - 1]]; e < model->FirstEdge()[path[i - 1] + 1]; e++)
+                if (model->EdgeTo()[e] == path[i] && model->EdgeAccessible(e, profile))
+                    step = std::min(step, weights[e]);
+            if (step == std::numeric_limits<float>::max())
+                return step;
+            sum += step;
+        }
+        return sum;
+    }
+    // true if every step of the path is a road the profile may use
+    bool FollowsRoads(const std::vector<int> &path, RouteModel::Profile profile = RouteModel::Car) {
+        return PathCost(path, model->EdgeWeights(profile, RouteModel::Distance), profile) != std::numeric_limits<float>::max();
+    }
+
+    std::unique_ptr<RouteModel> model;
+};
+
+#endif
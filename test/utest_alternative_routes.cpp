@@ -0,0 +1,52 @@
+#include "gtest/gtest.h"
+#include <unordered_set>
+#include <vector>
+#include "../src/alternative_routes.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+#include "map_test.h"
+
+
+class AlternativeRoutesTest : public MapTest {};
+
+// The first route is the planner's best route, and the alternatives are admissible: they follow the
+// roads from start to end, stay within the stretch and share little with the routes before them.
+TEST_F(AlternativeRoutesTest, TestAdmissibleAlternatives) {
+    AlternativeRoutes alternatives{*model};
+    RoutePlanner planner{*model};
+    AlternativeRoutes::Options options;
+    int total_alternatives = 0;
+    const float queries[][4] = {{10, 10, 90, 90}, {10, 90, 90, 10}, {20, 50, 80, 50}, {50, 10, 50, 90}, {30, 30, 70, 80}};
+    for (auto &q : queries) {
+        alternatives.SetEndpoints(q[0], q[1], q[2], q[3]);
+        planner.SetEndpoints(q[0], q[1], q[2], q[3]);
+        ASSERT_TRUE(planner.Search());
+        auto &routes = alternatives.Find(options);
+        ASSERT_GE(routes.size(), 1);
+        ASSERT_LE(routes.size(), options.max_routes);
+        EXPECT_EQ(routes[0].path, planner.GetPath());
+        EXPECT_FLOAT_EQ(routes[0].distance, planner.GetDistance());
+        total_alternatives += (int)routes.size() - 1;
+
+        std::vector<std::vector<int>> earlier;
+        for (auto &route : routes) {
+            EXPECT_EQ(route.path.front(), planner.StartNode());
+            EXPECT_EQ(route.path.back(), planner.EndNode());
+            EXPECT_LE(route.cost, (1.f + options.max_stretch) * routes[0].cost * 1.0001f);
+            EXPECT_GE(route.cost, routes[0].cost * 0.9999f);
+            EXPECT_LE(route.shared, options.max_sharing + 1e-4f);
+            ASSERT_TRUE(FollowsRoads(route.path));
+            // no node is visited twice
+            EXPECT_EQ(std::unordered_set<int>(route.path.begin(), route.path.end()).size(), route.path.size());
+            for (auto &path : earlier)
+                EXPECT_NE(route.path, path);
+            earlier.push_back(route.path);
+        }
+    }
+    EXPECT_GT(total_alternatives, 0);
+
+    // asking for one route gives just the best route
+    alternatives.SetEndpoints(10, 10, 90, 90);
+    options.max_routes = 1;
+    EXPECT_EQ(alternatives.Find(options).size(), 1);
+}
@@ -0,0 +1,93 @@
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "../src/contraction_hierarchy.h"
+#include "../src/customizable_hierarchy.h"
+#include "../src/phast.h"
+#include "../src/route_model.h"
+#include "map_test.h"
+
+
+class CustomizableHierarchyTest : public MapTest {
+  protected:
+    // travel times with traffic: each road is slowed down by a random factor, the same both ways
+    std::vector<float> TrafficWeights(unsigned seed) {
+        std::vector<float> weights = model->EdgeWeights(RouteModel::Car, RouteModel::Time);
+        for (int node = 0; node + 1 < (int)model->FirstEdge().size(); node++)
+            for (int e = model->FirstEdge()[node]; e < model->FirstEdge()[node + 1]; e++) {
+                const std::uint64_t road = std::uint64_t(std::min(node, model->EdgeTo()[e])) * 1000003u + std::max(node, model->EdgeTo()[e]);
+                std::mt19937 rng{unsigned(road * 7919u + seed)};
+                weights[e] *= std::uniform_real_distribution<float>{1.f, 4.f}(rng);
+            }
+        return weights;
+    }
+};
+
+// Queries on a customized hierarchy find the costs Dijkstra finds, before and after a traffic update,
+// and unpacked paths follow the roads.
+TEST_F(CustomizableHierarchyTest, TestCustomizedQueries) {
+    CustomizableHierarchy cch{*model};
+    EXPECT_GT(cch.NumLevels(), 1);
+    EXPECT_GT(cch.NumShortcuts(), 0);
+    auto nodes = RandomNodes(20, 11);
+    for (unsigned seed : {0u, 1u, 2u}) {
+        const auto weights = seed == 0 ? model->EdgeWeights(RouteModel::Car, RouteModel::Time) : TrafficWeights(seed);
+        auto hierarchy = cch.Customize(weights, RouteModel::Time);
+        ContractionQuery query{*hierarchy};
+        for (int i = 0; i + 1 < (int)nodes.size(); i += 2) {
+            const auto expected = Dijkstra(nodes[i], weights);
+            const float cost = query.Cost(nodes[i], nodes[i + 1]);
+            EXPECT_NEAR(cost, expected[nodes[i + 1]], 1e-4f * cost);
+            auto &path = query.Path();
+            ASSERT_FALSE(path.empty());
+            EXPECT_EQ(path.front(), nodes[i]);
+            EXPECT_EQ(path.back(), nodes[i + 1]);
+            ASSERT_TRUE(FollowsRoads(path));
+            EXPECT_NEAR(PathCost(path, weights), cost, 1e-4f * cost);
+        }
+
+        // PHAST works on it too, and unreachable nodes stay unreachable
+        Phast phast{*hierarchy};
+        const auto costs = phast.Costs(nodes[0]);
+        const auto expected = Dijkstra(nodes[0], weights);
+        for (std::size_t node = 0; node < costs.size(); node++)
+            if (expected[node] == ContractionHierarchy::Infinity)
+                EXPECT_EQ(costs[node], ContractionHierarchy::Infinity);
+            else
+                EXPECT_NEAR(costs[node], expected[node], 1e-4f * expected[node] + 1e-4f);
+    }
+}
+
+// The customization gives the same weights on one thread as on many, and a published hierarchy replaces
+// the current one without changing the one a query already holds.
+TEST_F(CustomizableHierarchyTest, TestParallelCustomizationAndSwap) {
+    CustomizableHierarchy cch{*model};
+    EXPECT_EQ(cch.Current(), nullptr);
+    const auto weights = TrafficWeights(5);
+    // the levels of this small map are short, so a low threshold makes several of them run in parallel
+    cch.SetParallelLevelSize(16);
+    EXPECT_EQ(cch.NumParallelLevels(1), 0);
+    EXPECT_GT(cch.NumParallelLevels(4), 1);
+    auto serial = cch.Customize(weights, RouteModel::Time, 1);
+    auto parallel = cch.Customize(weights, RouteModel::Time, 4);
+    ASSERT_EQ(serial->UpEdges().size(), parallel->UpEdges().size());
+    for (std::size_t k = 0; k < serial->UpEdges().size(); k++) {
+        EXPECT_EQ(serial->UpEdges()[k].to, parallel->UpEdges()[k].to);
+        EXPECT_EQ(serial->UpEdges()[k].weight, parallel->UpEdges()[k].weight);
+    }
+
+    cch.Publish(cch.Customize(RouteModel::Time));
+    auto held = cch.Current();
+    ASSERT_NE(held, nullptr);
+    auto nodes = RandomNodes(2, 11);
+    ContractionQuery before{*held};
+    const float free_flow = before.Cost(nodes[0], nodes[1]);
+
+    cch.Publish(parallel);
+    EXPECT_EQ(cch.Current(), parallel);
+    ContractionQuery after{*cch.Current()};
+    EXPECT_GT(after.Cost(nodes[0], nodes[1]), free_flow);
+    EXPECT_FLOAT_EQ(before.Cost(nodes[0], nodes[1]), free_flow);
+}
@@ -0,0 +1,70 @@
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <vector>
+#include "../src/facility_search.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+#include "map_test.h"
+
+
+class FacilitySearchTest : public MapTest {};
+
+// The amenities of the map are loaded and grouped by kind.
+TEST_F(FacilitySearchTest, TestPoiTable) {
+    auto &pois = model->Pois();
+    ASSERT_GT(pois.size(), 100);
+    const int parking = model->AmenityKind("parking");
+    ASSERT_GE(parking, 0);
+    EXPECT_EQ(model->AmenityKinds()[parking], "parking");
+    EXPECT_EQ(model->AmenityKind("no such amenity"), -1);
+    ASSERT_EQ(model->FirstPoi().size(), model->AmenityKinds().size() + 1);
+    EXPECT_EQ(model->FirstPoi().back(), (int)pois.size());
+    for (int kind = 0; kind < (int)model->AmenityKinds().size(); kind++)
+        for (int i = model->FirstPoi()[kind]; i < model->FirstPoi()[kind + 1]; i++)
+            EXPECT_EQ(pois[i].kind, kind);
+    for (auto &poi : pois) {
+        // in the map, give or take the size of a building at the edge
+        EXPECT_GT(poi.position.x, -0.1);
+        EXPECT_GT(poi.position.y, -0.1);
+        EXPECT_LT(poi.position.x, 1.5);
+        EXPECT_LT(poi.position.y, 1.5);
+        EXPECT_LT(poi.name, (int)model->PoiNames().size());
+    }
+}
+
+// The k nearest facilities are the first k of the costs found by a separate search to each of them.
+TEST_F(FacilitySearchTest, TestNearestMatchesSeparateSearches) {
+    FacilitySearch search{*model};
+    RoutePlanner planner{*model};
+    const int parking = model->AmenityKind("parking");
+    const float scale = static_cast<float>(model->MetricScale());
+    const float starts[][2] = {{10, 10}, {50, 50}, {90, 20}};
+    for (auto &start : starts) {
+        const int source = search.Snap(start[0], start[1]);
+        auto found = search.Nearest(source, 5, parking);
+        ASSERT_EQ(found.size(), 5);
+
+        std::vector<float> costs;
+        for (int i = model->FirstPoi()[parking]; i < model->FirstPoi()[parking + 1]; i++) {
+            const int node = model->FindClosestNode(model->Pois()[i].position.x, model->Pois()[i].position.y, RouteModel::Car, true).Index();
+            planner.SetEndpoints(source, node);
+            ASSERT_TRUE(planner.Search());
+            costs.push_back(planner.Context().G(node) * scale);
+        }
+        std::sort(costs.begin(), costs.end());
+        for (std::size_t i = 0; i < found.size(); i++) {
+            EXPECT_EQ(model->Pois()[found[i].poi].kind, parking);
+            EXPECT_NEAR(found[i].cost, costs[i], 1e-3f * costs[i] + 1e-3f);
+            auto path = search.Path(found[i]);
+            EXPECT_EQ(path.front(), source);
+            EXPECT_EQ(path.back(), found[i].node);
+            EXPECT_GE(found[i].distance, 0.f);
+        }
+    }
+
+    // without a kind any amenity counts, and asking for more than exist returns them all
+    const int source = search.Snap(50, 50);
+    EXPECT_EQ(search.Nearest(source, 3).size(), 3);
+    const int n_parking = model->FirstPoi()[parking + 1] - model->FirstPoi()[parking];
+    EXPECT_EQ(search.Nearest(source, 1000, parking).size(), n_parking);
+}
@@ -0,0 +1,87 @@
+#include "gtest/gtest.h"
+#include <vector>
+#include "../src/isochrone.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+#include "map_test.h"
+
+
+class IsochroneTest : public MapTest {};
+
+// twice the signed area of the ring; positive if it runs counter-clockwise
+static double SignedArea(const Isochrone::Ring &ring) {
+    double area = 0.;
+    for (std::size_t i = 0; i < ring.size(); i++) {
+        const auto &a = ring[i], &b = ring[(i + 1) % ring.size()];
+        area += a.x * b.y - b.x * a.y;
+    }
+    return area;
+}
+
+static bool Inside(const Isochrone::Ring &ring, const Model::Node &p) {
+    bool inside = false;
+    for (std::size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++)
+        if ((ring[i].y > p.y) != (ring[j].y > p.y) &&
+            p.x < (ring[j].x - ring[i].x) * (p.y - ring[i].y) / (ring[j].y - ring[i].y) + ring[i].x)
+            inside = !inside;
+    return inside;
+}
+
+// The nodes are settled in order of cost within the budget, and their costs are those of the fastest routes.
+TEST_F(IsochroneTest, TestReachedCosts) {
+    IsochroneSearch search{*model, RouteModel::Car, RouteModel::Time};
+    const int source = search.Snap(50.f, 50.f);
+    const float budget = 60.f;
+    auto reached = search.Search(source, budget);
+    ASSERT_GT(reached.size(), 10);
+    EXPECT_EQ(reached.front().node, source);
+    EXPECT_EQ(reached.front().cost, 0.f);
+    for (std::size_t i = 1; i < reached.size(); i++) {
+        EXPECT_LE(reached[i - 1].cost, reached[i].cost);
+        EXPECT_LE(reached[i].cost, budget);
+    }
+
+    RoutePlanner planner{*model, RouteModel::Car, RouteModel::Time};
+    for (std::size_t i = 0; i < reached.size(); i += reached.size() / 10) {
+        planner.SetEndpoints(source, reached[i].node);
+        ASSERT_TRUE(planner.Search());
+        EXPECT_NEAR(planner.GetDuration(), reached[i].cost, 1e-3f * budget);
+    }
+    // a larger budget reaches more
+    EXPECT_GT(search.Search(source, 2 * budget).size(), reached.size());
+}
+
+// The area is made of counter-clockwise outlines that contain the reached nodes.
+TEST_F(IsochroneTest, TestArea) {
+    IsochroneSearch search{*model, RouteModel::Pedestrian, RouteModel::Distance};
+    auto isochrone = search.Compute(search.Snap(50.f, 50.f), 300.f, 0.005f);
+    ASSERT_FALSE(isochrone.area.empty());
+    for (auto &ring : isochrone.area) {
+        EXPECT_GE(ring.size(), 4);
+        EXPECT_GT(SignedArea(ring), 0.);
+    }
+    for (auto &reached : isochrone.reached) {
+        int containing = 0;
+        for (auto &ring : isochrone.area)
+            containing += Inside(ring, model->Nodes()[reached.node]);
+        EXPECT_EQ(containing, 1);
+    }
+}
+
+// Isochrones computed in parallel are the same as computed one by one.
+TEST_F(IsochroneTest, TestParallel) {
+    IsochroneSearch search{*model};
+    std::vector<int> sources;
+    for (int i = 1; i <= 8; i++)
+        sources.push_back(search.Snap(10.f * i, 100.f - 10.f * i));
+    auto isochrones = ComputeIsochrones(*model, RouteModel::Car, RouteModel::Distance, sources, 400.f, 0.01f, 4);
+    ASSERT_EQ(isochrones.size(), sources.size());
+    for (std::size_t i = 0; i < sources.size(); i++) {
+        auto expected = search.Compute(sources[i], 400.f, 0.01f);
+        EXPECT_EQ(isochrones[i].source, sources[i]);
+        ASSERT_EQ(isochrones[i].reached.size(), expected.reached.size());
+        for (std::size_t k = 0; k < expected.reached.size(); k++)
+            EXPECT_EQ(isochrones[i].reached[k].node, expected.reached[k].node);
+        EXPECT_EQ(isochrones[i].area.size(), expected.area.size());
+    }
+}
@@ -0,0 +1,64 @@
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include "../src/multi_stop.h"
+#include "../src/route_model.h"
+#include "map_test.h"
+
+
+class MultiStopTest : public MapTest {
+  protected:
+    const std::vector<std::pair<float, float>> stops{{10, 10}, {90, 90}, {20, 80}, {50, 50}, {85, 15}, {30, 40}, {70, 60}, {15, 55}};
+};
+
+// The order visits every stop once starting with the first, and the path follows the roads through
+// the stops in that order.
+TEST_F(MultiStopTest, TestRouteThroughStops) {
+    MultiStopPlanner planner{*model};
+    planner.SetStops(stops);
+    auto result = planner.Plan();
+    ASSERT_TRUE(result.found);
+    ASSERT_EQ(result.order.size(), stops.size());
+    EXPECT_EQ(result.order[0], 0);
+    auto sorted = result.order;
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<int> all(stops.size());
+    std::iota(all.begin(), all.end(), 0);
+    EXPECT_EQ(sorted, all);
+
+    ASSERT_EQ(result.legs.size(), stops.size());
+    for (std::size_t k = 0; k < result.order.size(); k++)
+        EXPECT_EQ(result.path[result.legs[k]], planner.Stops()[result.order[k]]);
+    ASSERT_TRUE(FollowsRoads(result.path));
+    EXPECT_GT(result.distance, 0.f);
+    EXPECT_GT(result.duration, 0.f);
+
+    // the local search does not make the order worse than visiting the stops as given
+    EXPECT_LE(planner.OrderCost(result.order, false), planner.OrderCost(all, false) * 1.0001f);
+}
+
+// A round trip ends at the first stop, and the result does not depend on the number of threads.
+TEST_F(MultiStopTest, TestRoundTrip) {
+    MultiStopPlanner planner{*model};
+    planner.SetStops(stops);
+    MultiStopPlanner::Options options;
+    options.round_trip = true;
+    options.n_threads = 1;
+    auto single = planner.Plan(options);
+    ASSERT_TRUE(single.found);
+    EXPECT_EQ(single.path.front(), single.path.back());
+    EXPECT_EQ(single.legs.size(), stops.size() + 1);
+    EXPECT_EQ(single.legs.back(), (int)single.path.size() - 1);
+
+    options.n_threads = 4;
+    auto parallel = planner.Plan(options);
+    EXPECT_EQ(parallel.order, single.order);
+    EXPECT_EQ(parallel.path, single.path);
+    EXPECT_FLOAT_EQ(parallel.cost, single.cost);
+
+    // the matrix is symmetric, since roads can be used both ways
+    for (int a = 0; a < (int)stops.size(); a++)
+        for (int b = 0; b < a; b++)
+            EXPECT_NEAR(planner.Cost(a, b), planner.Cost(b, a), 1e-4f * planner.Cost(a, b));
+}
@@ -0,0 +1,145 @@
+#include "gtest/gtest.h"
+#include <map>
+#include <string>
+#include <vector>
+#include "../src/model.h"
+#include "../src/mvt.h"
+#include "../src/utility_route_model.h"
+
+// Just enough of a protocol buffers reader to check the encoded tiles.
+struct PbfReader {
+    const std::string &data;
+    std::size_t pos = 0;
+    std::size_t end;
+    PbfReader(const std::string &d, std::size_t begin, std::size_t finish) : data(d), pos(begin), end(finish) {}
+
+    bool Done() const { return pos >= end; }
+    std::uint64_t Varint() {
+        std::uint64_t value = 0;
+        for (int shift = 0;; shift += 7) {
+            auto byte = static_cast<unsigned char>(data.at(pos++));
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+    }
+    // the field number; wire type and payload bounds are returned through the arguments
+    int Field(int &wire_type, std::size_t &begin, std::size_t &finish) {
+        auto key = Varint();
+        wire_type = key & 7;
+        if (wire_type == 2) {
+            auto length = Varint();
+            begin = pos;
+            finish = pos += length;
+        } else {
+            begin = finish = pos;
+            Varint();
+        }
+        return static_cast<int>(key >> 3);
+    }
+};
+
+static std::int32_t UnZigZag(std::uint32_t value) { return static_cast<std::int32_t>(value >> 1) ^ -static_cast<std::int32_t>(value & 1); }
+
+
+TEST(MvtTest, TestPbfEncoding) {
+    PbfWriter writer;
+    writer.Varint(300);
+    EXPECT_EQ(writer.Data(), std::string("\xAC\x02"));
+    writer.Clear();
+    writer.UInt(15, 2);
+    EXPECT_EQ(writer.Data(), std::string("\x78\x02"));
+    EXPECT_EQ(PbfWriter::ZigZag(0), 0u);
+    EXPECT_EQ(PbfWriter::ZigZag(-1), 1u);
+    EXPECT_EQ(PbfWriter::ZigZag(1), 2u);
+    EXPECT_EQ(PbfWriter::ZigZag(-2), 3u);
+}
+
+// A tile in the middle of the map has the model layers, with valid geometry inside the buffered extent
+// and outer polygon rings that are clockwise on screen.
+TEST(MvtTest, TestEncodeTile) {
+    auto osm_data = ReadFile("../map.osm");
+    ASSERT_TRUE(osm_data);
+    Model model{*osm_data};
+    MvtExporter exporter{model};
+
+    const int z = 16;
+    const double n = std::ldexp(1., z);
+    TileId tile{z, (int)(model.WorldX(0.5) * n), (int)(model.WorldY(0.5) * n)};
+    auto data = exporter.EncodeTile(tile);
+    ASSERT_FALSE(data.empty());
+    EXPECT_TRUE(exporter.EncodeTile({z, 0, 0}).empty());
+
+    std::map<std::string, int> features_per_layer;
+    PbfReader tile_reader{data, 0, data.size()};
+    while (!tile_reader.Done()) {
+        int wire_type;
+        std::size_t layer_begin, layer_end;
+        ASSERT_EQ(tile_reader.Field(wire_type, layer_begin, layer_end), 3);
+        std::string name;
+        int extent = 0, version = 0, n_features = 0;
+        PbfReader layer{data, layer_begin, layer_end};
+        while (!layer.Done()) {
+            std::size_t begin, end;
+            int field = layer.Field(wire_type, begin, end);
+            if (field == 1)
+                name = data.substr(begin, end - begin);
+            else if (field == 5)
+                extent = (int)PbfReader{data, begin, end + 8}.Varint();
+            else if (field == 15)
+                version = (int)PbfReader{data, begin, end + 8}.Varint();
+            else if (field == 2) {
+                ++n_features;
+                int type = 0;
+                std::vector<std::uint32_t> geometry;
+                PbfReader feature{data, begin, end};
+                while (!feature.Done()) {
+                    std::size_t fb, fe;
+                    int ff = feature.Field(wire_type, fb, fe);
+                    if (ff == 3)
+                        type = (int)PbfReader{data, fb, fe + 8}.Varint();
+                    else if (ff == 4)
+                        for (PbfReader packed{data, fb, fe}; !packed.Done();)
+                            geometry.push_back((std::uint32_t)packed.Varint());
+                }
+                ASSERT_TRUE(type == 2 || type == 3);
+                // walk the commands; check the coordinates and the winding of the first ring
+                int x = 0, y = 0;
+                bool first_ring = true;
+                std::vector<std::pair<int, int>> ring;
+                for (std::size_t i = 0; i < geometry.size();) {
+                    int command = geometry[i] & 7, count = geometry[i] >> 3;
+                    ++i;
+                    if (command == 7) {
+                        ASSERT_EQ(type, 3);
+                        long long area = 0;
+                        for (std::size_t a = 0, b = ring.size() - 1; a < ring.size(); b = a++)
+                            area += (long long)ring[b].first * ring[a].second - (long long)ring[a].first * ring[b].second;
+                        if (first_ring) {
+                            EXPECT_GT(area, 0);
+                        }
+                        first_ring = false;
+                        continue;
+                    }
+                    ASSERT_TRUE(command == 1 || command == 2);
+                    if (command == 1)
+                        ring.clear();
+                    for (int c = 0; c < count; ++c, i += 2) {
+                        x += UnZigZag(geometry.at(i));
+                        y += UnZigZag(geometry.at(i + 1));
+                        EXPECT_GE(x, -MvtExporter::Buffer - 1);
+                        EXPECT_LE(x, MvtExporter::Extent + MvtExporter::Buffer + 1);
+                        EXPECT_GE(y, -MvtExporter::Buffer - 1);
+                        EXPECT_LE(y, MvtExporter::Extent + MvtExporter::Buffer + 1);
+                        ring.emplace_back(x, y);
+                    }
+                }
+            }
+        }
+        EXPECT_EQ(extent, MvtExporter::Extent);
+        EXPECT_EQ(version, 2);
+        features_per_layer[name] = n_features;
+    }
+    EXPECT_GT(features_per_layer["roads"], 0);
+    EXPECT_GT(features_per_layer["buildings"], 0);
+}
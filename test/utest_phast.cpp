@@ -0,0 +1,58 @@
+#include "gtest/gtest.h"
+#include <cmath>
+#include <vector>
+#include "../src/contraction_hierarchy.h"
+#include "../src/phast.h"
+#include "../src/route_model.h"
+#include "map_test.h"
+
+
+class PhastTest : public MapTest {
+  protected:
+    // the costs from the source by Dijkstra over the road graph
+    std::vector<float> Dijkstra(int source) {
+        return MapTest::Dijkstra(source, model->EdgeWeights(RouteModel::Car, RouteModel::Time));
+    }
+};
+
+// Queries on the hierarchy find routes as good as Dijkstra's, and their unpacked paths follow the roads.
+TEST_F(PhastTest, TestContractionQuery) {
+    ContractionHierarchy hierarchy{*model, RouteModel::Car, RouteModel::Time};
+    EXPECT_GT(hierarchy.NumShortcuts(), 0);
+    ContractionQuery query{hierarchy};
+    auto nodes = RandomNodes(20, 7);
+    for (int i = 0; i + 1 < (int)nodes.size(); i += 2) {
+        auto expected = Dijkstra(nodes[i]);
+        const float cost = query.Cost(nodes[i], nodes[i + 1]);
+        EXPECT_NEAR(cost, expected[nodes[i + 1]], 1e-4f * cost);
+
+        auto &path = query.Path();
+        ASSERT_FALSE(path.empty());
+        EXPECT_EQ(path.front(), nodes[i]);
+        EXPECT_EQ(path.back(), nodes[i + 1]);
+        // every step is a road the profile may use, and the steps add up to the cost
+        ASSERT_TRUE(FollowsRoads(path));
+        EXPECT_NEAR(PathCost(path, model->EdgeWeights(RouteModel::Car, RouteModel::Time)), cost, 1e-4f * cost);
+    }
+}
+
+// PHAST gives the same costs to all nodes as Dijkstra, for one source and for more sources than lanes.
+TEST_F(PhastTest, TestOneToAll) {
+    ContractionHierarchy hierarchy{*model, RouteModel::Car, RouteModel::Time};
+    Phast phast{hierarchy};
+    auto sources = RandomNodes(Phast::Lanes + 3, 7);
+    auto all = phast.Costs(sources);
+    ASSERT_EQ(all.size(), sources.size());
+    for (std::size_t i = 0; i < sources.size(); i++) {
+        auto expected = Dijkstra(sources[i]);
+        const auto costs = i == 0 ? phast.Costs(sources[0]) : all[i];
+        ASSERT_EQ(costs.size(), expected.size());
+        int mismatches = 0;
+        for (std::size_t node = 0; node < costs.size(); node++)
+            if (expected[node] == ContractionHierarchy::Infinity ? costs[node] != expected[node]
+                                                                : std::abs(costs[node] - expected[node]) > 1e-4f * expected[node] + 1e-4f)
+                mismatches++;
+        EXPECT_EQ(mismatches, 0);
+        EXPECT_EQ(costs[sources[i]], 0.f);
+    }
+}
@@ -0,0 +1,31 @@
+#include "gtest/gtest.h"
+#include "../src/render_profiler.h"
+
+
+TEST(RenderProfilerTest, TestRollingPercentiles) {
+    RenderProfiler profiler{10};
+    EXPECT_EQ(profiler.Percentile(RenderProfiler::Highways, 50), 0.);
+
+    for (int i = 1; i <= 10; i++)
+        profiler.Record(RenderProfiler::Highways, i);
+    EXPECT_EQ(profiler.Samples(RenderProfiler::Highways), 10);
+    EXPECT_EQ(profiler.Percentile(RenderProfiler::Highways, 50), 5.);
+    EXPECT_EQ(profiler.Percentile(RenderProfiler::Highways, 90), 9.);
+    EXPECT_EQ(profiler.Percentile(RenderProfiler::Highways, 100), 10.);
+    EXPECT_EQ(profiler.Last(RenderProfiler::Highways), 10.);
+
+    // only the last 10 samples are kept: 6 to 15
+    for (int i = 11; i <= 15; i++)
+        profiler.Record(RenderProfiler::Highways, i);
+    EXPECT_EQ(profiler.Samples(RenderProfiler::Highways), 10);
+    EXPECT_EQ(profiler.Percentile(RenderProfiler::Highways, 0), 6.);
+    EXPECT_EQ(profiler.Percentile(RenderProfiler::Highways, 50), 10.);
+    EXPECT_EQ(profiler.Last(RenderProfiler::Highways), 15.);
+    EXPECT_EQ(profiler.Samples(RenderProfiler::Water), 0);
+
+    {
+        RenderProfiler::Timer timer{&profiler, RenderProfiler::Water};
+    }
+    EXPECT_EQ(profiler.Samples(RenderProfiler::Water), 1);
+    EXPECT_GE(profiler.Last(RenderProfiler::Water), 0.);
+}
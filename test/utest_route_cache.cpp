@@ -0,0 +1,78 @@
+#include "gtest/gtest.h"
+#include <thread>
+#include <vector>
+#include "../src/route_cache.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+#include "map_test.h"
+
+
+class RouteCacheTest : public MapTest {};
+
+// The least recently used entry is evicted first, and a hit makes an entry the most recently used.
+TEST_F(RouteCacheTest, TestEviction) {
+    // one shard with room for three entries with paths of 4 nodes
+    RouteCache cache{*model, 3 * (128 + 4 * sizeof(int)), 1};
+    auto key = [](int i) { return RouteCache::Key{i, i + 1, RouteModel::Car, RouteModel::Distance}; };
+    for (int i = 0; i < 3; i++)
+        cache.Insert(key(i), model->Version(), {{i, 1, 2, 3}, float(i), 0.f});
+    EXPECT_EQ(cache.Size(), 3);
+    ASSERT_NE(cache.Find(key(0)), nullptr);
+    cache.Insert(key(3), model->Version(), {{3, 1, 2, 3}, 3.f, 0.f});
+    EXPECT_EQ(cache.Size(), 3);
+    EXPECT_EQ(cache.Evictions(), 1);
+    EXPECT_EQ(cache.Find(key(1)), nullptr);
+    auto route = cache.Find(key(0));
+    ASSERT_NE(route, nullptr);
+    EXPECT_EQ(route->path, (std::vector<int>{0, 1, 2, 3}));
+    EXPECT_EQ(cache.Hits(), 2);
+    EXPECT_EQ(cache.Misses(), 1);
+    // the profile and the metric are part of the key
+    EXPECT_EQ(cache.Find({0, 1, RouteModel::Pedestrian, RouteModel::Distance}), nullptr);
+    EXPECT_EQ(cache.Find({0, 1, RouteModel::Car, RouteModel::Time}), nullptr);
+}
+
+// Changing the edge weights drops the cached routes, and routes computed before the change are not stored.
+TEST_F(RouteCacheTest, TestInvalidation) {
+    RouteCache cache{*model};
+    const RouteCache::Key key{1, 2, RouteModel::Car, RouteModel::Time};
+    const auto version = model->Version();
+    cache.Insert(key, version, {{1, 2}, 1.f, 1.f});
+    ASSERT_NE(cache.Find(key), nullptr);
+    model->SetSpeed(RouteModel::Car, Model::Road::Motorway, 50.f);
+    EXPECT_EQ(cache.Find(key), nullptr);
+    cache.Insert(key, version, {{1, 2}, 1.f, 1.f});
+    EXPECT_EQ(cache.Find(key), nullptr);
+    cache.Insert(key, model->Version(), {{1, 2}, 1.f, 1.f});
+    EXPECT_NE(cache.Find(key), nullptr);
+}
+
+// Threads that share the cache get the same routes as their own searches.
+TEST_F(RouteCacheTest, TestConcurrentUse) {
+    RouteCache cache{*model, 1 << 20, 4};
+    std::vector<std::thread> threads;
+    std::vector<int> mismatches(4, 0);
+    for (int t = 0; t < 4; t++)
+        threads.emplace_back([&, t] {
+            RoutePlanner planner{*model};
+            for (int i = 0; i < 200; i++) {
+                // few distinct queries, so most of them are hits
+                const float x = 10.f + 10.f * ((i + t) % 8);
+                planner.SetEndpoints(x, 10.f, 90.f, x);
+                const RouteCache::Key key{planner.StartNode(), planner.EndNode(), RouteModel::Car, RouteModel::Distance};
+                auto route = cache.Find(key);
+                planner.Search();
+                if (route && (route->path != planner.GetPath() || route->distance != planner.GetDistance()))
+                    mismatches[t]++;
+                if (!route)
+                    cache.Insert(key, model->Version(), {planner.GetPath(), planner.GetDistance(), planner.GetDuration()});
+            }
+        });
+    for (auto &thread : threads)
+        thread.join();
+    for (int t = 0; t < 4; t++)
+        EXPECT_EQ(mismatches[t], 0);
+    EXPECT_EQ(cache.Hits() + cache.Misses(), 800);
+    EXPECT_GE(cache.Hits(), 800 - 4 * 8);
+    EXPECT_LE(cache.Size(), 8);
+}
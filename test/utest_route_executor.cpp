@@ -0,0 +1,103 @@
+#include "gtest/gtest.h"
+#include <atomic>
+#include <future>
+#include <vector>
+#include "../src/route_executor.h"
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+#include "../src/search_monitor.h"
+#include "map_test.h"
+
+
+class RouteExecutorTest : public MapTest {
+  protected:
+    static RouteRequest Request(float start_x, float start_y, float end_x, float end_y) {
+        RouteRequest request;
+        request.start_x = start_x;
+        request.start_y = start_y;
+        request.end_x = end_x;
+        request.end_y = end_y;
+        return request;
+    }
+};
+
+// A monitor sees the progress of a search and stops it at the next check once cancelled.
+TEST_F(RouteExecutorTest, TestSearchMonitor) {
+    RoutePlanner planner{*model};
+    planner.SetEndpoints(10, 10, 90, 90);
+    SearchMonitor monitor{16};
+    planner.SetMonitor(&monitor);
+    ASSERT_TRUE(planner.Search());
+    EXPECT_GT(monitor.Settled(), 16);
+    EXPECT_FLOAT_EQ(monitor.Progress(), 1.0f);
+    // a cancel after the search has ended did not stop it
+    monitor.Cancel();
+    EXPECT_FALSE(planner.Cancelled());
+
+    SearchMonitor cancelled{16};
+    cancelled.Cancel();
+    planner.SetMonitor(&cancelled);
+    EXPECT_FALSE(planner.Search());
+    EXPECT_TRUE(planner.Cancelled());
+    EXPECT_EQ(cancelled.Settled(), 16);
+    planner.SetMonitor(nullptr);
+}
+
+// Many queries in flight on a few threads give the same routes as a planner, and each callback runs once.
+TEST_F(RouteExecutorTest, TestManyQueries) {
+    RouteExecutor executor{*model, 4};
+    std::vector<RouteFuture> futures;
+    std::atomic<int> callbacks{0};
+    for (int i = 0; i < 200; i++) {
+        const float t = (i % 20) * 4.f;
+        futures.push_back(executor.Submit(Request(10 + t, 10, 90 - t, 90)));
+        futures.back().Then([&](const RouteResult &) { ++callbacks; });
+    }
+    RoutePlanner planner{*model};
+    for (int i = 0; i < 200; i++) {
+        const float t = (i % 20) * 4.f;
+        planner.SetEndpoints(10 + t, 10, 90 - t, 90);
+        const bool found = planner.Search();
+        auto &result = futures[i].Get();
+        EXPECT_TRUE(futures[i].Ready());
+        EXPECT_FALSE(result.cancelled);
+        EXPECT_EQ(result.found, found);
+        EXPECT_EQ(result.path, planner.GetPath());
+        EXPECT_FLOAT_EQ(result.distance, planner.GetDistance());
+    }
+    // the callbacks run after the results are stored, so the last ones may still be running
+    while (callbacks < 200)
+        std::this_thread::yield();
+    EXPECT_EQ(callbacks, 200);
+
+    // a callback set after the query is done runs at once
+    bool called = false;
+    futures[0].Then([&](const RouteResult &result) { called = result.found; });
+    EXPECT_TRUE(called);
+}
+
+// Queued queries that are cancelled finish without a route, and the others are not affected.
+TEST_F(RouteExecutorTest, TestCancel) {
+    RouteExecutor executor{*model, 1};
+    // hold the only worker in the callback of the first query, so that the others stay queued
+    std::promise<void> release;
+    auto held = release.get_future().share();
+    auto first = executor.Submit(Request(10, 10, 90, 90));
+    first.Then([held](const RouteResult &) { held.wait(); });
+    std::vector<RouteFuture> queued;
+    for (int i = 0; i < 10; i++)
+        queued.push_back(executor.Submit(Request(10, 10, 90, 90)));
+    for (int i = 0; i < 10; i += 2)
+        queued[i].Cancel();
+    release.set_value();
+
+    EXPECT_TRUE(first.Get().found);
+    for (int i = 0; i < 10; i++) {
+        auto &result = queued[i].Get();
+        EXPECT_EQ(result.cancelled, i % 2 == 0);
+        EXPECT_EQ(result.found, i % 2 == 1);
+        EXPECT_EQ(result.path.empty(), i % 2 == 0);
+    }
+    EXPECT_EQ(executor.Queued(), 0);
+    EXPECT_TRUE(queued[0].WaitFor(std::chrono::milliseconds(0)));
+}
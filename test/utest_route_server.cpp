@@ -0,0 +1,109 @@
+#include "gtest/gtest.h"
+#include <string>
+#include <cstring>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "../src/route_model.h"
+#include "../src/route_protocol.h"
+#include "../src/route_server.h"
+#include "../src/utility_route_model.h"
+
+
+TEST(RouteProtocolTest, TestParseRequest) {
+    RouteRequest request;
+    EXPECT_EQ(ParseRouteRequest(R"({"id": "a\"b", "start": [10, 20.5], "end": [90,90], "profile": "pedestrian", "metric": "time", "path": false, "extra": {"x": [1, 2]}})", request), "");
+    EXPECT_EQ(request.id, R"("a\"b")");
+    EXPECT_FLOAT_EQ(request.start_x, 10.f);
+    EXPECT_FLOAT_EQ(request.start_y, 20.5f);
+    EXPECT_FLOAT_EQ(request.end_x, 90.f);
+    EXPECT_EQ(request.profile, RouteModel::Pedestrian);
+    EXPECT_EQ(request.metric, RouteModel::Time);
+    EXPECT_FALSE(request.with_path);
+
+    EXPECT_EQ(ParseRouteRequest(R"({"id": 7, "start": [1, 2], "end": [3, 4]})", request), "");
+    EXPECT_EQ(request.id, "7");
+    EXPECT_EQ(request.profile, RouteModel::Car);
+    EXPECT_TRUE(request.with_path);
+
+    EXPECT_NE(ParseRouteRequest(R"({"id": 7, "start": [1, 2]})", request), "");
+    EXPECT_EQ(request.id, "7");
+    // ids are echoed as written, so only JSON numbers are taken
+    EXPECT_EQ(ParseRouteRequest(R"({"id": -1.5e3, "start": [1, 2], "end": [3, 4]})", request), "");
+    EXPECT_EQ(request.id, "-1.5e3");
+    for (const char *id : {"inf", "-inf", "nan", "-nan", "1.", ".5", "1e", "+1"}) {
+        EXPECT_NE(ParseRouteRequest(std::string(R"({"id": )") + id + R"(, "start": [1, 2], "end": [3, 4]})", request), "") << id;
+        EXPECT_EQ(request.id, "null") << id;
+    }
+    // only the 0 of a hexadecimal number is a JSON number, and the rest is not valid JSON
+    EXPECT_NE(ParseRouteRequest(R"({"id": 0x10, "start": [1, 2], "end": [3, 4]})", request), "");
+    EXPECT_EQ(request.id, "0");
+    EXPECT_NE(ParseRouteRequest(R"({"start": [1, 2], "end": [3, 4], "profile": "bike"})", request), "");
+    EXPECT_NE(ParseRouteRequest("not json", request), "");
+    // numbers out of range of a float, and points off the map, can not be snapped
+    EXPECT_NE(ParseRouteRequest(R"({"start": [1e39, 10], "end": [90, 90]})", request), "");
+    EXPECT_NE(ParseRouteRequest(R"({"start": [-1e39, 10], "end": [90, 90]})", request), "");
+    EXPECT_NE(ParseRouteRequest(R"({"start": [10, 10], "end": [90, 1e39]})", request), "");
+    EXPECT_NE(ParseRouteRequest(R"({"start": [10, 10], "end": [100.5, 90]})", request), "");
+    EXPECT_EQ(ParseRouteRequest(R"({"start": [0, 0], "end": [100, 100]})", request), "");
+    EXPECT_EQ(FormatErrorResponse("null", "bad \"x\""), R"({"id": null, "error": "bad \"x\""})");
+}
+
+// Pipelined requests on one connection are answered in order, and Stop() drains the server.
+TEST(RouteServerTest, TestPipelinedRequests) {
+    auto osm_data = ReadFile("../map.osm");
+    ASSERT_TRUE(osm_data);
+    RouteModel model{*osm_data};
+    const std::string path = "/tmp/route_server_test_" + std::to_string(getpid()) + ".sock";
+    RouteServer server{model, {path, 0, 4}};
+    bool ran = false;
+    std::thread server_thread{[&] { ran = server.Run(); }};
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path.c_str());
+    bool connected = false;
+    for (int attempt = 0; attempt < 200 && !connected; attempt++) {
+        connected = connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof address) == 0;
+        if (!connected)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_TRUE(connected);
+
+    const int n_requests = 50;
+    std::string requests;
+    for (int i = 0; i < n_requests; i++)
+        requests += i == 10 ? "{\"id\": 10}\n"
+                            : "{\"id\": " + std::to_string(i) + ", \"start\": [10, 10], \"end\": [90, 90], \"path\": " + (i % 2 ? "true" : "false") + "}\n";
+    ASSERT_EQ(write(fd, requests.data(), requests.size()), (ssize_t)requests.size());
+    shutdown(fd, SHUT_WR);
+
+    std::string responses;
+    char chunk[4096];
+    for (ssize_t n; (n = read(fd, chunk, sizeof chunk)) > 0;)
+        responses.append(chunk, n);
+    close(fd);
+
+    std::size_t start = 0;
+    for (int i = 0; i < n_requests; i++) {
+        auto newline = responses.find('\n', start);
+        ASSERT_NE(newline, std::string::npos);
+        auto line = responses.substr(start, newline - start);
+        start = newline + 1;
+        EXPECT_EQ(line.find("{\"id\": " + std::to_string(i) + ","), 0u) << line;
+        if (i == 10)
+            EXPECT_NE(line.find("\"error\""), std::string::npos);
+        else {
+            EXPECT_NE(line.find("\"found\": true, \"distance\": 839.26"), std::string::npos) << line;
+            EXPECT_EQ(line.find("\"path\"") != std::string::npos, i % 2 == 1);
+        }
+    }
+    EXPECT_EQ(start, responses.size());
+
+    server.Stop();
+    server_thread.join();
+    EXPECT_TRUE(ran);
+    EXPECT_EQ(server.Answered(), (std::uint64_t)n_requests);
+}
@@ -1,7 +1,10 @@
 #include "gtest/gtest.h"
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <optional>
+#include <stdexcept>
 #include <vector>
 #include "../src/route_model.h"
 #include "../src/route_planner.h"
@@ -63,32 +66,34 @@ class RoutePlannerTest : public ::testing::Test {
 
 // Test the CalculateHValue method.
 TEST_F(RoutePlannerTest, TestCalculateHValue) {
-    EXPECT_FLOAT_EQ(route_planner.CalculateHValue(start_node), 1.1329799);
-    EXPECT_FLOAT_EQ(route_planner.CalculateHValue(end_node), 0.0f);
-    EXPECT_FLOAT_EQ(route_planner.CalculateHValue(mid_node), 0.58903033);
+    EXPECT_FLOAT_EQ(route_planner.CalculateHValue(start_node->Index()), 1.1329799);
+    EXPECT_FLOAT_EQ(route_planner.CalculateHValue(end_node->Index()), 0.0f);
+    EXPECT_FLOAT_EQ(route_planner.CalculateHValue(mid_node->Index()), 0.58903033);
 }
 
 
 
 // Test the AddNeighbors method.
-bool NodesSame(RouteModel::Node* a, RouteModel::Node* b) { return a == b; }
 TEST_F(RoutePlannerTest, TestAddNeighbors) {
-    route_planner.AddNeighbors(start_node);
+    route_planner.AddNeighbors(start_node->Index());
 
     // Correct h and g values for the neighbors of start_node.
     std::vector<float> start_neighbor_g_vals{ 0.051776856, 0.055291083, 0.082997195, 0.10671431 };
     std::vector<float> start_neighbor_h_vals{ 1.0858033, 1.1831238, 1.0998145, 1.1828455 };
-    auto neighbors = start_node->neighbors;
+    SearchContext &context = route_planner.Context();
+    std::vector<int> neighbors;
+    for (int e = model.FirstEdge()[start_node->Index()]; e < model.FirstEdge()[start_node->Index() + 1]; e++)
+        neighbors.push_back(model.EdgeTo()[e]);
     std::sort(std::begin(neighbors), std::end(neighbors),
-        [](RouteModel::Node* a, RouteModel::Node* b) { return a->g_value < b->g_value; });
+        [&](int a, int b) { return context.G(a) < context.G(b); });
     EXPECT_EQ(neighbors.size(), 4);
 
     // Check results for each neighbor.
     for (int i = 0; i < neighbors.size(); i++) {
-        EXPECT_PRED2(NodesSame, neighbors[i]->parent, start_node);
-        EXPECT_FLOAT_EQ(neighbors[i]->g_value, start_neighbor_g_vals[i]);
-        EXPECT_FLOAT_EQ(neighbors[i]->h_value, start_neighbor_h_vals[i]);
-        EXPECT_EQ(neighbors[i]->visited, true);
+        EXPECT_EQ(context.Parent(neighbors[i]), start_node->Index());
+        EXPECT_FLOAT_EQ(context.G(neighbors[i]), start_neighbor_g_vals[i]);
+        EXPECT_FLOAT_EQ(route_planner.CalculateHValue(neighbors[i]), start_neighbor_h_vals[i]);
+        EXPECT_EQ(context.Reached(neighbors[i]), true);
     }
 }
 
@@ -96,29 +101,221 @@ TEST_F(RoutePlannerTest, TestAddNeighbors) {
 // Test the ConstructFinalPath method.
 TEST_F(RoutePlannerTest, TestConstructFinalPath) {
     // Construct a path.
-    mid_node->parent = start_node;
-    end_node->parent = mid_node;
-    std::vector<RouteModel::Node> path = route_planner.ConstructFinalPath(end_node);
+    SearchContext &context = route_planner.Context();
+    context.Reach(mid_node->Index(), 0.0f, start_node->Index(), -1);
+    context.Reach(end_node->Index(), 0.0f, mid_node->Index(), -1);
+    std::vector<int> path = route_planner.ConstructFinalPath(end_node->Index());
 
     // Test the path.
     EXPECT_EQ(path.size(), 3);
-    EXPECT_FLOAT_EQ(start_node->x, path.front().x);
-    EXPECT_FLOAT_EQ(start_node->y, path.front().y);
-    EXPECT_FLOAT_EQ(end_node->x, path.back().x);
-    EXPECT_FLOAT_EQ(end_node->y, path.back().y);
+    EXPECT_EQ(start_node->Index(), path.front());
+    EXPECT_EQ(mid_node->Index(), path[1]);
+    EXPECT_EQ(end_node->Index(), path.back());
 }
 
 
 // Test the AStarSearch method.
 TEST_F(RoutePlannerTest, TestAStarSearch) {
     route_planner.AStarSearch();
-    EXPECT_EQ(model.path.size(), 33);
-    RouteModel::Node path_start = model.path.front();
-    RouteModel::Node path_end = model.path.back();
+    EXPECT_EQ(model.path.size(), 70);
+    RouteModel::Node path_start = model.SNodes()[model.path.front()];
+    RouteModel::Node path_end = model.SNodes()[model.path.back()];
     // The start_node and end_node x, y values should be the same as in the path.
     EXPECT_FLOAT_EQ(start_node->x, path_start.x);
     EXPECT_FLOAT_EQ(start_node->y, path_start.y);
     EXPECT_FLOAT_EQ(end_node->x, path_end.x);
     EXPECT_FLOAT_EQ(end_node->y, path_end.y);
-    EXPECT_FLOAT_EQ(route_planner.GetDistance(), 873.41565);
+    EXPECT_FLOAT_EQ(route_planner.GetDistance(), 839.26294);
+}
+
+
+// Renumbering the nodes along a Hilbert curve must not change the route that is found.
+TEST(RouteModelHilbertTest, TestHilbertOrderKeepsRoute) {
+    std::vector<std::byte> osm_data = ReadOSMData("../map.osm");
+    RouteModel model{osm_data};
+    RouteModel hilbert_model{osm_data, true};
+    ASSERT_EQ(model.SNodes().size(), hilbert_model.SNodes().size());
+    ASSERT_EQ(model.Ways().size(), hilbert_model.Ways().size());
+
+    // way node lists must still describe the same geometry
+    for (std::size_t i = 0; i < model.Ways().size(); i++) {
+        auto &way = model.Ways()[i].nodes;
+        auto &hilbert_way = hilbert_model.Ways()[i].nodes;
+        ASSERT_EQ(way.size(), hilbert_way.size());
+        for (std::size_t j = 0; j < way.size(); j++) {
+            EXPECT_DOUBLE_EQ(model.Nodes()[way[j]].x, hilbert_model.Nodes()[hilbert_way[j]].x);
+            EXPECT_DOUBLE_EQ(model.Nodes()[way[j]].y, hilbert_model.Nodes()[hilbert_way[j]].y);
+        }
+    }
+
+    RoutePlanner route_planner{model, 10, 10, 90, 90};
+    RoutePlanner hilbert_route_planner{hilbert_model, 10, 10, 90, 90};
+    route_planner.AStarSearch();
+    hilbert_route_planner.AStarSearch();
+    EXPECT_EQ(model.path.size(), hilbert_model.path.size());
+    EXPECT_FLOAT_EQ(route_planner.GetDistance(), hilbert_route_planner.GetDistance());
+}
+
+
+// Test the connected component labels of the road graph.
+TEST_F(RoutePlannerTest, TestComponents) {
+    // the start and end nodes are connected, so they must share a label
+    EXPECT_GE(model.Component(start_node->Index()), 0);
+    EXPECT_TRUE(model.Connected(start_node->Index(), end_node->Index()));
+
+    // every edge a car may use joins two nodes with the same label
+    for (std::size_t i = 0; i < model.SNodes().size(); i++) {
+        for (int e = model.FirstEdge()[i]; e < model.FirstEdge()[i + 1]; e++) {
+            if (model.EdgeAccessible(e, RouteModel::Car)) {
+                EXPECT_EQ(model.Component(i), model.Component(model.EdgeTo()[e]));
+            }
+        }
+    }
+
+    // snapping restricted to the largest component only returns nodes in it
+    auto &node = model.FindClosestNode(mid_x, mid_y, RouteModel::Car, true);
+    EXPECT_EQ(model.Component(node.Index()), model.LargestComponent());
+
+    // coordinates that are not numbers match no node, and a planner given them finds no route
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    EXPECT_EQ(model.ClosestNodeIndex(nan, mid_y), -1);
+    EXPECT_EQ(model.ClosestNodeIndex(mid_x, nan, RouteModel::Car, true), -1);
+    EXPECT_THROW(model.FindClosestNode(nan, mid_y), std::out_of_range);
+    RoutePlanner planner{model};
+    planner.SetEndpoints(nan, 10, 90, 90);
+    EXPECT_EQ(planner.StartNode(), -1);
+    EXPECT_FALSE(planner.Search());
+    EXPECT_TRUE(planner.GetPath().empty());
+}
+
+
+// Test routing the same model with the pedestrian profile.
+TEST(RoutePlannerProfileTest, TestPedestrianProfile) {
+    std::vector<std::byte> osm_data = ReadOSMData("../map.osm");
+    RouteModel model{osm_data};
+    RoutePlanner pedestrian_planner{model, 10, 10, 90, 90, RouteModel::Pedestrian};
+    pedestrian_planner.AStarSearch();
+    ASSERT_FALSE(model.path.empty());
+
+    // every leg of the route is an edge that pedestrians may use
+    for (std::size_t i = 1; i < model.path.size(); i++) {
+        int from = model.path[i - 1], to = model.path[i];
+        bool found = false;
+        for (int e = model.FirstEdge()[from]; e < model.FirstEdge()[from + 1]; e++)
+            found |= model.EdgeTo()[e] == to && model.EdgeAccessible(e, RouteModel::Pedestrian);
+        EXPECT_TRUE(found);
+    }
+    // footways are only open to pedestrians
+    for (std::size_t e = 0; e < model.EdgeTo().size(); e++) {
+        if (model.EdgeRoadType()[e] == Model::Road::Footway) {
+            EXPECT_EQ(model.EdgeProfiles()[e], 1u << RouteModel::Pedestrian);
+        }
+    }
+}
+
+
+// The fastest route takes no longer, and is no shorter, than the shortest route.
+TEST(RoutePlannerProfileTest, TestTimeMetric) {
+    std::vector<std::byte> osm_data = ReadOSMData("../map.osm");
+    // both planners share one model
+    RouteModel model{osm_data};
+    RoutePlanner shortest_planner{model, 10, 10, 90, 90, RouteModel::Car, RouteModel::Distance};
+    RoutePlanner fastest_planner{model, 10, 10, 90, 90, RouteModel::Car, RouteModel::Time};
+    ASSERT_TRUE(shortest_planner.Search());
+    ASSERT_TRUE(fastest_planner.Search());
+
+    EXPECT_LE(fastest_planner.GetDuration(), shortest_planner.GetDuration());
+    EXPECT_GE(fastest_planner.GetDistance(), shortest_planner.GetDistance());
+    EXPECT_GT(fastest_planner.GetDuration(), 0.0f);
+
+    // the time heuristic never overestimates the travel time
+    EXPECT_LE(fastest_planner.CalculateHValue(fastest_planner.GetPath().front()), fastest_planner.GetDuration());
+}
+
+
+// The recorder sees every settled node once, starting with the start node and ending with the end node.
+TEST_F(RoutePlannerTest, TestSearchRecorder) {
+    SearchRecorder recorder{100000};
+    route_planner.SetRecorder(&recorder);
+    ASSERT_TRUE(route_planner.Search());
+
+    auto &events = recorder.Events();
+    ASSERT_FALSE(events.empty());
+    EXPECT_FALSE(recorder.Overflowed());
+    std::vector<int> settled;
+    std::uint32_t last_time = 0;
+    for (auto &event : events) {
+        EXPECT_GE(event.Nanoseconds(), last_time);
+        last_time = event.Nanoseconds();
+        if (event.IsSettled())
+            settled.push_back(event.node);
+        else
+            EXPECT_TRUE(route_planner.Context().Reached(event.node));
+    }
+    EXPECT_EQ(settled.front(), route_planner.StartNode());
+    EXPECT_EQ(settled.back(), route_planner.EndNode());
+    std::sort(settled.begin(), settled.end());
+    EXPECT_EQ(std::adjacent_find(settled.begin(), settled.end()), settled.end());
+    for (int node : settled)
+        EXPECT_TRUE(route_planner.Context().Closed(node));
+
+    // a full buffer drops events instead of growing
+    SearchRecorder small{10};
+    route_planner.SetRecorder(&small);
+    ASSERT_TRUE(route_planner.Search());
+    EXPECT_EQ(small.Events().size(), 10);
+    EXPECT_TRUE(small.Overflowed());
+    route_planner.SetRecorder(nullptr);
+}
+
+
+// Weighted A* finds a route within the weight of the best one, and the anytime search ends with the
+// best route after a sequence of ever cheaper routes whose bounds hold.
+TEST_F(RoutePlannerTest, TestWeightedAndAnytimeSearch) {
+    const float scale = static_cast<float>(model.MetricScale());
+    const float queries[][4] = {{10, 10, 90, 90}, {10, 90, 90, 10}, {20, 50, 80, 50}, {50, 10, 50, 90}};
+    for (auto &q : queries) {
+        RoutePlanner optimal{model};
+        optimal.SetEndpoints(q[0], q[1], q[2], q[3]);
+        ASSERT_TRUE(optimal.Search());
+        const float best = optimal.Context().G(optimal.EndNode()) * scale;
+
+        RoutePlanner weighted{model};
+        weighted.SetHeuristicWeight(2.0f);
+        weighted.SetEndpoints(q[0], q[1], q[2], q[3]);
+        ASSERT_TRUE(weighted.Search());
+        EXPECT_EQ(weighted.GetPath().front(), optimal.StartNode());
+        EXPECT_EQ(weighted.GetPath().back(), optimal.EndNode());
+        EXPECT_LE(weighted.Context().G(weighted.EndNode()) * scale, 2.0f * best * 1.0001f);
+
+        RoutePlanner anytime{model};
+        anytime.SetEndpoints(q[0], q[1], q[2], q[3]);
+        ASSERT_TRUE(anytime.AnytimeSearch());
+        auto &routes = anytime.AnytimeRoutes();
+        ASSERT_FALSE(routes.empty());
+        for (std::size_t i = 0; i < routes.size(); i++) {
+            EXPECT_GE(routes[i].bound, 1.0f);
+            EXPECT_LE(routes[i].cost, routes[i].bound * best * 1.0001f);
+            EXPECT_GE(routes[i].cost, best * 0.9999f);
+            EXPECT_EQ(routes[i].path.front(), optimal.StartNode());
+            EXPECT_EQ(routes[i].path.back(), optimal.EndNode());
+            if (i > 0) {
+                EXPECT_LT(routes[i].cost, routes[i - 1].cost);
+            }
+        }
+        // without a deadline the search ends with the best route
+        EXPECT_NEAR(routes.back().cost, best, 1e-4f * best);
+        EXPECT_EQ(anytime.GetPath(), routes.back().path);
+        EXPECT_FLOAT_EQ(anytime.GetDistance(), routes.back().distance);
+    }
+
+    // a deadline that has passed stops the search before its first expansion, so it finds no route
+    RoutePlanner::AnytimeOptions options;
+    options.deadline = std::chrono::steady_clock::now();
+    route_planner.SetEndpoints(10, 10, 90, 90);
+    const auto begin = std::chrono::steady_clock::now();
+    EXPECT_FALSE(route_planner.AnytimeSearch(options));
+    EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(50));
+    EXPECT_TRUE(route_planner.AnytimeRoutes().empty());
+    EXPECT_TRUE(route_planner.GetPath().empty());
 }
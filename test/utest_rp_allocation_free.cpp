@@ -0,0 +1,54 @@
+#include "gtest/gtest.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+#include "../src/route_model.h"
+#include "../src/route_planner.h"
+#include "../src/utility_route_model.h"
+
+// Count the heap allocations made while counting is on. The replacements are global, so they also serve
+// every other test in the executable; they only count inside the measured section of the test below.
+// They are kept out of line, where the compiler does not see the new and free of a pointer pair up
+// (-Wmismatched-new-delete).
+static std::atomic<bool> counting{false};
+static std::atomic<long> allocations{0};
+
+[[gnu::noinline]] void* operator new(std::size_t size) {
+    if (counting)
+        ++allocations;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+
+// Once a RoutePlanner has been constructed, queries must not allocate.
+TEST(RoutePlannerAllocationTest, TestSearchDoesNotAllocate) {
+    auto osm_data = ReadFile("../map.osm");
+    ASSERT_TRUE(osm_data);
+    RouteModel model{*osm_data};
+
+    for (auto metric : {RouteModel::Distance, RouteModel::Time}) {
+        RoutePlanner planner{model, RouteModel::Car, metric};
+        std::mt19937 rng{42};
+        std::uniform_real_distribution<float> coordinate{0.f, 100.f};
+        std::vector<float> coordinates(400);
+        for (auto &c : coordinates)
+            c = coordinate(rng);
+
+        allocations = 0;
+        counting = true;
+        int routes_found = 0;
+        for (std::size_t i = 0; i + 3 < coordinates.size(); i += 4) {
+            planner.SetEndpoints(coordinates[i], coordinates[i + 1], coordinates[i + 2], coordinates[i + 3]);
+            routes_found += planner.Search();
+        }
+        counting = false;
+        EXPECT_EQ(allocations, 0);
+        EXPECT_GT(routes_found, 0);
+    }
+}
@@ -0,0 +1,59 @@
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "../src/spatial_index.h"
+#include "../src/route_model.h"
+#include "../src/utility_route_model.h"
+
+static std::vector<int> BruteForce(const std::vector<Box> &boxes, const Box &query) {
+    std::vector<int> result;
+    for (std::size_t i = 0; i < boxes.size(); i++)
+        if (boxes[i].Intersects(query))
+            result.push_back((int)i);
+    return result;
+}
+
+
+// The index must return exactly the boxes that intersect the query box.
+TEST(SpatialIndexTest, TestQueryMatchesBruteForce) {
+    std::mt19937 rng{7};
+    std::uniform_real_distribution<double> coordinate{0., 1.};
+    std::uniform_real_distribution<double> size{0., 0.05};
+    std::vector<Box> boxes(5000);
+    for (auto &box : boxes) {
+        box.Extend(coordinate(rng), coordinate(rng));
+        box.Extend(box.min_x + size(rng), box.min_y + size(rng));
+    }
+    boxes[10] = Box{}; // empty boxes are never returned
+    SpatialIndex index{boxes};
+    EXPECT_EQ(index.Size(), boxes.size() - 1);
+
+    for (int q = 0; q < 100; q++) {
+        Box query;
+        query.Extend(coordinate(rng), coordinate(rng));
+        query.Extend(coordinate(rng), coordinate(rng));
+        std::vector<int> result;
+        index.Query(query, result);
+        std::sort(result.begin(), result.end());
+        EXPECT_EQ(result, BruteForce(boxes, query));
+    }
+}
+
+
+// Every road of the map is found by a query over its own bounding box.
+TEST(SpatialIndexTest, TestFeatureIndex) {
+    auto osm_data = ReadFile("../map.osm");
+    ASSERT_TRUE(osm_data);
+    RouteModel model{*osm_data};
+    FeatureIndex index{model};
+    EXPECT_EQ(index.Roads().Size(), model.Roads().size());
+    for (std::size_t i = 0; i < model.Roads().size(); i += 97) {
+        std::vector<int> result;
+        index.Roads().Query(WayBox(model, model.Ways()[model.Roads()[i].way]), result);
+        EXPECT_NE(std::find(result.begin(), result.end(), (int)i), result.end());
+    }
+    Box bounds = index.Bounds();
+    EXPECT_LE(bounds.min_x, 0.);
+    EXPECT_GE(bounds.max_x, 1.);
+}
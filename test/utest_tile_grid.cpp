@@ -0,0 +1,45 @@
+#include "gtest/gtest.h"
+#include <cmath>
+#include "../src/model.h"
+#include "../src/tile_grid.h"
+#include "../src/utility_route_model.h"
+
+// Tile numbers of a longitude and latitude, from the usual slippy map formulas.
+static TileId LonLatToTile(double lon, double lat, int z) {
+    const double pi = 3.14159265358979323846;
+    const double n = std::ldexp(1., z);
+    const double lat_rad = lat * pi / 180.;
+    int x = (int)std::floor((lon + 180.) / 360. * n);
+    int y = (int)std::floor((1. - std::log(std::tan(lat_rad) + 1. / std::cos(lat_rad)) / pi) / 2. * n);
+    return {z, x, y};
+}
+
+
+// The map file bounds are minlat 30.27059, minlon -97.74541, maxlat 30.27957, maxlon -97.73195.
+TEST(TileGridTest, TestTilesCoverMapBounds) {
+    auto osm_data = ReadFile("../map.osm");
+    ASSERT_TRUE(osm_data);
+    Model model{*osm_data};
+
+    // model (0, 0) is the south west corner of the bounds
+    EXPECT_NEAR(model.WorldX(0.), (-97.74541 + 180.) / 360., 1e-9);
+    EXPECT_NEAR(model.ModelX(model.WorldX(0.25)), 0.25, 1e-9);
+    EXPECT_NEAR(model.ModelY(model.WorldY(0.75)), 0.75, 1e-9);
+
+    Box bounds;
+    bounds.Extend(0., 0.);
+    bounds.Extend(model.ModelX(model.WorldX(0.)) + (-97.73195 + 97.74541) / 360. / model.WorldScale(), 0.);
+    for (int z : {10, 15, 17}) {
+        auto sw = LonLatToTile(-97.74541, 30.27059, z);
+        auto ne = LonLatToTile(-97.73195, 30.27059, z);
+        auto tiles = TilesCovering(model, bounds, z);
+        ASSERT_FALSE(tiles.empty());
+        EXPECT_EQ(tiles.front().x, sw.x);
+        EXPECT_EQ(tiles.back().x, ne.x);
+        EXPECT_EQ(tiles.front().y, sw.y);
+        for (auto &tile : tiles) {
+            EXPECT_TRUE(TileBox(model, tile).Intersects(bounds));
+            EXPECT_NEAR(TileBox(model, tile).max_x - TileBox(model, tile).min_x, std::ldexp(1., -z) / model.WorldScale(), 1e-9);
+        }
+    }
+}
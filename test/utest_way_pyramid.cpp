@@ -0,0 +1,49 @@
+#include "gtest/gtest.h"
+#include <cmath>
+#include "../src/route_model.h"
+#include "../src/way_pyramid.h"
+#include "../src/utility_route_model.h"
+
+static double PointSegmentDistance(const Model::Node &p, const Model::Node &a, const Model::Node &b) {
+    double dx = b.x - a.x, dy = b.y - a.y;
+    double length2 = dx * dx + dy * dy;
+    double t = length2 > 0 ? std::clamp(((p.x - a.x) * dx + (p.y - a.y) * dy) / length2, 0., 1.) : 0.;
+    return std::hypot(a.x + t * dx - p.x, a.y + t * dy - p.y);
+}
+
+
+// Simplified ways keep their end nodes and stay within the tolerance of the full geometry.
+TEST(WayPyramidTest, TestSimplificationWithinTolerance) {
+    auto osm_data = ReadFile("../map.osm");
+    ASSERT_TRUE(osm_data);
+    RouteModel model{*osm_data};
+    WayPyramid pyramid{model};
+    auto &nodes = model.Nodes();
+
+    for (int level = 1; level < WayPyramid::NumLevels; level++) {
+        long full_size = 0, simplified_size = 0;
+        for (std::size_t w = 0; w < model.Ways().size(); w++) {
+            auto &way = model.Ways()[w].nodes;
+            auto simplified = pyramid.Nodes(level, w);
+            full_size += way.size();
+            simplified_size += simplified.size();
+            if (way.empty())
+                continue;
+            ASSERT_GE(simplified.size(), std::min<int>(2, way.size()));
+            EXPECT_EQ(*simplified.begin(), way.front());
+            EXPECT_EQ(*(simplified.end() - 1), way.back());
+            if (w % 50 != 0)
+                continue;
+            // every full node is close to some segment of the simplified way
+            for (int node : way) {
+                double best = simplified.size() == 1 ? PointSegmentDistance(nodes[node], nodes[way.front()], nodes[way.front()]) : 1e9;
+                for (auto it = simplified.begin(); it + 1 != simplified.end(); ++it)
+                    best = std::min(best, PointSegmentDistance(nodes[node], nodes[*it], nodes[*(it + 1)]));
+                EXPECT_LE(best, WayPyramid::Tolerance(level) + 1e-12);
+            }
+        }
+        EXPECT_LT(simplified_size, full_size);
+    }
+    EXPECT_EQ(WayPyramid::LevelFor(0.), 0);
+    EXPECT_EQ(WayPyramid::LevelFor(1.), WayPyramid::NumLevels - 1);
+}